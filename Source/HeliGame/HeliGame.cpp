@@ -6,3 +6,5 @@
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, HeliGame, "HeliGame" );
 
 //DEFINE_LOG_CATEGORY(LogHeliWeapon);
+DEFINE_LOG_CATEGORY(LogHeliNet);
+DEFINE_LOG_CATEGORY(LogHeliFlight);
@@ -15,6 +15,8 @@ const static FName GAME_VERSION_SETTINGS_KEY = TEXT("GameVersion");
 // need loging?
 //DECLARE_LOG_CATEGORY_EXTERN(LogHeli, Log, All);
 DECLARE_LOG_CATEGORY_EXTERN(LogHeliWeapon, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogHeliNet, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogHeliFlight, Log, All);
 
 /** when you modify this, please note that this information can be saved with instances
 * also DefaultEngine.ini [/Script/Engine.CollisionProfile] should match with this list **/
@@ -21,7 +21,7 @@ void UHeliGameUserSettings::SetToDefaults()
 	KeyboardSensitivity = 1.f;
 	InvertedAim = 1;
 	PilotAssist = -1;
-	NetworkSmoothingFactor = -1;
+	NetworkSmoothingFactor = 100;
 }
 
 void UHeliGameUserSettings::ApplySettings(bool bCheckForCommandLineOverrides)
@@ -0,0 +1,127 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliWindVolume.h"
+#include "HeliGame.h"
+#include "HeliWindField.h"
+
+#include "Components/BoxComponent.h"
+#include "Public/EngineUtils.h"
+#include "Engine/World.h"
+
+AHeliWindVolume::AHeliWindVolume(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	Bounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bounds"));
+	Bounds->SetBoxExtent(FVector(50000.f, 50000.f, 10000.f));
+	Bounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Bounds->bGenerateOverlapEvents = false;
+	RootComponent = Bounds;
+
+	PrimaryActorTick.bCanEverTick = false;
+	bReplicates = false;
+
+	CellSize = 2000.f;
+	WindVelocity = FVector(800.f, 0.f, 0.f);
+	WindShearHeight = 5000.f;
+	SlopeUpdraftScale = 1.f;
+	TurbulenceSpeed = 300.f;
+	GroundTurbulenceHeight = 3000.f;
+	TurbulenceSeed = 0;
+	MaxGridPoints = 1 << 20;
+}
+
+UHeliWindField* AHeliWindVolume::FindWindField(UWorld* World)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AHeliWindVolume> It(World); It; ++It)
+	{
+		if (It->WindField && It->WindField->IsValidField())
+		{
+			return It->WindField;
+		}
+	}
+
+	return nullptr;
+}
+
+void AHeliWindVolume::BakeWindField()
+{
+	UWorld* World = GetWorld();
+	if (!WindField || !World || CellSize <= 0.f)
+	{
+		UE_LOG(LogHeliFlight, Warning, TEXT("%s: set a wind field asset before baking"), *GetName());
+		return;
+	}
+
+	const FBox Box = Bounds->Bounds.GetBox();
+	const FVector Size = Box.GetSize();
+
+	const FIntVector Dimensions(
+		FMath::Max(FMath::CeilToInt(Size.X / CellSize) + 1, 2),
+		FMath::Max(FMath::CeilToInt(Size.Y / CellSize) + 1, 2),
+		FMath::Max(FMath::CeilToInt(Size.Z / CellSize) + 1, 2));
+
+	const int64 NumGridPoints = static_cast<int64>(Dimensions.X) * Dimensions.Y * Dimensions.Z;
+	if (NumGridPoints > MaxGridPoints)
+	{
+		UE_LOG(LogHeliFlight, Warning, TEXT("%s: %lld grid points is more than %d, raise CellSize"), *GetName(), NumGridPoints, MaxGridPoints);
+		return;
+	}
+
+	TArray<FHeliFlightWind> Winds;
+	Winds.SetNum(static_cast<int32>(NumGridPoints));
+
+	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WindFieldGroundTrace), true, this);
+
+	// grid points are always visited in the same order, so the turbulence only depends on the seed and the map
+	FRandomStream RandomStream(TurbulenceSeed);
+
+	const float HorizontalWindSpeed = WindVelocity.Size2D();
+
+	for (int32 Y = 0; Y < Dimensions.Y; ++Y)
+	{
+		for (int32 X = 0; X < Dimensions.X; ++X)
+		{
+			// the ground under the column, a column without ground is open air all the way down
+			const FVector ColumnTop(Box.Min.X + X * CellSize, Box.Min.Y + Y * CellSize, Box.Max.Z);
+			const FVector ColumnBottom(ColumnTop.X, ColumnTop.Y, Box.Min.Z - WindShearHeight);
+
+			FHitResult Hit;
+			const bool bHasGround = World->LineTraceSingleByChannel(Hit, ColumnTop, ColumnBottom, ECC_WorldStatic, TraceParams);
+
+			const float GroundZ = bHasGround ? Hit.ImpactPoint.Z : -WORLD_MAX;
+			const FVector GroundNormal = bHasGround ? Hit.ImpactNormal : FVector::UpVector;
+
+			// wind blowing into a slope goes up it, down behind it
+			const float SlopeUpdraft = -FVector::DotProduct(FVector(WindVelocity.X, WindVelocity.Y, 0.f), GroundNormal) * SlopeUpdraftScale;
+
+			for (int32 Z = 0; Z < Dimensions.Z; ++Z)
+			{
+				FHeliFlightWind& Wind = Winds[X + Dimensions.X * (Y + Dimensions.Y * Z)];
+
+				const float Height = Box.Min.Z + Z * CellSize - GroundZ;
+				if (Height < 0.f)
+				{
+					// under ground, no air to move
+					Wind.GroundProximity = 1.f;
+					continue;
+				}
+
+				const float ShearAlpha = FMath::Clamp(Height / WindShearHeight, 0.f, 1.f);
+
+				Wind.GroundProximity = 1.f - FMath::Clamp(Height / GroundTurbulenceHeight, 0.f, 1.f);
+
+				Wind.Velocity = WindVelocity * FMath::Sqrt(ShearAlpha);
+				Wind.Velocity.Z += FMath::Clamp(SlopeUpdraft, -HorizontalWindSpeed, HorizontalWindSpeed) * (1.f - ShearAlpha);
+
+				// the ground stirs the air up, rotor wash is added in flight on top of this
+				Wind.Turbulence = RandomStream.GetUnitVector() * (RandomStream.GetFraction() * TurbulenceSpeed * FMath::Lerp(0.5f, 1.f, Wind.GroundProximity));
+			}
+		}
+	}
+
+	WindField->Store(Box.Min, CellSize, Dimensions, Winds);
+}
@@ -11,6 +11,14 @@
 #include "HeliTeamStart.h"
 #include "HeliGameInstance.h"
 #include "HeliAIController.h"
+#include "HeliNetRelevancyManager.h"
+#include "HeliMovementReplicator.h"
+#include "HeliFlightManager.h"
+#include "HeliPawnPool.h"
+#include "HeliProjectilePool.h"
+#include "HeliLagCompensation.h"
+#include "HeliFlightModel.h"
+#include "HeliFlightVerification.h"
 
 #include "UObject/ConstructorHelpers.h"
 #include "Public/TimerManager.h"
@@ -51,6 +59,21 @@ AHeliGameMode::AHeliGameMode(const FObjectInitializer& ObjectInitializer) : Supe
 	bAllowFriendlyFireDamage = false;
 
 	PlayerTeamNum = 0;
+
+	NetRelevancyManagerClass = AHeliNetRelevancyManager::StaticClass();
+	NetRelevancyManager = nullptr;
+
+	MovementReplicatorClass = AHeliMovementReplicator::StaticClass();
+	MovementReplicator = nullptr;
+
+	FlightManagerClass = AHeliFlightManager::StaticClass();
+	FlightManager = nullptr;
+
+	PawnPoolClass = AHeliPawnPool::StaticClass();
+	PawnPool = nullptr;
+
+	ProjectilePoolClass = AHeliProjectilePool::StaticClass();
+	ProjectilePool = nullptr;
 }
 
 void AHeliGameMode::PreInitializeComponents()
@@ -58,6 +81,114 @@ void AHeliGameMode::PreInitializeComponents()
 	Super::PreInitializeComponents();
 
 	GetWorldTimerManager().SetTimer(TimerHandle_DefaultTimer, this, &AHeliGameMode::DefaultTimer, GetWorldSettings()->GetEffectiveTimeDilation(), true);
+
+	if (NetRelevancyManagerClass && GetNetMode() != NM_Standalone)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Instigator = Instigator;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+		NetRelevancyManager = GetWorld()->SpawnActor<AHeliNetRelevancyManager>(NetRelevancyManagerClass, SpawnInfo);
+	}
+
+	if (MovementReplicatorClass && GetNetMode() != NM_Standalone)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Instigator = Instigator;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+		MovementReplicator = GetWorld()->SpawnActor<AHeliMovementReplicator>(MovementReplicatorClass, SpawnInfo);
+	}
+
+	// bots fly on the server in standalone too
+	if (FlightManagerClass)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Instigator = Instigator;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+		FlightManager = GetWorld()->SpawnActor<AHeliFlightManager>(FlightManagerClass, SpawnInfo);
+	}
+
+	// filled in HandleMatchIsWaitingToStart, pawns can only be spawned once the world has begun play
+	if (PawnPoolClass)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Instigator = Instigator;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+		PawnPool = GetWorld()->SpawnActor<AHeliPawnPool>(PawnPoolClass, SpawnInfo);
+	}
+
+	// filled by projectile weapons as they begin play
+	if (ProjectilePoolClass)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Instigator = Instigator;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+		ProjectilePool = GetWorld()->SpawnActor<AHeliProjectilePool>(ProjectilePoolClass, SpawnInfo);
+	}
+}
+
+AHeliNetRelevancyManager* AHeliGameMode::GetNetRelevancyManager() const
+{
+	return NetRelevancyManager;
+}
+
+AHeliMovementReplicator* AHeliGameMode::GetMovementReplicator() const
+{
+	return MovementReplicator;
+}
+
+AHeliFlightManager* AHeliGameMode::GetFlightManager() const
+{
+	return FlightManager;
+}
+
+AHeliPawnPool* AHeliGameMode::GetPawnPool() const
+{
+	return PawnPool;
+}
+
+AHeliProjectilePool* AHeliGameMode::GetProjectilePool() const
+{
+	return ProjectilePool;
+}
+
+void AHeliGameMode::NetRelevancyStats()
+{
+	if (NetRelevancyManager)
+	{
+		NetRelevancyManager->DumpStats();
+	}
+}
+
+void AHeliGameMode::LagCompensationStats()
+{
+	FHeliLagCompensationStats::Get().Log();
+	FHeliLagCompensationStats::Get().Reset();
+}
+
+void AHeliGameMode::BenchmarkFlightModel(int32 NumHelicopters, int32 NumSteps)
+{
+	FHeliFlightModel::RunBenchmark(NumHelicopters, NumSteps, 1.f / 120.f);
+}
+
+void AHeliGameMode::VerifyFlightModel(int32 NumFrames, int32 Seed, FString RecordingName, int32 NumSubsteps)
+{
+	FHeliFlightVerification::Run(NumFrames, Seed, RecordingName, NumSubsteps);
+}
+
+void AHeliGameMode::PawnPoolStats()
+{
+	if (PawnPool)
+	{
+		PawnPool->DumpStats();
+	}
+}
+
+void AHeliGameMode::ProjectilePoolStats()
+{
+	if (ProjectilePool)
+	{
+		ProjectilePool->DumpStats();
+	}
 }
 
 void AHeliGameMode::InitGame(const FString& InMapName, const FString& Options, FString& ErrorMessage)
@@ -114,7 +245,7 @@ void AHeliGameMode::DefaultTimer()
 	AHeliGameState* const MyGameState = Cast<AHeliGameState>(GameState);
 	if (MyGameState && MyGameState->RemainingTime > 0)
 	{
-		MyGameState->RemainingTime--;
+		MyGameState->SetRemainingTime(MyGameState->RemainingTime - 1);
 
 		if (MyGameState->RemainingTime <= 0)
 		{
@@ -317,10 +448,40 @@ void AHeliGameMode::RestartPlayerAtTransform(AController* NewPlayer, const FTran
 	Super::RestartPlayerAtTransform(NewPlayer, SpawnTransform);
 }
 
+APawn* AHeliGameMode::SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform)
+{
+	UClass* PawnClass = GetDefaultPawnClassForController(NewPlayer);
+	if (!PawnPool || !PawnClass || PawnClass != PawnPool->GetPawnClass())
+	{
+		return Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, SpawnTransform);
+	}
+
+	AHeliPlayerState* HeliPlayerState = NewPlayer ? Cast<AHeliPlayerState>(NewPlayer->PlayerState) : nullptr;
+	const int32 TeamNumber = HeliPlayerState ? HeliPlayerState->GetTeamNumber() : 0;
+
+	AHelicopter* PooledPawn = PawnPool->AcquirePawn(TeamNumber, SpawnTransform);
+	if (PooledPawn)
+	{
+		return PooledPawn;
+	}
+
+	// the team ran out of parked pawns, this one joins the pool once it dies
+	APawn* NewPawn = Super::SpawnDefaultPawnAtTransform_Implementation(NewPlayer, SpawnTransform);
+	PawnPool->AddPawn(Cast<AHelicopter>(NewPawn), TeamNumber);
+
+	return NewPawn;
+}
+
 void AHeliGameMode::HandleMatchIsWaitingToStart()
 {
 	Super::HandleMatchIsWaitingToStart();
 
+	if (PawnPool)
+	{
+		AHeliGameState* const MyGameState = Cast<AHeliGameState>(GameState);
+		PawnPool->Prewarm(DefaultPawnClass, MyGameState ? MyGameState->NumTeams : 1);
+	}
+
 	if (bNeedsBotCreation)
 	{
 		CreateBotControllers();
@@ -336,11 +497,11 @@ void AHeliGameMode::HandleMatchIsWaitingToStart()
 			const bool bWantsMatchWarmup = !GetWorld()->IsPlayInEditor();
 			if (bWantsMatchWarmup && WarmupTime > 0)
 			{
-				MyGameState->RemainingTime = WarmupTime;
+				MyGameState->SetRemainingTime(WarmupTime);
 			}
 			else
 			{
-				MyGameState->RemainingTime = 0.0f;
+				MyGameState->SetRemainingTime(0);
 			}
 		}
 	}
@@ -352,7 +513,7 @@ void AHeliGameMode::HandleMatchHasStarted()
 	Super::HandleMatchHasStarted();	
 
 	AHeliGameState* const MyGameState = Cast<AHeliGameState>(GameState);
-	MyGameState->RemainingTime = RoundTime;
+	MyGameState->SetRemainingTime(RoundTime);
 	StartBots();
 
 	// notify players
@@ -412,7 +573,7 @@ void AHeliGameMode::FinishMatch()
 		}*/
 
 		// set up to restart the match
-		MyGameState->RemainingTime = TimeBetweenMatches;
+		MyGameState->SetRemainingTime(TimeBetweenMatches);
 	}
 }
 
@@ -7,6 +7,7 @@
 #include "HeliTeamStart.h"
 #include "HeliPlayerController.h"
 #include "HeliGameInstance.h"
+#include "HeliNetRelevancyManager.h"
 #include "Public/TimerManager.h"
 #include "GameFramework/WorldSettings.h"
 
@@ -30,6 +31,12 @@ void AHeliGameModeTDM::PreInitializeComponents()
 {
 	Super::PreInitializeComponents();
 
+	// teammates show on the HUD wherever they are
+	if (NetRelevancyManager)
+	{
+		NetRelevancyManager->bTeammatesAlwaysRelevant = true;
+	}
+
 	if (!bAllowRespawn) {
 		GetWorldTimerManager().SetTimer(TimerHandle_CompetitiveRoundManagerTimer, this, &AHeliGameModeTDM::CompetitiveRoundManager, GetWorldSettings()->GetEffectiveTimeDilation(), true);
 	}
@@ -14,6 +14,7 @@ AHeliGameState::AHeliGameState(const FObjectInitializer& ObjectInitializer) : Su
 {
 	NumTeams = 0;
 	RemainingTime = 0;
+	RemainingTimeServerTime = 0.f;
 	MaxNumberOfPlayers = 10;
 	MaxRoundTime = 0;
 	ServerName = FString(TEXT("Unknown_GameState"));
@@ -167,6 +168,26 @@ void AHeliGameState::RequestEndRoundAndRestartMatch()
 	}
 }
 
+void AHeliGameState::SetRemainingTime(int32 NewRemainingTime)
+{
+	RemainingTime = NewRemainingTime;
+	RemainingTimeServerTime = GetWorld()->GetTimeSeconds();
+}
+
+float AHeliGameState::GetSyncedRemainingTime() const
+{
+	AHeliPlayerController* LocalPlayerController = Cast<AHeliPlayerController>(GetWorld()->GetFirstPlayerController());
+	if (!LocalPlayerController || !LocalPlayerController->HasClockSync() || RemainingTime <= 0)
+	{
+		return RemainingTime;
+	}
+
+	// RemainingTime only changes once per second, count down in between
+	const float Elapsed = FMath::Clamp(LocalPlayerController->GetSyncedServerTime() - RemainingTimeServerTime, 0.f, 1.f);
+
+	return FMath::Max(0.f, RemainingTime - Elapsed);
+}
+
 void AHeliGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -174,6 +195,7 @@ void AHeliGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLi
 	DOREPLIFETIME(AHeliGameState, NumTeams);
 	DOREPLIFETIME(AHeliGameState, TeamScores);
 	DOREPLIFETIME(AHeliGameState, RemainingTime);
+	DOREPLIFETIME(AHeliGameState, RemainingTimeServerTime);
 	DOREPLIFETIME(AHeliGameState, ServerName);
 	DOREPLIFETIME(AHeliGameState, GameModeName);
 	DOREPLIFETIME(AHeliGameState, MapName); 
@@ -0,0 +1,228 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliNetRelevancyManager.h"
+#include "HeliGame.h"
+#include "HeliGameMode.h"
+#include "HeliFighterVehicle.h"
+#include "HeliProjectile.h"
+
+#include "HeliPlayerController.h"
+#include "HeliPlayerState.h"
+#include "Public/EngineUtils.h"
+#include "Engine/World.h"
+
+AHeliNetRelevancyManager::AHeliNetRelevancyManager(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickInterval = 0.1f;
+
+	bReplicates = false;
+
+	bTeammatesAlwaysRelevant = false;
+	CullDistance = 150000.f;
+
+	FullFrequencyDistance = 15000.f;
+	MinFrequencyDistance = 40000.f;
+	MinNetUpdateFrequency = 5.f;
+
+	StatsLogInterval = 0.f;
+	LastStatsTime = 0.f;
+
+	NumRelevantByTeam = 0;
+	FMemory::Memzero(NumCulled, sizeof(NumCulled));
+	FMemory::Memzero(NumRelevant, sizeof(NumRelevant));
+}
+
+AHeliNetRelevancyManager* AHeliNetRelevancyManager::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	AHeliGameMode* GameMode = World ? World->GetAuthGameMode<AHeliGameMode>() : nullptr;
+
+	return GameMode ? GameMode->GetNetRelevancyManager() : nullptr;
+}
+
+FIntPoint AHeliNetRelevancyManager::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CullDistance), FMath::FloorToInt(Location.Y / CullDistance));
+}
+
+void AHeliNetRelevancyManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	UpdateViewers();
+
+	for (TActorIterator<AHeliFighterVehicle> It(GetWorld()); It; ++It)
+	{
+		UpdateActor(*It, It->GetNetRelevancy());
+	}
+
+	for (TActorIterator<AHeliProjectile> It(GetWorld()); It; ++It)
+	{
+		// parked projectiles are dormant, nothing to replicate
+		if (!It->IsParkedInPool())
+		{
+			UpdateActor(*It, It->GetNetRelevancy());
+		}
+	}
+
+	if (StatsLogInterval > 0.f && (GetWorld()->TimeSeconds - LastStatsTime) >= StatsLogInterval)
+	{
+		DumpStats();
+	}
+}
+
+void AHeliNetRelevancyManager::UpdateViewers()
+{
+	Viewers.Reset();
+	ViewerCells.Reset();
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+
+		// local players don't need anything replicated to them
+		if (!PlayerController || PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		AHeliPlayerController* HeliPlayerController = Cast<AHeliPlayerController>(PlayerController);
+		if (!HeliPlayerController || Viewers.Num() >= MaxTrackedViewers)
+		{
+			continue;
+		}
+
+		FHeliNetViewer Viewer;
+		Viewer.Controller = PlayerController;
+
+		AActor* ViewTarget = PlayerController->GetViewTarget();
+		Viewer.ViewLocation = ViewTarget ? ViewTarget->GetActorLocation() : PlayerController->GetFocalLocation();
+		Viewer.Cell = GetCell(Viewer.ViewLocation);
+
+		AHeliPlayerState* PlayerState = Cast<AHeliPlayerState>(PlayerController->PlayerState);
+		Viewer.TeamNumber = PlayerState ? PlayerState->GetTeamNumber() : -1;
+
+		HeliPlayerController->NetRelevancyViewerIndex = Viewers.Num();
+		ViewerCells.FindOrAdd(Viewer.Cell) |= (uint64)1 << Viewers.Num();
+
+		Viewers.Add(Viewer);
+	}
+}
+
+void AHeliNetRelevancyManager::UpdateActor(AActor* Actor, FHeliNetRelevancy& Relevancy)
+{
+	Relevancy.RelevantViewers = 0;
+	Relevancy.Manager = this;
+
+	if (!Actor || Actor->IsPendingKill() || !Actor->GetIsReplicated() || Viewers.Num() == 0)
+	{
+		return;
+	}
+
+	const FVector ActorLocation = Actor->GetActorLocation();
+	const FIntPoint ActorCell = GetCell(ActorLocation);
+	const float CullDistanceSquared = FMath::Square(CullDistance);
+
+	// cells are as big as the cull distance, any viewer close enough is in one of the 9 around us
+	float NearestViewerDistanceSquared = BIG_NUMBER;
+	for (int32 Y = ActorCell.Y - 1; Y <= ActorCell.Y + 1; ++Y)
+	{
+		for (int32 X = ActorCell.X - 1; X <= ActorCell.X + 1; ++X)
+		{
+			const uint64* CellViewers = ViewerCells.Find(FIntPoint(X, Y));
+			if (!CellViewers)
+			{
+				continue;
+			}
+
+			for (int32 ViewerIndex = 0; ViewerIndex < Viewers.Num(); ++ViewerIndex)
+			{
+				const uint64 ViewerBit = (uint64)1 << ViewerIndex;
+				if (!(*CellViewers & ViewerBit))
+				{
+					continue;
+				}
+
+				const float DistanceSquared = FVector::DistSquared(ActorLocation, Viewers[ViewerIndex].ViewLocation);
+				NearestViewerDistanceSquared = FMath::Min(NearestViewerDistanceSquared, DistanceSquared);
+
+				if (DistanceSquared <= CullDistanceSquared)
+				{
+					Relevancy.RelevantViewers |= ViewerBit;
+				}
+			}
+		}
+	}
+
+	const float DefaultNetUpdateFrequency = Actor->GetClass()->GetDefaultObject<AActor>()->NetUpdateFrequency;
+	const float LowestNetUpdateFrequency = FMath::Min(MinNetUpdateFrequency, DefaultNetUpdateFrequency);
+
+	Actor->NetUpdateFrequency = FMath::GetMappedRangeValueClamped(
+		FVector2D(FullFrequencyDistance, MinFrequencyDistance),
+		FVector2D(DefaultNetUpdateFrequency, LowestNetUpdateFrequency),
+		FMath::Sqrt(NearestViewerDistanceSquared));
+}
+
+int32 AHeliNetRelevancyManager::FindViewerIndex(const AActor* RealViewer) const
+{
+	const AHeliPlayerController* HeliPlayerController = Cast<AHeliPlayerController>(RealViewer);
+	if (!HeliPlayerController || !Viewers.IsValidIndex(HeliPlayerController->NetRelevancyViewerIndex))
+	{
+		return INDEX_NONE;
+	}
+
+	// the index is only ours when the slot still holds this controller, viewers come and go between ticks
+	const int32 ViewerIndex = HeliPlayerController->NetRelevancyViewerIndex;
+	return Viewers[ViewerIndex].Controller == HeliPlayerController ? ViewerIndex : INDEX_NONE;
+}
+
+bool AHeliNetRelevancyManager::IsNetRelevantFor(const AActor* Actor, const FHeliNetRelevancy& Relevancy, int32 ActorTeamNumber, EHeliNetRelevancyNode Node, const AActor* RealViewer, const FVector& SrcLocation)
+{
+	const uint8 NodeIndex = static_cast<uint8>(Node);
+
+	const int32 ViewerIndex = FindViewerIndex(RealViewer);
+	if (bTeammatesAlwaysRelevant && ViewerIndex != INDEX_NONE && ActorTeamNumber >= 0 && ActorTeamNumber == Viewers[ViewerIndex].TeamNumber)
+	{
+		NumRelevantByTeam++;
+		return true;
+	}
+
+	bool bRelevant;
+	if (ViewerIndex != INDEX_NONE && Relevancy.Manager.Get() == this)
+	{
+		bRelevant = (Relevancy.RelevantViewers & ((uint64)1 << ViewerIndex)) != 0;
+	}
+	else
+	{
+		// viewers and actors that showed up since the last tick use the location the engine gave us
+		bRelevant = FVector::DistSquared(Actor->GetActorLocation(), SrcLocation) <= FMath::Square(CullDistance);
+	}
+
+	if (bRelevant)
+	{
+		NumRelevant[NodeIndex]++;
+		return true;
+	}
+
+	NumCulled[NodeIndex]++;
+	return false;
+}
+
+void AHeliNetRelevancyManager::DumpStats()
+{
+	const UEnum* NodeEnum = FindObject<UEnum>(ANY_PACKAGE, TEXT("EHeliNetRelevancyNode"), true);
+
+	UE_LOG(LogHeliNet, Log, TEXT("NetRelevancy: %d viewers, %d relevant by team, over the last %.1f s"), Viewers.Num(), NumRelevantByTeam, GetWorld()->TimeSeconds - LastStatsTime);
+
+	for (uint8 NodeIndex = 0; NodeIndex < (uint8)EHeliNetRelevancyNode::MAX; ++NodeIndex)
+	{
+		UE_LOG(LogHeliNet, Log, TEXT("    %s: relevant %d, culled %d"),
+			NodeEnum ? *NodeEnum->GetNameStringByIndex(NodeIndex) : TEXT("?"), NumRelevant[NodeIndex], NumCulled[NodeIndex]);
+	}
+
+	NumRelevantByTeam = 0;
+	FMemory::Memzero(NumCulled, sizeof(NumCulled));
+	FMemory::Memzero(NumRelevant, sizeof(NumRelevant));
+	LastStatsTime = GetWorld()->TimeSeconds;
+}
@@ -8,10 +8,13 @@
 #include "HeliGameMode.h"
 #include "HeliHud.h" // TODO(andrey): remover acoplamento do HUD, deixar hud somente nas classes derivadas desta
 #include "HeliPlayerState.h"
+#include "HeliNetRelevancyManager.h"
+#include "HeliSignificanceManager.h"
 
 #include "Kismet/GameplayStatics.h"
 #include "Components/SceneComponent.h"
 #include "Components/WidgetComponent.h"
+#include "Components/AudioComponent.h"
 #include "Sound/SoundCue.h"
 #include "GameFramework/SpringArmComponent.h"
 #include "Camera/CameraComponent.h"
@@ -20,7 +23,10 @@
 // Sets default values
 AHeliFighterVehicle::AHeliFighterVehicle(const FObjectInitializer &ObjectInitializer) : Super(ObjectInitializer)
 {
-	PrimaryActorTick.bCanEverTick = false;
+	// tick only records the lag compensation history, see BeginPlay
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
 	SetReplicates(true);
 
 	// Create static mesh component, this is the main mesh
@@ -61,10 +67,100 @@ AHeliFighterVehicle::AHeliFighterVehicle(const FObjectInitializer &ObjectInitial
 	HealthBarWidgetComponent = CreateDefaultSubobject<UWidgetComponent>(TEXT("HealthBarWidgetComponent"));	
 	HealthBarWidgetComponent->AttachToComponent(GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform, HealthBarSocketName);
 	MaxHealth = 100.f;
+	LastTakeHitTimeTimeout = 0.f;
+
+	bUseServerArchetype = true;
 
 	SpawnCollisionHandlingMethod = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
 
 	SpawnDelay = 1.0f;
+
+	TransformHistorySize = 64;
+	MaxRewindTime = 0.4f;
+	TransformHistoryHead = 0;
+	TransformHistoryNum = 0;
+
+	Significance = EHeliSignificance::High;
+	MediumSignificanceHealthBarTickInterval = 0.1f;
+}
+
+void AHeliFighterVehicle::PreRegisterAllComponents()
+{
+	Super::PreRegisterAllComponents();
+
+	if (IsServerArchetype())
+	{
+		StripCosmeticComponents();
+	}
+}
+
+bool AHeliFighterVehicle::IsServerArchetype() const
+{
+	// default subobjects are still created everywhere, blueprints keep configuring them
+	return bUseServerArchetype && !IsTemplate() && GetNetMode() == NM_DedicatedServer;
+}
+
+void AHeliFighterVehicle::StripCosmeticComponents()
+{
+	// children first, nothing may be left attached to a destroyed component
+	DestroyCosmeticComponent(Camera);
+	DestroyCosmeticComponent(SpringArmFirstPerson);
+	DestroyCosmeticComponent(SpringArmThirdPerson);
+	DestroyCosmeticComponent(HealthBarWidgetComponent);
+}
+
+void AHeliFighterVehicle::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// only servers with remote players need to rewind
+	if (Role == ROLE_Authority && GetNetMode() != NM_Standalone)
+	{
+		TransformHistory.SetNum(FMath::Max(TransformHistorySize, 2));
+		SetActorTickEnabled(true);
+	}
+
+	AHeliSignificanceManager* SignificanceManager = AHeliSignificanceManager::Get(this);
+	if (SignificanceManager)
+	{
+		SignificanceManager->RegisterVehicle(this);
+	}
+}
+
+void AHeliFighterVehicle::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	AHeliSignificanceManager* SignificanceManager = AHeliSignificanceManager::Get(this);
+	if (SignificanceManager)
+	{
+		SignificanceManager->UnregisterVehicle(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AHeliFighterVehicle::SetSignificance(EHeliSignificance NewSignificance)
+{
+	if (Significance == NewSignificance)
+	{
+		return;
+	}
+
+	Significance = NewSignificance;
+
+	// health bar is only active on vehicles that show it, see SetupPlayerInfoWidget
+	if (HealthBarWidgetComponent && HealthBarWidgetComponent->IsActive())
+	{
+		HealthBarWidgetComponent->SetVisibility(Significance != EHeliSignificance::Low);
+		HealthBarWidgetComponent->SetComponentTickEnabled(Significance != EHeliSignificance::Low);
+		HealthBarWidgetComponent->SetComponentTickInterval(Significance == EHeliSignificance::Medium ? MediumSignificanceHealthBarTickInterval : 0.f);
+	}
+}
+
+void AHeliFighterVehicle::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	RecordTransformHistory();
 }
 
 /** spawn inventory, setup initial variables */
@@ -100,6 +196,24 @@ void AHeliFighterVehicle::SetupPlayerInputComponent(class UInputComponent *HeliI
 }
 
 //							Replication List
+bool AHeliFighterVehicle::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// our own pawn and whatever we are looking at go through the default rules
+	if (bAlwaysRelevant || IsOwnedBy(ViewTarget) || IsOwnedBy(RealViewer) || this == ViewTarget || ViewTarget == Instigator)
+	{
+		return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+	}
+
+	// the manager remembers itself on every actor it has seen, the game mode lookup is only for new ones
+	AHeliNetRelevancyManager* NetRelevancyManager = NetRelevancy.Manager.IsValid() ? NetRelevancy.Manager.Get() : AHeliNetRelevancyManager::Get(this);
+	if (NetRelevancyManager)
+	{
+		return NetRelevancyManager->IsNetRelevantFor(this, NetRelevancy, TeamNumber, IsBotControlled() ? EHeliNetRelevancyNode::Bot : EHeliNetRelevancyNode::Helicopter, RealViewer, SrcLocation);
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
 void AHeliFighterVehicle::GetLifetimeReplicatedProps(TArray<FLifetimeProperty> &OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -158,11 +272,17 @@ void AHeliFighterVehicle::OnStopFire()
 
 bool AHeliFighterVehicle::IsFirstPersonView()
 {
-	return SpringArmFirstPerson->IsActive();
+	return SpringArmFirstPerson && SpringArmFirstPerson->IsActive();
 }
 
 void AHeliFighterVehicle::EnableFirstPersonViewpoint()
 {
+	// no camera on the server archetype
+	if (!Camera || !SpringArmFirstPerson || !SpringArmThirdPerson)
+	{
+		return;
+	}
+
 	SpringArmThirdPerson->Deactivate();
 
 	SpringArmFirstPerson->Activate(false);
@@ -171,6 +291,12 @@ void AHeliFighterVehicle::EnableFirstPersonViewpoint()
 
 void AHeliFighterVehicle::EnableThirdPersonViewpoint()
 {
+	// no camera on the server archetype
+	if (!Camera || !SpringArmFirstPerson || !SpringArmThirdPerson)
+	{
+		return;
+	}
+
 	SpringArmFirstPerson->Deactivate();
 
 	SpringArmThirdPerson->Activate(false);
@@ -322,6 +448,11 @@ FName AHeliFighterVehicle::GetCurrentWeaponAttachPoint() const
 	return PrimaryWeaponAttachPoint;
 }
 
+USceneComponent* AHeliFighterVehicle::GetWeaponAttachComponent() const
+{
+	return GetRootComponent();
+}
+
 AWeapon *AHeliFighterVehicle::GetCurrentWeaponEquiped()
 {
 	return CurrentWeapon;
@@ -494,7 +625,7 @@ void AHeliFighterVehicle::ReplicateHit(float DamageTaken, struct FDamageEvent co
 	const float TimeoutTime = GetWorld()->GetTimeSeconds() + 0.5f;
 
 	FDamageEvent const &LastDamageEvent = LastTakeHitInfo.GetDamageEvent();
-	if (PawnInstigator == LastTakeHitInfo.PawnInstigator.Get() && LastDamageEvent.DamageTypeClass == LastTakeHitInfo.DamageTypeClass)
+	if (PawnInstigator == LastTakeHitInfo.PawnInstigator.Get() && LastDamageEvent.DamageTypeClass == LastTakeHitInfo.DamageTypeClass && LastTakeHitTimeTimeout == TimeoutTime)
 	{
 		// Same frame damage
 		if (bKilled && LastTakeHitInfo.bKilled)
@@ -512,11 +643,18 @@ void AHeliFighterVehicle::ReplicateHit(float DamageTaken, struct FDamageEvent co
 	LastTakeHitInfo.SetDamageEvent(DamageEvent);
 	LastTakeHitInfo.bKilled = bKilled;
 	LastTakeHitInfo.EnsureReplication();
+
+	LastTakeHitTimeTimeout = TimeoutTime;
 }
 
 float AHeliFighterVehicle::GetHealthPercent()
 {
-	return Health / MaxHealth;
+	return GetCurrentHealth() / MaxHealth;
+}
+
+float AHeliFighterVehicle::GetCurrentHealth() const
+{
+	return Health;
 }
 
 void AHeliFighterVehicle::SetupPlayerInfoWidget()
@@ -550,6 +688,70 @@ void AHeliFighterVehicle::SetPlayerName(FName NewPlayerName)
 	PlayerName = NewPlayerName;
 }
 
+/*
+*	Lag Compensation
+*/
+
+void AHeliFighterVehicle::RecordTransformHistory()
+{
+	if (TransformHistory.Num() == 0)
+	{
+		return;
+	}
+
+	TransformHistoryHead = (TransformHistoryHead + 1) % TransformHistory.Num();
+	TransformHistoryNum = FMath::Min(TransformHistoryNum + 1, TransformHistory.Num());
+
+	FTransformHistoryEntry& Entry = TransformHistory[TransformHistoryHead];
+	Entry.Time = GetWorld()->GetTimeSeconds();
+	Entry.Transform = GetActorTransform();
+}
+
+bool AHeliFighterVehicle::GetHistoricalTransform(float Time, FTransform& OutTransform) const
+{
+	if (TransformHistoryNum == 0)
+	{
+		return false;
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	Time = FMath::Clamp(Time, Now - MaxRewindTime, Now);
+
+	// walk from newest to oldest
+	const FTransformHistoryEntry* Newer = &TransformHistory[TransformHistoryHead];
+	if (Time >= Newer->Time)
+	{
+		OutTransform = Newer->Transform;
+		return true;
+	}
+
+	for (int32 Step = 1; Step < TransformHistoryNum; ++Step)
+	{
+		const int32 Index = (TransformHistoryHead - Step + TransformHistory.Num()) % TransformHistory.Num();
+		const FTransformHistoryEntry* Older = &TransformHistory[Index];
+
+		if (Time >= Older->Time)
+		{
+			const float Duration = Newer->Time - Older->Time;
+			const float Alpha = Duration > KINDA_SMALL_NUMBER ? (Time - Older->Time) / Duration : 1.f;
+
+			OutTransform.Blend(Older->Transform, Newer->Transform, Alpha);
+			return true;
+		}
+
+		Newer = Older;
+	}
+
+	// older than the history, oldest is the best we have
+	OutTransform = Newer->Transform;
+	return true;
+}
+
+float AHeliFighterVehicle::GetMaxRewindTime() const
+{
+	return MaxRewindTime;
+}
+
 int32 AHeliFighterVehicle::GetTeamNumber()
 {
 	return TeamNumber;
@@ -608,10 +810,21 @@ void AHeliFighterVehicle::RemoveHealthWidget()
 	}
 }
 
+void AHeliFighterVehicle::RestoreHealthWidget()
+{
+	if (HealthBarWidgetComponent && HealthBarWidgetComponent->GetUserWidgetObject() == nullptr)
+	{
+		HealthBarWidgetComponent->SetActive(true);
+		HealthBarWidgetComponent->InitWidget();
+	}
+
+	SetupPlayerInfoWidget();
+}
+
 UAudioComponent* AHeliFighterVehicle::PlaySound(USoundCue* Sound)
 {
 	UAudioComponent* AC = NULL;
-	if (Sound)
+	if (Sound && GetNetMode() != NM_DedicatedServer)
 	{
 		AC = UGameplayStatics::SpawnSoundAttached(Sound, this->GetRootComponent());
 	}
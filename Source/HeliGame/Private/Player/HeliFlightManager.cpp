@@ -0,0 +1,188 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliFlightManager.h"
+#include "HeliGame.h"
+#include "HeliGameMode.h"
+#include "HeliMoveComp.h"
+
+#include "Engine/World.h"
+
+AHeliFlightManager::AHeliFlightManager(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	bReplicates = false;
+
+	FlightStepRate = 120.f;
+	MaxFlightStepsPerSubstep = 8;
+	bHasBatch = false;
+
+	OnCalculateFlightPhysics.BindUObject(this, &AHeliFlightManager::SubstepFlightPhysics);
+}
+
+AHeliFlightManager* AHeliFlightManager::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	AHeliGameMode* GameMode = World ? World->GetAuthGameMode<AHeliGameMode>() : nullptr;
+
+	return GameMode ? GameMode->GetFlightManager() : nullptr;
+}
+
+void AHeliFlightManager::RegisterMoveComp(UHeliMoveComp* MoveComp)
+{
+	if (MoveComp && !MoveComps.Contains(MoveComp))
+	{
+		MoveComps.Add(MoveComp);
+	}
+}
+
+void AHeliFlightManager::UnregisterMoveComp(UHeliMoveComp* MoveComp)
+{
+	// the batch of this frame may still be pending, slots are compacted on the next tick
+	const int32 Index = MoveComps.Find(MoveComp);
+	if (Index != INDEX_NONE)
+	{
+		MoveComps[Index] = nullptr;
+		if (Bodies.IsValidIndex(Index))
+		{
+			BodyIndices.Remove(Bodies[Index]);
+			Bodies[Index] = nullptr;
+		}
+	}
+}
+
+void AHeliFlightManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	MoveComps.Remove(nullptr);
+
+	const int32 NumMoveComps = MoveComps.Num();
+
+	Bodies.SetNum(NumMoveComps, false);
+	BodyBatches.SetNum(NumMoveComps, false);
+	BodySlots.SetNum(NumMoveComps, false);
+	BodyIndices.Reset();
+	AppliedBodies.Init(false, NumMoveComps);
+	bHasBatch = false;
+
+	// a tuning nobody flew last frame is gone, the others keep their arrays
+	Batches.RemoveAll([](const FHeliFlightBatch& Batch) { return Batch.Num() == 0; });
+	for (FHeliFlightBatch& Batch : Batches)
+	{
+		Batch.SetNum(0);
+	}
+
+	for (int32 Index = 0; Index < NumMoveComps; ++Index)
+	{
+		UHeliMoveComp* MoveComp = MoveComps[Index];
+
+		Bodies[Index] = MoveComp ? MoveComp->GetFlightBodyInstance() : nullptr;
+		BodyBatches[Index] = INDEX_NONE;
+		if (Bodies[Index])
+		{
+			const FHeliFlightParams Params = MoveComp->GetFlightParams();
+
+			int32 BatchIndex = Batches.IndexOfByPredicate([&Params](const FHeliFlightBatch& Batch) { return Batch.Params == Params; });
+			if (BatchIndex == INDEX_NONE)
+			{
+				BatchIndex = Batches.AddDefaulted();
+				Batches[BatchIndex].Params = Params;
+			}
+
+			FHeliFlightBatch& Batch = Batches[BatchIndex];
+			BodyBatches[Index] = BatchIndex;
+			BodySlots[Index] = Batch.Num();
+			Batch.SetNum(Batch.Num() + 1);
+
+			BodyIndices.Add(Bodies[Index], Index);
+
+			// every body drives itself, a sleeping or destroyed helicopter never stops the others
+			Bodies[Index]->AddCustomPhysics(OnCalculateFlightPhysics);
+		}
+	}
+}
+
+void AHeliFlightManager::ComputeBatch()
+{
+	const int32 NumBodies = Bodies.Num();
+
+	// gather, input was captured by the components during their tick
+	for (int32 Index = 0; Index < NumBodies; ++Index)
+	{
+		if (BodyBatches[Index] == INDEX_NONE)
+		{
+			continue;
+		}
+
+		FHeliFlightBatch& Batch = Batches[BodyBatches[Index]];
+		const int32 Slot = BodySlots[Index];
+
+		FBodyInstance* Body = Bodies[Index];
+		UHeliMoveComp* MoveComp = MoveComps.IsValidIndex(Index) ? MoveComps[Index] : nullptr;
+		if (!Body || !MoveComp)
+		{
+			Batch.Masses[Slot] = 0.f;
+			continue;
+		}
+
+		const FTransform BodyTransform = Body->GetUnrealWorldTransform_AssumesLocked();
+		const FVector AngularVelocity = FMath::RadiansToDegrees(Body->GetUnrealWorldAngularVelocityInRadians_AssumesLocked());
+
+		Batch.SetBody(Slot, BodyTransform.GetRotation(), AngularVelocity, Body->GetBodyMass(), UHeliMoveComp::ToFlightInput(MoveComp->GetFlightInput()), MoveComp->SampleWind(BodyTransform.GetLocation()));
+	}
+
+	for (FHeliFlightBatch& Batch : Batches)
+	{
+		FHeliFlightModel::ComputeForcesBatch(Batch);
+	}
+
+	AppliedBodies.Init(false, NumBodies);
+	bHasBatch = true;
+}
+
+void AHeliFlightManager::SubstepFlightPhysics(float DeltaTime, FBodyInstance* BodyInstance)
+{
+	const int32* FoundIndex = BodyIndices.Find(BodyInstance);
+	if (DeltaTime <= 0.f || !FoundIndex)
+	{
+		return;
+	}
+
+	const int32 Index = *FoundIndex;
+
+	// this body already got its forces from the current batch, so this is the next substep
+	if (!bHasBatch || AppliedBodies[Index])
+	{
+		ComputeBatch();
+	}
+
+	AppliedBodies[Index] = true;
+
+	const FHeliFlightBatch& Batch = Batches[BodyBatches[Index]];
+	const int32 Slot = BodySlots[Index];
+	if (Batch.Masses[Slot] <= 0.f)
+	{
+		return;
+	}
+
+	// same weight and force UHeliMoveComp::SubstepFlightPhysics applies, FHeliFlightVerification flies both
+	float NumSteps = 0.f;
+	const float StepWeight = FHeliFlightModel::ComputeSubstepWeight(DeltaTime, FlightStepRate, MaxFlightStepsPerSubstep, NumSteps);
+
+	FHeliFlightForces Forces;
+	Batch.GetForces(Slot, Forces);
+
+	// a single force and torque per body
+	const FVector Force = FHeliFlightModel::ComputeBodyForce(Forces.Force, Forces.Acceleration, Batch.Masses[Slot]);
+	if (!Force.IsZero())
+	{
+		BodyInstance->AddForce(Force * StepWeight, false, false);
+	}
+
+	if (!Forces.Torque.IsZero())
+	{
+		BodyInstance->AddTorqueInRadians(Forces.Torque * StepWeight, false, Batch.Params.bAccelChange);
+	}
+}
@@ -0,0 +1,605 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliFlightModel.h"
+#include "HeliGame.h"
+
+#include "HAL/IConsoleManager.h"
+
+// no game mode needed, so it also runs in the editor and in commandlets
+static FAutoConsoleCommand BenchmarkFlightModelCommand(
+	TEXT("HeliFlight.Benchmark"),
+	TEXT("Times the flight model alone. Arguments: NumHelicopters (1000) NumSteps (600)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumHelicopters = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+		const int32 NumSteps = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 600;
+
+		FHeliFlightModel::RunBenchmark(NumHelicopters, NumSteps, 1.f / 120.f);
+	}));
+
+void FHeliFlightBatch::SetNum(int32 NewNum)
+{
+	for (TArray<float>* Array : {
+		&RotationX, &RotationY, &RotationZ, &RotationW, &AngularVelocityX, &AngularVelocityY, &AngularVelocityZ,
+		&Masses, &Pitch, &Yaw, &Roll, &Thrust, &AutoRoll,
+		&WindX, &WindY, &WindZ, &TurbulenceX, &TurbulenceY, &TurbulenceZ, &GroundProximity,
+		&ForceX, &ForceY, &ForceZ, &AccelerationX, &AccelerationY, &AccelerationZ, &TorqueX, &TorqueY, &TorqueZ,
+		&InclinationTangents, &TiltTangents, &RollErrors, &RollErrorCosines })
+	{
+		Array->SetNum(NewNum, false);
+	}
+}
+
+void FHeliFlightBatch::SetBody(int32 Index, const FQuat& Rotation, const FVector& AngularVelocity, float Mass, const FHeliFlightInput& Input, const FHeliFlightWind& Wind)
+{
+	RotationX[Index] = Rotation.X;
+	RotationY[Index] = Rotation.Y;
+	RotationZ[Index] = Rotation.Z;
+	RotationW[Index] = Rotation.W;
+	AngularVelocityX[Index] = AngularVelocity.X;
+	AngularVelocityY[Index] = AngularVelocity.Y;
+	AngularVelocityZ[Index] = AngularVelocity.Z;
+	Masses[Index] = Mass;
+	Pitch[Index] = Input.Pitch;
+	Yaw[Index] = Input.Yaw;
+	Roll[Index] = Input.Roll;
+	Thrust[Index] = Input.Thrust;
+	AutoRoll[Index] = Input.bAutoRollStabilization ? 1.f : 0.f;
+	WindX[Index] = Wind.Velocity.X;
+	WindY[Index] = Wind.Velocity.Y;
+	WindZ[Index] = Wind.Velocity.Z;
+	TurbulenceX[Index] = Wind.Turbulence.X;
+	TurbulenceY[Index] = Wind.Turbulence.Y;
+	TurbulenceZ[Index] = Wind.Turbulence.Z;
+	GroundProximity[Index] = Wind.GroundProximity;
+}
+
+void FHeliFlightBatch::GetForces(int32 Index, FHeliFlightForces& OutForces) const
+{
+	OutForces.Force = FVector(ForceX[Index], ForceY[Index], ForceZ[Index]);
+	OutForces.Acceleration = FVector(AccelerationX[Index], AccelerationY[Index], AccelerationZ[Index]);
+	OutForces.Torque = FVector(TorqueX[Index], TorqueY[Index], TorqueZ[Index]);
+}
+
+/*
+	Force passes, shared by ComputeForces and ComputeForcesBatch
+*/
+
+namespace
+{
+	/* the arrays of a FHeliFlightBatch, or single values on the stack for ComputeForces. Passed by value: the compiler
+	   only trusts RESTRICT on a local copy, otherwise it reloads every pointer after each store and gives up vectorizing */
+	struct FFlightLanes
+	{
+		int32 Num;
+
+		const float* RESTRICT RotationX;
+		const float* RESTRICT RotationY;
+		const float* RESTRICT RotationZ;
+		const float* RESTRICT RotationW;
+		const float* RESTRICT AngularVelocityX;
+		const float* RESTRICT AngularVelocityY;
+		const float* RESTRICT AngularVelocityZ;
+		const float* RESTRICT Masses;
+		const float* RESTRICT Pitch;
+		const float* RESTRICT Yaw;
+		const float* RESTRICT Roll;
+		const float* RESTRICT Thrust;
+		const float* RESTRICT AutoRoll;
+		const float* RESTRICT WindX;
+		const float* RESTRICT WindY;
+		const float* RESTRICT WindZ;
+		const float* RESTRICT TurbulenceX;
+		const float* RESTRICT TurbulenceY;
+		const float* RESTRICT TurbulenceZ;
+		const float* RESTRICT GroundProximity;
+
+		float* RESTRICT ForceX;
+		float* RESTRICT ForceY;
+		float* RESTRICT ForceZ;
+		float* RESTRICT AccelerationX;
+		float* RESTRICT AccelerationY;
+		float* RESTRICT AccelerationZ;
+		float* RESTRICT TorqueX;
+		float* RESTRICT TorqueY;
+		float* RESTRICT TorqueZ;
+
+		float* RESTRICT InclinationTangents;
+		float* RESTRICT TiltTangents;
+		float* RESTRICT RollErrors;
+		float* RESTRICT RollErrorCosines;
+	};
+
+	/* rows of the rotation matrix of a unit quaternion, what FQuat::GetAxisX/Y/Z return up to rounding */
+	FORCEINLINE void GetRotationAxes(float X, float Y, float Z, float W, FVector& OutForward, FVector& OutRight, FVector& OutUp)
+	{
+		const float XX = X * X;
+		const float YY = Y * Y;
+		const float ZZ = Z * Z;
+		const float XY = X * Y;
+		const float XZ = X * Z;
+		const float YZ = Y * Z;
+		const float WX = W * X;
+		const float WY = W * Y;
+		const float WZ = W * Z;
+
+		OutForward = FVector(1.f - 2.f * (YY + ZZ), 2.f * (XY + WZ), 2.f * (XZ - WY));
+		OutRight = FVector(2.f * (XY - WZ), 1.f - 2.f * (XX + ZZ), 2.f * (YZ + WX));
+		OutUp = FVector(2.f * (XZ + WY), 2.f * (YZ - WX), 1.f - 2.f * (XX + YY));
+	}
+
+	/* level means our up vector as close to the world up as the current heading allows, not normalized */
+	FORCEINLINE FVector GetLevelUp(const FVector& Forward)
+	{
+		return FVector(-Forward.X * Forward.Z, -Forward.Y * Forward.Z, 1.f - Forward.Z * Forward.Z);
+	}
+
+	/* what the tangents are taken of: how far the nose and the side are off the horizon, and the roll angle to level */
+	void ComputeTangentArguments(const FFlightLanes Lanes)
+	{
+		for (int32 Index = 0; Index < Lanes.Num; ++Index)
+		{
+			FVector Forward, Right, Up;
+			GetRotationAxes(Lanes.RotationX[Index], Lanes.RotationY[Index], Lanes.RotationZ[Index], Lanes.RotationW[Index], Forward, Right, Up);
+
+			Lanes.InclinationTangents[Index] = -Forward.Z;
+			Lanes.TiltTangents[Index] = -Right.Z;
+
+			// signed angle around the forward axis from where we are to level, atan2 does not care about the length of LevelUp
+			const FVector LevelUp = GetLevelUp(Forward);
+			Lanes.RollErrors[Index] = FVector::DotProduct(FVector::CrossProduct(Up, LevelUp), Forward);
+			Lanes.RollErrorCosines[Index] = FVector::DotProduct(Up, LevelUp);
+		}
+	}
+
+	/* library calls, kept scalar on purpose */
+	void ComputeTangents(const FFlightLanes Lanes)
+	{
+		for (int32 Index = 0; Index < Lanes.Num; ++Index)
+		{
+			Lanes.InclinationTangents[Index] = FMath::Tan(Lanes.InclinationTangents[Index]);
+			Lanes.TiltTangents[Index] = FMath::Tan(Lanes.TiltTangents[Index]);
+			Lanes.RollErrors[Index] = FMath::Atan2(Lanes.RollErrors[Index], Lanes.RollErrorCosines[Index]);
+		}
+	}
+
+	/* lift, thrust, wind and torques. Every switch is a factor of 0 or 1, so the loop has no branches */
+	void ComputeForceLanes(const FFlightLanes Lanes, const FHeliFlightParams& Params)
+	{
+		const float GravityAcceleration = FMath::Abs(Params.GravityZ) * Params.GravityWeight;
+		const float LiftWeight = Params.bAddLift ? 1.f : 0.f;
+		const float ThrustAccelerationWeight = Params.bAccelChange ? 1.f : 0.f;
+		const float ThrustForceWeight = 1.f - ThrustAccelerationWeight;
+		const float WindResponse = FMath::Max(Params.WindResponse, 0.f);
+		const float MaxAngularVelocitySquared = FMath::Square(Params.MaximumAngularVelocity);
+		const float MaxRollRate = FMath::DegreesToRadians(Params.MaxAutoRollRate);
+
+		for (int32 Index = 0; Index < Lanes.Num; ++Index)
+		{
+			FVector Forward, Right, Up;
+			GetRotationAxes(Lanes.RotationX[Index], Lanes.RotationY[Index], Lanes.RotationZ[Index], Lanes.RotationW[Index], Forward, Right, Up);
+
+			const float Mass = Lanes.Masses[Index];
+
+			// lift, see ComputeLift
+			const float InclinationWeight = 1.f - FMath::Abs(Forward.Z);
+			const float TiltWeight = 1.f - FMath::Abs(Right.Z);
+			const float UpMomentum = Mass * GravityAcceleration * InclinationWeight * TiltWeight;
+			const float InclinationMomentum = GravityAcceleration * Params.MinimumTiltInclinationAcceleration * Lanes.InclinationTangents[Index];
+			const float TiltMomentum = GravityAcceleration * Params.MinimumTiltInclinationAcceleration * Lanes.TiltTangents[Index];
+			const FVector Lift = (Up * UpMomentum + Forward * InclinationMomentum + Right * TiltMomentum) * LiftWeight;
+
+			// thrust, see ComputeThrust, reverse thrust goes straight down
+			const float Thrust = Lanes.Thrust[Index];
+			const float ThrustScale = Params.BaseThrust * Thrust;
+			const float ForwardThrustWeight = Thrust < 0.f ? 0.f : 1.f;
+			const float ReverseThrustWeight = 1.f - ForwardThrustWeight;
+			const FVector ThrustForce(
+				Up.X * ThrustScale * ForwardThrustWeight,
+				Up.Y * ThrustScale * ForwardThrustWeight,
+				Up.Z * InclinationWeight * ThrustScale * ForwardThrustWeight + ThrustScale * ReverseThrustWeight);
+
+			// wind, see ComputeWindAcceleration
+			const float TurbulenceScale = 1.f + Params.RotorWashTurbulenceScale * Lanes.GroundProximity[Index];
+			const FVector Wind(
+				Lanes.WindX[Index] + Lanes.TurbulenceX[Index] * TurbulenceScale,
+				Lanes.WindY[Index] + Lanes.TurbulenceY[Index] * TurbulenceScale,
+				Lanes.WindZ[Index] + Lanes.TurbulenceZ[Index] * TurbulenceScale);
+
+			const FVector Force = Lift + ThrustForce * ThrustForceWeight;
+			const FVector Acceleration = Wind * WindResponse + ThrustForce * ThrustAccelerationWeight;
+
+			// pilot torque, see ComputeTorque
+			const FVector AngularVelocity(Lanes.AngularVelocityX[Index], Lanes.AngularVelocityY[Index], Lanes.AngularVelocityZ[Index]);
+			const float PilotWeight = AngularVelocity.SizeSquared() > MaxAngularVelocitySquared ? 0.f : 1.f;
+			const FVector PilotTorque = (Right * Lanes.Pitch[Index] + Up * Lanes.Yaw[Index] + Forward * Lanes.Roll[Index]) * PilotWeight;
+
+			// auto roll, see ComputeAutoRollTorque: P how fast we want to roll back, D the torque to get there
+			const float RollRate = FVector::DotProduct(FMath::DegreesToRadians(AngularVelocity), Forward);
+			const float TargetRollRate = FMath::Clamp(Lanes.RollErrors[Index] * Params.AutoRollProportionalGain, -MaxRollRate, MaxRollRate);
+			const float RollTorque = FMath::Clamp((TargetRollRate - RollRate) * Params.AutoRollDerivativeGain, -Params.MaxAutoRollTorque, Params.MaxAutoRollTorque);
+
+			// there is no level to go back to flying straight up or down
+			const float LevelWeight = GetLevelUp(Forward).SizeSquared() > SMALL_NUMBER ? 1.f : 0.f;
+			const FVector Torque = PilotTorque + Forward * (RollTorque * Lanes.AutoRoll[Index] * LevelWeight);
+
+			// a free slot has zero mass and whatever (finite) state it had before
+			const float ActiveWeight = Mass > 0.f ? 1.f : 0.f;
+
+			Lanes.ForceX[Index] = Force.X * ActiveWeight;
+			Lanes.ForceY[Index] = Force.Y * ActiveWeight;
+			Lanes.ForceZ[Index] = Force.Z * ActiveWeight;
+			Lanes.AccelerationX[Index] = Acceleration.X * ActiveWeight;
+			Lanes.AccelerationY[Index] = Acceleration.Y * ActiveWeight;
+			Lanes.AccelerationZ[Index] = Acceleration.Z * ActiveWeight;
+			Lanes.TorqueX[Index] = Torque.X * ActiveWeight;
+			Lanes.TorqueY[Index] = Torque.Y * ActiveWeight;
+			Lanes.TorqueZ[Index] = Torque.Z * ActiveWeight;
+		}
+	}
+
+	void ComputeLanes(const FFlightLanes Lanes, const FHeliFlightParams& Params)
+	{
+		ComputeTangentArguments(Lanes);
+		ComputeTangents(Lanes);
+		ComputeForceLanes(Lanes, Params);
+	}
+}
+
+FVector FHeliFlightModel::ComputeLift(const FQuat& Rotation, float Mass, const FHeliFlightParams& Params)
+{
+	return ComputeLift(Rotation.GetAxisX(), Rotation.GetAxisY(), Rotation.GetAxisZ(), Mass, Params);
+}
+
+FVector FHeliFlightModel::ComputeLift(const FVector& Forward, const FVector& Right, const FVector& Up, float Mass, const FHeliFlightParams& Params)
+{
+	float GravityAcceleration = FMath::Abs(Params.GravityZ) * Params.GravityWeight;
+
+	float InclinationAngle = FVector::DotProduct(FVector::UpVector, Forward);
+	float TiltAngle = FVector::DotProduct(FVector::UpVector, Right);
+
+	float InclinationWeight = 1 - FMath::Abs(InclinationAngle);
+	float TiltWeight = 1 - FMath::Abs(TiltAngle);
+
+	// weights gravity acceleration based on inclination and tilt
+	float WeightedGravityAcceleration = GravityAcceleration * InclinationWeight * TiltWeight;
+
+	// up momentum will produce zero net force against gravity force when stationary (F = m*a)
+	FVector UpMomentum = Up * (Mass * WeightedGravityAcceleration);
+
+	// adds momentum for inclination and tilt (m = a * tanh(-angle) a.k.a. hyperbolic tangent function)
+	float InclinationAcceleration = Params.MinimumTiltInclinationAcceleration * FMath::Tan(-InclinationAngle);
+	float TiltAcceleration = Params.MinimumTiltInclinationAcceleration * FMath::Tan(-TiltAngle);
+
+	FVector InclinationMomentum = Forward * GravityAcceleration * InclinationAcceleration;
+	FVector TiltMomentum = Right * GravityAcceleration *  TiltAcceleration;
+
+	// compute net lift force
+	return UpMomentum + InclinationMomentum + TiltMomentum;
+}
+
+FVector FHeliFlightModel::ComputeThrust(const FQuat& Rotation, float Thrust, const FHeliFlightParams& Params)
+{
+	return ComputeThrust(Rotation.GetAxisX(), Rotation.GetAxisZ(), Thrust, Params);
+}
+
+FVector FHeliFlightModel::ComputeThrust(const FVector& Forward, const FVector& Up, float Thrust, const FHeliFlightParams& Params)
+{
+	if (Thrust < 0.f)
+	{
+		return FVector::UpVector * Thrust * Params.BaseThrust;
+	}
+
+	float InclinationAngle = FVector::DotProduct(FVector::UpVector, Forward);
+	float ZWeight = 1.f - FMath::Abs(InclinationAngle);
+
+	FVector UpForceCorrection = FVector(1.f, 1.f, ZWeight);
+
+	return (Up * UpForceCorrection) * Params.BaseThrust * Thrust;
+}
+
+FVector FHeliFlightModel::ComputeTorque(const FQuat& Rotation, const FVector& AngularVelocity, const FHeliFlightInput& Input, const FHeliFlightParams& Params)
+{
+	if (AngularVelocity.SizeSquared() > FMath::Square(Params.MaximumAngularVelocity))
+	{
+		return FVector::ZeroVector;
+	}
+
+	return Rotation.GetAxisY() * Input.Pitch + Rotation.GetAxisZ() * Input.Yaw + Rotation.GetAxisX() * Input.Roll;
+}
+
+FVector FHeliFlightModel::ComputeAutoRollTorque(const FQuat& Rotation, const FVector& AngularVelocity, const FHeliFlightParams& Params)
+{
+	return ComputeAutoRollTorque(Rotation.GetAxisX(), Rotation.GetAxisZ(), AngularVelocity, Params);
+}
+
+FVector FHeliFlightModel::ComputeAutoRollTorque(const FVector& Forward, const FVector& Up, const FVector& AngularVelocity, const FHeliFlightParams& Params)
+{
+	// level means our up vector as close to the world up as the current heading allows
+	FVector LevelUp = FVector::UpVector - Forward * Forward.Z;
+	if (!LevelUp.Normalize())
+	{
+		return FVector::ZeroVector;
+	}
+
+	// signed angle around the forward axis from where we are to level
+	const float RollError = FMath::Atan2(FVector::DotProduct(FVector::CrossProduct(Up, LevelUp), Forward), FVector::DotProduct(Up, LevelUp));
+	const float RollRate = FVector::DotProduct(FMath::DegreesToRadians(AngularVelocity), Forward);
+
+	// P: how fast we want to roll back, D: torque to get there, damping the current roll rate
+	const float MaxRollRate = FMath::DegreesToRadians(Params.MaxAutoRollRate);
+	const float TargetRollRate = FMath::Clamp(RollError * Params.AutoRollProportionalGain, -MaxRollRate, MaxRollRate);
+	const float Torque = FMath::Clamp((TargetRollRate - RollRate) * Params.AutoRollDerivativeGain, -Params.MaxAutoRollTorque, Params.MaxAutoRollTorque);
+
+	return Forward * Torque;
+}
+
+FVector FHeliFlightModel::ComputeWindAcceleration(const FHeliFlightWind& Wind, const FHeliFlightParams& Params)
+{
+	if (Params.WindResponse <= 0.f)
+	{
+		return FVector::ZeroVector;
+	}
+
+	const float TurbulenceScale = 1.f + Params.RotorWashTurbulenceScale * Wind.GroundProximity;
+
+	return (Wind.Velocity + Wind.Turbulence * TurbulenceScale) * Params.WindResponse;
+}
+
+void FHeliFlightModel::ComputeForces(const FHeliFlightBodyState& State, const FHeliFlightInput& Input, const FHeliFlightParams& Params, FHeliFlightForces& OutForces)
+{
+	const float AutoRoll = Input.bAutoRollStabilization ? 1.f : 0.f;
+	float InclinationTangent, TiltTangent, RollError, RollErrorCosine;
+
+	FFlightLanes Lanes;
+	Lanes.Num = 1;
+	Lanes.RotationX = &State.Rotation.X;
+	Lanes.RotationY = &State.Rotation.Y;
+	Lanes.RotationZ = &State.Rotation.Z;
+	Lanes.RotationW = &State.Rotation.W;
+	Lanes.AngularVelocityX = &State.AngularVelocity.X;
+	Lanes.AngularVelocityY = &State.AngularVelocity.Y;
+	Lanes.AngularVelocityZ = &State.AngularVelocity.Z;
+	Lanes.Masses = &State.Mass;
+	Lanes.Pitch = &Input.Pitch;
+	Lanes.Yaw = &Input.Yaw;
+	Lanes.Roll = &Input.Roll;
+	Lanes.Thrust = &Input.Thrust;
+	Lanes.AutoRoll = &AutoRoll;
+	Lanes.WindX = &State.Wind.Velocity.X;
+	Lanes.WindY = &State.Wind.Velocity.Y;
+	Lanes.WindZ = &State.Wind.Velocity.Z;
+	Lanes.TurbulenceX = &State.Wind.Turbulence.X;
+	Lanes.TurbulenceY = &State.Wind.Turbulence.Y;
+	Lanes.TurbulenceZ = &State.Wind.Turbulence.Z;
+	Lanes.GroundProximity = &State.Wind.GroundProximity;
+	Lanes.ForceX = &OutForces.Force.X;
+	Lanes.ForceY = &OutForces.Force.Y;
+	Lanes.ForceZ = &OutForces.Force.Z;
+	Lanes.AccelerationX = &OutForces.Acceleration.X;
+	Lanes.AccelerationY = &OutForces.Acceleration.Y;
+	Lanes.AccelerationZ = &OutForces.Acceleration.Z;
+	Lanes.TorqueX = &OutForces.Torque.X;
+	Lanes.TorqueY = &OutForces.Torque.Y;
+	Lanes.TorqueZ = &OutForces.Torque.Z;
+	Lanes.InclinationTangents = &InclinationTangent;
+	Lanes.TiltTangents = &TiltTangent;
+	Lanes.RollErrors = &RollError;
+	Lanes.RollErrorCosines = &RollErrorCosine;
+
+	ComputeLanes(Lanes, Params);
+}
+
+void FHeliFlightModel::ComputeForcesBatch(FHeliFlightBatch& Batch)
+{
+	FFlightLanes Lanes;
+	Lanes.Num = Batch.Num();
+	Lanes.RotationX = Batch.RotationX.GetData();
+	Lanes.RotationY = Batch.RotationY.GetData();
+	Lanes.RotationZ = Batch.RotationZ.GetData();
+	Lanes.RotationW = Batch.RotationW.GetData();
+	Lanes.AngularVelocityX = Batch.AngularVelocityX.GetData();
+	Lanes.AngularVelocityY = Batch.AngularVelocityY.GetData();
+	Lanes.AngularVelocityZ = Batch.AngularVelocityZ.GetData();
+	Lanes.Masses = Batch.Masses.GetData();
+	Lanes.Pitch = Batch.Pitch.GetData();
+	Lanes.Yaw = Batch.Yaw.GetData();
+	Lanes.Roll = Batch.Roll.GetData();
+	Lanes.Thrust = Batch.Thrust.GetData();
+	Lanes.AutoRoll = Batch.AutoRoll.GetData();
+	Lanes.WindX = Batch.WindX.GetData();
+	Lanes.WindY = Batch.WindY.GetData();
+	Lanes.WindZ = Batch.WindZ.GetData();
+	Lanes.TurbulenceX = Batch.TurbulenceX.GetData();
+	Lanes.TurbulenceY = Batch.TurbulenceY.GetData();
+	Lanes.TurbulenceZ = Batch.TurbulenceZ.GetData();
+	Lanes.GroundProximity = Batch.GroundProximity.GetData();
+	Lanes.ForceX = Batch.ForceX.GetData();
+	Lanes.ForceY = Batch.ForceY.GetData();
+	Lanes.ForceZ = Batch.ForceZ.GetData();
+	Lanes.AccelerationX = Batch.AccelerationX.GetData();
+	Lanes.AccelerationY = Batch.AccelerationY.GetData();
+	Lanes.AccelerationZ = Batch.AccelerationZ.GetData();
+	Lanes.TorqueX = Batch.TorqueX.GetData();
+	Lanes.TorqueY = Batch.TorqueY.GetData();
+	Lanes.TorqueZ = Batch.TorqueZ.GetData();
+	Lanes.InclinationTangents = Batch.InclinationTangents.GetData();
+	Lanes.TiltTangents = Batch.TiltTangents.GetData();
+	Lanes.RollErrors = Batch.RollErrors.GetData();
+	Lanes.RollErrorCosines = Batch.RollErrorCosines.GetData();
+
+	ComputeLanes(Lanes, Batch.Params);
+}
+
+void FHeliFlightModel::Integrate(FHeliFlightBodyState& State, const FHeliFlightForces& Forces, const FHeliFlightParams& Params, float DeltaTime)
+{
+	const float InvMass = State.Mass > KINDA_SMALL_NUMBER ? 1.f / State.Mass : 0.f;
+
+	const FVector LinearAcceleration = Forces.Force * InvMass + Forces.Acceleration + FVector(0.f, 0.f, Params.GravityZ);
+	const FVector AngularAcceleration = Params.bAccelChange ? Forces.Torque : Forces.Torque * InvMass;
+
+	IntegrateAccelerations(State, LinearAcceleration, AngularAcceleration, Params, DeltaTime);
+}
+
+void FHeliFlightModel::IntegrateBodyForce(FHeliFlightBodyState& State, const FVector& Force, const FVector& Torque, const FHeliFlightParams& Params, float DeltaTime)
+{
+	const float InvMass = State.Mass > KINDA_SMALL_NUMBER ? 1.f / State.Mass : 0.f;
+
+	// AddForce is never an acceleration, AddTorqueInRadians is one when bAccelChange is set
+	const FVector LinearAcceleration = Force * InvMass + FVector(0.f, 0.f, Params.GravityZ);
+	const FVector AngularAcceleration = Params.bAccelChange ? Torque : Torque * InvMass;
+
+	IntegrateAccelerations(State, LinearAcceleration, AngularAcceleration, Params, DeltaTime);
+}
+
+void FHeliFlightModel::IntegrateAccelerations(FHeliFlightBodyState& State, const FVector& LinearAcceleration, const FVector& AngularAcceleration, const FHeliFlightParams& Params, float DeltaTime)
+{
+	State.LinearVelocity += LinearAcceleration * DeltaTime;
+	State.AngularVelocity += FMath::RadiansToDegrees(AngularAcceleration) * DeltaTime;
+
+	// damped the way the physics engine damps a rigid body
+	State.LinearVelocity *= FMath::Max(1.f - Params.LinearDamping * DeltaTime, 0.f);
+	State.AngularVelocity *= FMath::Max(1.f - Params.AngularDamping * DeltaTime, 0.f);
+
+	State.Location += State.LinearVelocity * DeltaTime;
+
+	// angular velocity is around world axes
+	const FVector RotationAxisAngle = FMath::DegreesToRadians(State.AngularVelocity) * DeltaTime;
+	const float Angle = RotationAxisAngle.Size();
+	if (Angle > KINDA_SMALL_NUMBER)
+	{
+		State.Rotation = FQuat(RotationAxisAngle / Angle, Angle) * State.Rotation;
+		State.Rotation.Normalize();
+	}
+}
+
+FVector FHeliFlightModel::ComputeBodyForce(const FVector& Force, const FVector& Acceleration, float Mass)
+{
+	return Force + Acceleration * Mass;
+}
+
+float FHeliFlightModel::ComputeSubstepWeight(float DeltaTime, float FlightStepRate, int32 MaxFlightSteps, float& OutNumSteps)
+{
+	const float FlightStep = 1.f / FMath::Max(FlightStepRate, 1.f);
+
+	// every substep flies its whole time, rounding it to whole flight steps made the forces pulse on short substeps.
+	// A hitch never turns into a burst of steps, the time over the budget is dropped
+	const float FlownTime = FMath::Min(DeltaTime, FlightStep * FMath::Max(MaxFlightSteps, 1));
+	OutNumSteps = FlownTime / FlightStep;
+
+	return DeltaTime > 0.f ? FlownTime / DeltaTime : 0.f;
+}
+
+void FHeliFlightModel::Step(FHeliFlightBodyState& State, const FHeliFlightInput& Input, const FHeliFlightParams& Params, float DeltaTime)
+{
+	FHeliFlightForces Forces;
+	ComputeForces(State, Input, Params, Forces);
+
+	Integrate(State, Forces, Params, DeltaTime);
+}
+
+FHeliFlightBenchmarkResult FHeliFlightModel::RunBenchmark(int32 NumHelicopters, int32 NumSteps, float DeltaTime)
+{
+	NumHelicopters = FMath::Max(NumHelicopters, 1);
+	NumSteps = FMath::Max(NumSteps, 1);
+
+	// some wind so it is part of what is measured, damped like AHelicopter damps its body
+	FHeliFlightParams Params;
+	Params.WindResponse = 0.4f;
+	Params.LinearDamping = 0.4f;
+	Params.RotorWashTurbulenceScale = 2.f;
+
+	TArray<FHeliFlightBodyState> States;
+	States.SetNum(NumHelicopters);
+
+	FRandomStream RandomStream(NumHelicopters);
+	for (FHeliFlightBodyState& State : States)
+	{
+		State.Location = RandomStream.GetUnitVector() * 100000.f;
+		State.Rotation = FRotator(RandomStream.FRandRange(-30.f, 30.f), RandomStream.FRandRange(-180.f, 180.f), RandomStream.FRandRange(-30.f, 30.f)).Quaternion();
+		State.Wind.Velocity = RandomStream.GetUnitVector() * 500.f;
+		State.Wind.Turbulence = RandomStream.GetUnitVector() * 100.f;
+		State.Wind.GroundProximity = RandomStream.FRand();
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+	{
+		for (int32 Index = 0; Index < NumHelicopters; ++Index)
+		{
+			// cheap but different input for every helicopter and step
+			const float Phase = (StepIndex + Index) * 0.05f;
+
+			FHeliFlightInput Input;
+			Input.Pitch = FMath::Sin(Phase);
+			Input.Yaw = FMath::Cos(Phase * 0.5f);
+			Input.Roll = FMath::Sin(Phase * 0.25f);
+			Input.Thrust = FMath::Cos(Phase * 0.125f);
+			Input.bAutoRollStabilization = (Index & 1) != 0;
+
+			Step(States[Index], Input, Params, DeltaTime);
+		}
+	}
+
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+
+	// force computation alone, one helicopter at a time and batched
+	FHeliFlightBatch Batch;
+	Batch.Params = Params;
+	Batch.SetNum(NumHelicopters);
+
+	TArray<FHeliFlightInput> Inputs;
+	Inputs.SetNum(NumHelicopters);
+
+	for (int32 Index = 0; Index < NumHelicopters; ++Index)
+	{
+		FHeliFlightInput& Input = Inputs[Index];
+		Input.Pitch = FMath::Sin(Index * 0.05f);
+		Input.Thrust = 1.f;
+		Input.bAutoRollStabilization = (Index & 1) != 0;
+
+		Batch.SetBody(Index, States[Index].Rotation, States[Index].AngularVelocity, States[Index].Mass, Input, States[Index].Wind);
+	}
+
+	const double ScalarStartTime = FPlatformTime::Seconds();
+	for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+	{
+		for (int32 Index = 0; Index < NumHelicopters; ++Index)
+		{
+			FHeliFlightForces Forces;
+			ComputeForces(States[Index], Inputs[Index], Params, Forces);
+			Batch.ForceX[Index] = Forces.Force.X;
+		}
+	}
+	const double ScalarSeconds = FPlatformTime::Seconds() - ScalarStartTime;
+
+	const double BatchStartTime = FPlatformTime::Seconds();
+	for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+	{
+		ComputeForcesBatch(Batch);
+	}
+	const double BatchSeconds = FPlatformTime::Seconds() - BatchStartTime;
+
+	FHeliFlightBenchmarkResult Result;
+
+	// keeps the compiler from throwing the simulation away
+	for (const FHeliFlightBodyState& State : States)
+	{
+		Result.Checksum += State.Location;
+	}
+
+	const double NumBodySteps = static_cast<double>(NumHelicopters) * NumSteps;
+
+	Result.StepTime = ElapsedSeconds * 1.0e9 / NumBodySteps;
+	Result.ForcesTime = ScalarSeconds * 1.0e9 / NumBodySteps;
+	Result.BatchedForcesTime = BatchSeconds * 1.0e9 / NumBodySteps;
+
+	UE_LOG(LogHeliFlight, Log, TEXT("FlightModel benchmark: %d helicopters x %d steps in %.3f ms, %.1f ns per step (checksum %s)"),
+		NumHelicopters, NumSteps, ElapsedSeconds * 1000.0, Result.StepTime, *Result.Checksum.ToString());
+
+	UE_LOG(LogHeliFlight, Log, TEXT("FlightModel benchmark: forces %.1f ns per helicopter, batched %.1f ns per helicopter"),
+		Result.ForcesTime, Result.BatchedForcesTime);
+
+	return Result;
+}
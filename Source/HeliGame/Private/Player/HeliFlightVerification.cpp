@@ -0,0 +1,477 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliFlightVerification.h"
+#include "HeliGame.h"
+#include "HeliWindField.h"
+
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/Package.h"
+
+namespace
+{
+	/* bump when the layout of a recording changes, older files are refused */
+	const int32 HeliFlightRecordingVersion = 3;
+
+	/* a recording bigger than this is a corrupt file */
+	const int32 MaxRecordingFrames = 1 << 20;
+
+	template<typename T>
+	bool IsBitwiseEqual(const T& A, const T& B)
+	{
+		return FMemory::Memcmp(&A, &B, sizeof(T)) == 0;
+	}
+
+	FString GetRecordingPath(const FString& Name)
+	{
+		return FPaths::ProjectSavedDir() / TEXT("FlightVerification") / Name + TEXT(".flight");
+	}
+
+	/* one body through the batched path, exactly as AHeliFlightManager feeds it */
+	void ComputeForcesBatched(const FHeliFlightBodyState& State, const FHeliFlightInput& Input, const FHeliFlightParams& Params, FHeliFlightBatch& Batch, FHeliFlightForces& OutForces)
+	{
+		Batch.Params = Params;
+		Batch.SetNum(1);
+		Batch.SetBody(0, State.Rotation, State.AngularVelocity, State.Mass, Input, State.Wind);
+
+		FHeliFlightModel::ComputeForcesBatch(Batch);
+
+		Batch.GetForces(0, OutForces);
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FHeliFlightRecording& Recording)
+{
+	int32 Version = HeliFlightRecordingVersion;
+	Ar << Version;
+	if (Ar.IsLoading() && Version != HeliFlightRecordingVersion)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	FHeliFlightBodyState& State = Recording.InitialState;
+	Ar << State.Location << State.Rotation << State.LinearVelocity << State.AngularVelocity << State.Mass;
+	Ar << State.Wind.Velocity << State.Wind.Turbulence << State.Wind.GroundProximity;
+
+	FHeliFlightParams& Params = Recording.Params;
+	Ar << Params.GravityZ << Params.GravityWeight << Params.MinimumTiltInclinationAcceleration << Params.BaseThrust << Params.MaximumAngularVelocity;
+	Ar << Params.AutoRollProportionalGain << Params.AutoRollDerivativeGain << Params.MaxAutoRollRate << Params.MaxAutoRollTorque;
+	Ar << Params.WindResponse << Params.RotorWashTurbulenceScale << Params.LinearDamping << Params.AngularDamping << Params.bAddLift << Params.bAccelChange;
+
+	Ar << Recording.DeltaTime;
+
+	Ar << Recording.WindOrigin << Recording.WindCellSize << Recording.WindDimensions;
+
+	int32 NumWinds = Recording.WindGrid.Num();
+	int32 NumInputs = Recording.Inputs.Num();
+	int32 NumStates = Recording.States.Num();
+	Ar << NumWinds << NumInputs << NumStates;
+
+	if (Ar.IsLoading())
+	{
+		if (NumWinds < 0 || NumWinds > MaxRecordingFrames || NumInputs < 0 || NumInputs > MaxRecordingFrames || NumStates < 0 || NumStates > MaxRecordingFrames)
+		{
+			Ar.SetError();
+			return Ar;
+		}
+
+		Recording.WindGrid.SetNum(NumWinds);
+		Recording.Inputs.SetNum(NumInputs);
+		Recording.States.SetNum(NumStates);
+	}
+
+	for (FHeliFlightWind& Wind : Recording.WindGrid)
+	{
+		Ar << Wind.Velocity << Wind.Turbulence << Wind.GroundProximity;
+	}
+
+	for (FHeliFlightInput& Input : Recording.Inputs)
+	{
+		Ar << Input.Pitch << Input.Yaw << Input.Roll << Input.Thrust << Input.bAutoRollStabilization;
+	}
+
+	// full precision, not the bit packed net format: we compare bits
+	for (FMovementState& MovementState : Recording.States)
+	{
+		Ar << static_cast<FVector&>(MovementState.Location) << MovementState.Rotation;
+		Ar << static_cast<FVector&>(MovementState.LinearVelocity) << static_cast<FVector&>(MovementState.AngularVelocity);
+		Ar << MovementState.Timestamp;
+	}
+
+	return Ar;
+}
+
+void FHeliFlightVerification::GenerateInputs(int32 Seed, int32 NumFrames, TArray<FHeliFlightInput>& OutInputs)
+{
+	FRandomStream RandomStream(Seed);
+
+	OutInputs.SetNum(FMath::Max(NumFrames, 0));
+
+	FHeliFlightInput Input;
+	FHeliFlightInput TargetInput;
+	int32 FramesToHold = 0;
+
+	for (FHeliFlightInput& OutInput : OutInputs)
+	{
+		if (--FramesToHold <= 0)
+		{
+			TargetInput.Pitch = RandomStream.FRandRange(-1.f, 1.f);
+			TargetInput.Yaw = RandomStream.FRandRange(-1.f, 1.f);
+			TargetInput.Roll = RandomStream.FRandRange(-1.f, 1.f);
+			TargetInput.Thrust = RandomStream.FRandRange(-0.5f, 1.f);
+			TargetInput.bAutoRollStabilization = RandomStream.FRand() < 0.5f;
+			FramesToHold = RandomStream.RandRange(30, 240);
+		}
+
+		// sticks take a few frames to get there, auto roll is a switch
+		Input.Pitch = FMath::Lerp(Input.Pitch, TargetInput.Pitch, 0.1f);
+		Input.Yaw = FMath::Lerp(Input.Yaw, TargetInput.Yaw, 0.1f);
+		Input.Roll = FMath::Lerp(Input.Roll, TargetInput.Roll, 0.1f);
+		Input.Thrust = FMath::Lerp(Input.Thrust, TargetInput.Thrust, 0.1f);
+		Input.bAutoRollStabilization = TargetInput.bAutoRollStabilization;
+
+		OutInput = Input;
+	}
+}
+
+void FHeliFlightVerification::GenerateWindGrid(int32 Seed, const FVector& Location, FHeliFlightRecording& Recording)
+{
+	FRandomStream RandomStream(Seed);
+
+	// a few seconds of flight cross a cell or two in any direction
+	Recording.WindCellSize = 2000.f;
+	Recording.WindDimensions = FIntVector(4, 4, 3);
+	Recording.WindOrigin = Location - FVector(1.5f, 1.5f, 1.f) * Recording.WindCellSize;
+
+	Recording.WindGrid.SetNum(Recording.WindDimensions.X * Recording.WindDimensions.Y * Recording.WindDimensions.Z);
+
+	for (int32 Index = 0; Index < Recording.WindGrid.Num(); ++Index)
+	{
+		const int32 Z = Index / (Recording.WindDimensions.X * Recording.WindDimensions.Y);
+
+		FHeliFlightWind& Wind = Recording.WindGrid[Index];
+		Wind.Velocity = RandomStream.GetUnitVector() * RandomStream.FRandRange(200.f, 500.f);
+		Wind.Turbulence = RandomStream.GetUnitVector() * RandomStream.FRandRange(20.f, 100.f);
+
+		// the lowest layer sits on the ground
+		Wind.GroundProximity = 1.f - static_cast<float>(Z) / (Recording.WindDimensions.Z - 1);
+	}
+}
+
+UHeliWindField* FHeliFlightVerification::CreateWindField(const FHeliFlightRecording& Recording)
+{
+	if (Recording.WindGrid.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	UHeliWindField* WindField = NewObject<UHeliWindField>(GetTransientPackage());
+	WindField->Store(Recording.WindOrigin, Recording.WindCellSize, Recording.WindDimensions, Recording.WindGrid);
+
+	return WindField->IsValidField() ? WindField : nullptr;
+}
+
+FMovementState FHeliFlightVerification::ToMovementState(const FHeliFlightBodyState& State, float Timestamp)
+{
+	return FMovementState(State.Location, State.Rotation.Rotator(), State.LinearVelocity, State.AngularVelocity, Timestamp);
+}
+
+void FHeliFlightVerification::Simulate(const FHeliFlightRecording& Recording, const UHeliWindField* WindField, bool bBatched, int32 NumSubsteps, TArray<FMovementState>& OutStates)
+{
+	const int32 NumFrames = Recording.Inputs.Num();
+	const FHeliFlightParams& Params = Recording.Params;
+
+	OutStates.Reset(NumFrames);
+
+	FHeliFlightBodyState State = Recording.InitialState;
+	FHeliFlightBatch Batch;
+
+	// the recording steps at the flight rate, a substep never flies more than one flight step
+	const float SubstepTime = NumSubsteps > 0 ? Recording.DeltaTime / NumSubsteps : Recording.DeltaTime;
+	const float FlightStepRate = 1.f / Recording.DeltaTime;
+
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const FHeliFlightInput& Input = Recording.Inputs[Frame];
+
+		for (int32 Substep = 0; Substep < FMath::Max(NumSubsteps, 1); ++Substep)
+		{
+			// the substep callbacks read the body back every substep, so do we, wind included
+			if (WindField)
+			{
+				State.Wind = WindField->Sample(State.Location, Frame * Recording.DeltaTime + Substep * SubstepTime);
+			}
+
+			FHeliFlightForces Forces;
+			if (bBatched)
+			{
+				ComputeForcesBatched(State, Input, Params, Batch, Forces);
+			}
+			else
+			{
+				FHeliFlightModel::ComputeForces(State, Input, Params, Forces);
+			}
+
+			if (NumSubsteps <= 0)
+			{
+				FHeliFlightModel::Integrate(State, Forces, Params, Recording.DeltaTime);
+				continue;
+			}
+
+			float NumSteps = 0.f;
+			const float StepWeight = FHeliFlightModel::ComputeSubstepWeight(SubstepTime, FlightStepRate, 1, NumSteps);
+			const FVector Force = FHeliFlightModel::ComputeBodyForce(Forces.Force, Forces.Acceleration, State.Mass);
+
+			FHeliFlightModel::IntegrateBodyForce(State, Force * StepWeight, Forces.Torque * StepWeight, Params, SubstepTime);
+		}
+
+		OutStates.Add(ToMovementState(State, (Frame + 1) * Recording.DeltaTime));
+	}
+}
+
+FHeliFlightDivergence FHeliFlightVerification::Compare(const TArray<FMovementState>& Expected, const TArray<FMovementState>& Actual)
+{
+	FHeliFlightDivergence Divergence;
+
+	const int32 NumFrames = FMath::Min(Expected.Num(), Actual.Num());
+
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const FMovementState& A = Expected[Frame];
+		const FMovementState& B = Actual[Frame];
+
+		const TCHAR* Field = nullptr;
+		if (!IsBitwiseEqual<FVector>(A.Location, B.Location))
+		{
+			Field = TEXT("Location");
+		}
+		else if (!IsBitwiseEqual(A.Rotation, B.Rotation))
+		{
+			Field = TEXT("Rotation");
+		}
+		else if (!IsBitwiseEqual<FVector>(A.LinearVelocity, B.LinearVelocity))
+		{
+			Field = TEXT("LinearVelocity");
+		}
+		else if (!IsBitwiseEqual<FVector>(A.AngularVelocity, B.AngularVelocity))
+		{
+			Field = TEXT("AngularVelocity");
+		}
+		else if (!IsBitwiseEqual(A.Timestamp, B.Timestamp))
+		{
+			Field = TEXT("Timestamp");
+		}
+
+		if (!Field)
+		{
+			continue;
+		}
+
+		if (Divergence.Frame == INDEX_NONE)
+		{
+			Divergence.Frame = Frame;
+			Divergence.Field = Field;
+		}
+
+		Divergence.NumDivergentFrames++;
+		Divergence.MaxLocationError = FMath::Max(Divergence.MaxLocationError, FVector::Dist(A.Location, B.Location));
+		Divergence.MaxRotationError = FMath::Max(Divergence.MaxRotationError, FMath::RadiansToDegrees(A.Rotation.Quaternion().AngularDistance(B.Rotation.Quaternion())));
+		Divergence.MaxLinearVelocityError = FMath::Max(Divergence.MaxLinearVelocityError, FVector::Dist(A.LinearVelocity, B.LinearVelocity));
+		Divergence.MaxAngularVelocityError = FMath::Max(Divergence.MaxAngularVelocityError, FVector::Dist(A.AngularVelocity, B.AngularVelocity));
+	}
+
+	// a stream that stops early diverges where the shorter one ends
+	if (Expected.Num() != Actual.Num())
+	{
+		Divergence.NumDivergentFrames += FMath::Abs(Expected.Num() - Actual.Num());
+		if (Divergence.Frame == INDEX_NONE)
+		{
+			Divergence.Frame = NumFrames;
+			Divergence.Field = TEXT("length");
+		}
+	}
+
+	return Divergence;
+}
+
+void FHeliFlightVerification::FindFirstDivergentTerm(const FHeliFlightRecording& Recording, const UHeliWindField* WindField, int32& OutFrame, const TCHAR*& OutTerm)
+{
+	OutFrame = INDEX_NONE;
+	OutTerm = TEXT("");
+
+	const FHeliFlightParams& Params = Recording.Params;
+
+	FHeliFlightBodyState State = Recording.InitialState;
+	FHeliFlightBatch Batch;
+
+	for (int32 Frame = 0; Frame < Recording.Inputs.Num(); ++Frame)
+	{
+		const FHeliFlightInput& Input = Recording.Inputs[Frame];
+
+		if (WindField)
+		{
+			State.Wind = WindField->Sample(State.Location, Frame * Recording.DeltaTime);
+		}
+
+		// both paths get the very same state, whatever differs is the math and not the history
+		FHeliFlightForces Forces;
+		FHeliFlightForces BatchedForces;
+		FHeliFlightModel::ComputeForces(State, Input, Params, Forces);
+		ComputeForcesBatched(State, Input, Params, Batch, BatchedForces);
+
+		if (!IsBitwiseEqual(Forces.Force, BatchedForces.Force))
+		{
+			OutTerm = Params.bAccelChange ? TEXT("ComputeLift") : TEXT("ComputeLift or ComputeThrust");
+		}
+		else if (!IsBitwiseEqual(Forces.Acceleration, BatchedForces.Acceleration))
+		{
+			OutTerm = Params.bAccelChange ? TEXT("ComputeThrust or ComputeWindAcceleration") : TEXT("ComputeWindAcceleration");
+		}
+		else if (!IsBitwiseEqual(Forces.Torque, BatchedForces.Torque))
+		{
+			OutTerm = TEXT("ComputeTorque");
+
+			// pilot torque alone tells whether auto roll is the one that differs
+			if (Input.bAutoRollStabilization)
+			{
+				FHeliFlightInput PilotInput = Input;
+				PilotInput.bAutoRollStabilization = false;
+
+				FHeliFlightModel::ComputeForces(State, PilotInput, Params, Forces);
+				ComputeForcesBatched(State, PilotInput, Params, Batch, BatchedForces);
+
+				if (IsBitwiseEqual(Forces.Torque, BatchedForces.Torque))
+				{
+					OutTerm = TEXT("ComputeAutoRollTorque");
+				}
+			}
+		}
+
+		if (OutTerm[0] != 0)
+		{
+			OutFrame = Frame;
+			return;
+		}
+
+		FHeliFlightModel::Integrate(State, Forces, Params, Recording.DeltaTime);
+	}
+}
+
+bool FHeliFlightVerification::SaveRecording(const FString& Name, FHeliFlightRecording& Recording)
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Writer << Recording;
+
+	return FFileHelper::SaveArrayToFile(Data, *GetRecordingPath(Name));
+}
+
+bool FHeliFlightVerification::LoadRecording(const FString& Name, FHeliFlightRecording& OutRecording)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *GetRecordingPath(Name), FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	Reader << OutRecording;
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogHeliFlight, Warning, TEXT("FlightVerification: %s is not a recording of this version"), *GetRecordingPath(Name));
+		return false;
+	}
+
+	return true;
+}
+
+void FHeliFlightVerification::LogDivergence(const TCHAR* Label, const FHeliFlightDivergence& Divergence, int32 NumFrames)
+{
+	if (Divergence.IsDeterministic())
+	{
+		UE_LOG(LogHeliFlight, Log, TEXT("FlightVerification: %s identical for all %d frames"), Label, NumFrames);
+		return;
+	}
+
+	UE_LOG(LogHeliFlight, Warning, TEXT("FlightVerification: %s diverge at frame %d (%s), %d of %d frames differ"),
+		Label, Divergence.Frame, Divergence.Field, Divergence.NumDivergentFrames, NumFrames);
+
+	UE_LOG(LogHeliFlight, Warning, TEXT("FlightVerification: drift up to %.4f cm, %.4f deg, %.4f cm/s, %.4f deg/s"),
+		Divergence.MaxLocationError, Divergence.MaxRotationError, Divergence.MaxLinearVelocityError, Divergence.MaxAngularVelocityError);
+}
+
+bool FHeliFlightVerification::Run(int32 NumFrames, int32 Seed, const FString& RecordingName, int32 NumSubsteps)
+{
+	FHeliFlightRecording Recording;
+
+	const bool bReplay = !RecordingName.IsEmpty() && LoadRecording(RecordingName, Recording);
+	if (!bReplay)
+	{
+		FRandomStream RandomStream(Seed);
+		Recording.InitialState.Location = RandomStream.GetUnitVector() * 10000.f;
+		Recording.InitialState.Rotation = FRotator(RandomStream.FRandRange(-20.f, 20.f), RandomStream.FRandRange(-180.f, 180.f), RandomStream.FRandRange(-20.f, 20.f)).Quaternion();
+
+		// through a wind field, so sampling it is flown too
+		GenerateWindGrid(Seed, Recording.InitialState.Location, Recording);
+		Recording.Params.WindResponse = 0.4f;
+		Recording.Params.LinearDamping = 0.4f;
+		Recording.Params.RotorWashTurbulenceScale = 2.f;
+
+		GenerateInputs(Seed, FMath::Max(NumFrames, 1), Recording.Inputs);
+	}
+
+	const int32 NumRecordedFrames = Recording.Inputs.Num();
+
+	// both instances sample the very same field, as server and clients load the same asset
+	const UHeliWindField* WindField = CreateWindField(Recording);
+
+	// instance one flies like a predicting client, instance two like the server
+	TArray<FMovementState> States;
+	TArray<FMovementState> BatchedStates;
+	Simulate(Recording, WindField, false, 0, States);
+	Simulate(Recording, WindField, true, 0, BatchedStates);
+
+	const FHeliFlightDivergence Divergence = Compare(States, BatchedStates);
+	LogDivergence(TEXT("per body and batched flight"), Divergence, NumRecordedFrames);
+
+	// what the physics engine is actually given on either machine
+	TArray<FMovementState> SubstepStates;
+	TArray<FMovementState> BatchedSubstepStates;
+	Simulate(Recording, WindField, false, FMath::Max(NumSubsteps, 1), SubstepStates);
+	Simulate(Recording, WindField, true, FMath::Max(NumSubsteps, 1), BatchedSubstepStates);
+
+	const FHeliFlightDivergence SubstepDivergence = Compare(SubstepStates, BatchedSubstepStates);
+	LogDivergence(*FString::Printf(TEXT("per body and batched flight over %d substeps"), FMath::Max(NumSubsteps, 1)), SubstepDivergence, NumRecordedFrames);
+
+	bool bDeterministic = Divergence.IsDeterministic() && SubstepDivergence.IsDeterministic();
+
+	int32 TermFrame = INDEX_NONE;
+	const TCHAR* Term = nullptr;
+	FindFirstDivergentTerm(Recording, WindField, TermFrame, Term);
+	if (TermFrame != INDEX_NONE)
+	{
+		UE_LOG(LogHeliFlight, Warning, TEXT("FlightVerification: %s is the first to differ between both paths, frame %d, same body state"), Term, TermFrame);
+	}
+
+	if (bReplay)
+	{
+		const FHeliFlightDivergence RecordingDivergence = Compare(Recording.States, States);
+		LogDivergence(*FString::Printf(TEXT("recording %s and this build"), *RecordingName), RecordingDivergence, NumRecordedFrames);
+
+		bDeterministic &= RecordingDivergence.IsDeterministic();
+	}
+	else if (!RecordingName.IsEmpty())
+	{
+		Recording.States = States;
+		if (SaveRecording(RecordingName, Recording))
+		{
+			UE_LOG(LogHeliFlight, Log, TEXT("FlightVerification: %d frames recorded to %s"), NumRecordedFrames, *GetRecordingPath(RecordingName));
+		}
+	}
+
+	return bDeterministic;
+}
@@ -0,0 +1,132 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliLagCompensation.h"
+#include "HeliGame.h"
+#include "HeliFighterVehicle.h"
+#include "HeliPlayerController.h"
+
+#include "GameFramework/Controller.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Components/PrimitiveComponent.h"
+#include "CollisionQueryParams.h"
+#include "Public/EngineUtils.h"
+#include "Engine/World.h"
+
+void FHeliLagCompensationStats::Reset()
+{
+	NumQueries = 0;
+	NumTracedVehicles = 0;
+	TotalQuerySeconds = 0.0;
+	MaxQuerySeconds = 0.0;
+	TotalRewindTime = 0.f;
+}
+
+void FHeliLagCompensationStats::Log() const
+{
+	UE_LOG(LogHeliNet, Log, TEXT("LagCompensation: %d queries, %d vehicles traced, avg rewind %.1f ms, avg query %.3f ms, max query %.3f ms"),
+		NumQueries,
+		NumTracedVehicles,
+		NumQueries > 0 ? TotalRewindTime / NumQueries * 1000.f : 0.f,
+		NumQueries > 0 ? TotalQuerySeconds / NumQueries * 1000.0 : 0.0,
+		MaxQuerySeconds * 1000.0);
+}
+
+FHeliLagCompensationStats& FHeliLagCompensationStats::Get()
+{
+	static FHeliLagCompensationStats Stats;
+	return Stats;
+}
+
+float FHeliLagCompensation::GetShooterViewTime(UWorld* World, AController* Shooter)
+{
+	const float Now = World->GetTimeSeconds();
+
+	// bots and the listen server host see the world as it is
+	AHeliPlayerController* PlayerController = Cast<AHeliPlayerController>(Shooter);
+	if (!PlayerController || PlayerController->IsLocalController() || !PlayerController->PlayerState)
+	{
+		return Now;
+	}
+
+	const float RoundTripTime = PlayerController->PlayerState->ExactPing / 1000.f;
+
+	// vehicles won't go back further than their MaxRewindTime, see AHeliFighterVehicle::GetHistoricalTransform
+	return Now - RoundTripTime - PlayerController->GetReportedProxyViewDelay();
+}
+
+bool FHeliLagCompensation::LineTraceVehicles(UWorld* World, AController* Shooter, const FVector& Start, const FVector& End, const FCollisionQueryParams& Params, FHitResult& OutHit)
+{
+	OutHit = FHitResult(1.f);
+	if (!World)
+	{
+		return false;
+	}
+
+	const double QueryStartTime = FPlatformTime::Seconds();
+	const float Now = World->GetTimeSeconds();
+	const float ViewTime = GetShooterViewTime(World, Shooter);
+
+	const APawn* ShooterPawn = Shooter ? Shooter->GetPawn() : nullptr;
+	int32 NumTestedVehicles = 0;
+	bool bHit = false;
+
+	for (TActorIterator<AHeliFighterVehicle> It(World); It; ++It)
+	{
+		AHeliFighterVehicle* Vehicle = *It;
+		UPrimitiveComponent* HitZones = Cast<UPrimitiveComponent>(Vehicle->GetRootComponent());
+		if (Vehicle == ShooterPawn || !Vehicle->IsAlive() || !HitZones || Params.GetIgnoredActors().Contains(Vehicle->GetUniqueID()))
+		{
+			continue;
+		}
+
+		const FTransform CurrentTransform = Vehicle->GetActorTransform();
+		FTransform HistoricalTransform = CurrentTransform;
+		if (ViewTime < Now)
+		{
+			Vehicle->GetHistoricalTransform(ViewTime, HistoricalTransform);
+		}
+
+		// bounds are where the vehicle is now, moved back to where it was
+		const FVector HistoricalBoundsOrigin = HistoricalTransform.TransformPosition(CurrentTransform.InverseTransformPosition(HitZones->Bounds.Origin));
+		if (FMath::PointDistToSegmentSquared(HistoricalBoundsOrigin, Start, End) > FMath::Square(HitZones->Bounds.SphereRadius))
+		{
+			continue;
+		}
+
+		NumTestedVehicles++;
+
+		// same place relative to the vehicle, in its current frame
+		const FVector CurrentStart = CurrentTransform.TransformPosition(HistoricalTransform.InverseTransformPosition(Start));
+		const FVector CurrentEnd = CurrentTransform.TransformPosition(HistoricalTransform.InverseTransformPosition(End));
+
+		FHitResult VehicleHit;
+		if (!HitZones->LineTraceComponent(VehicleHit, CurrentStart, CurrentEnd, Params) || VehicleHit.Time >= OutHit.Time)
+		{
+			continue;
+		}
+
+		// and back to where the shooter saw it
+		VehicleHit.Location = HistoricalTransform.TransformPosition(CurrentTransform.InverseTransformPosition(VehicleHit.Location));
+		VehicleHit.ImpactPoint = HistoricalTransform.TransformPosition(CurrentTransform.InverseTransformPosition(VehicleHit.ImpactPoint));
+		VehicleHit.Normal = HistoricalTransform.TransformVectorNoScale(CurrentTransform.InverseTransformVectorNoScale(VehicleHit.Normal));
+		VehicleHit.ImpactNormal = HistoricalTransform.TransformVectorNoScale(CurrentTransform.InverseTransformVectorNoScale(VehicleHit.ImpactNormal));
+		VehicleHit.TraceStart = Start;
+		VehicleHit.TraceEnd = End;
+		VehicleHit.Actor = Vehicle;
+		VehicleHit.Component = HitZones;
+
+		OutHit = VehicleHit;
+		bHit = true;
+	}
+
+	FHeliLagCompensationStats& Stats = FHeliLagCompensationStats::Get();
+	const double QuerySeconds = FPlatformTime::Seconds() - QueryStartTime;
+	Stats.NumQueries++;
+	Stats.NumTracedVehicles += NumTestedVehicles;
+	Stats.TotalRewindTime += Now - ViewTime;
+	Stats.TotalQuerySeconds += QuerySeconds;
+	Stats.MaxQuerySeconds = FMath::Max(Stats.MaxQuerySeconds, QuerySeconds);
+
+	return bHit;
+}
@@ -3,13 +3,317 @@
 #include "HeliMoveComp.h"
 #include "HeliGame.h"
 #include "HeliGameUserSettings.h"
+#include "HeliPlayerController.h"
+#include "HeliMovementReplicator.h"
+#include "HeliFlightManager.h"
+#include "HeliWindField.h"
+#include "HeliWindVolume.h"
+#include "Helicopter.h"
 
 #include "Components/PrimitiveComponent.h"
 #include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/PackageMapClient.h"
+#include "Engine/NetConnection.h"
 #include "Net/UnrealNetwork.h"
 #include "Public/Engine.h"
+#include "Public/EngineUtils.h"
 #include "DrawDebugHelpers.h"
 
+/*
+	Movement state bit packing
+*/
+
+// bounds of the flight model, anything above is clamped before sending
+static const float MovementStateMaxLinearSpeed = 16384.f;	// cm/s
+static const float MovementStateMaxAngularSpeed = 1024.f;	// deg/s
+static const int32 MovementStateMaxLocationBits = 24;		// +-83km at 1 cm
+
+// precision at the closest tier, every tier further away doubles the steps
+static const float MovementStateLocationStep = 1.f;			// cm
+static const float MovementStateLinearVelocityStep = 0.5f;	// cm/s
+static const float MovementStateAngularVelocityStep = 0.125f;	// deg/s
+static const int32 MovementStateQuatComponentBits = 11;		// ~0.08 degrees, one bit less every two tiers
+
+// receivers closer than this get full precision, then one tier every time the distance doubles
+static const float MovementStateFullPrecisionDistance = 5000.f;
+static const uint8 MovementStateMaxPrecisionTier = 6;
+// helicopters behind the viewer get one tier coarser
+static const float MovementStateInViewCosAngle = 0.5f;
+
+static uint8 GetMovementStatePrecisionTier(const FVector& WorldLocation, UPackageMap* Map)
+{
+	UPackageMapClient* PackageMapClient = Cast<UPackageMapClient>(Map);
+	UNetConnection* Connection = PackageMapClient ? PackageMapClient->GetConnection() : nullptr;
+	APlayerController* Viewer = Connection ? Connection->PlayerController : nullptr;
+
+	if (!Viewer)
+	{
+		return 0;
+	}
+
+	// where the camera is and looks at, the control rotation lags behind spectating and third person cameras
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Viewer->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	const FVector ToTarget = WorldLocation - ViewLocation;
+	const float Distance = ToTarget.Size();
+
+	// log2 makes precision ramp up smoothly as the target closes in
+	int32 Tier = Distance > MovementStateFullPrecisionDistance ? FMath::FloorToInt(FMath::Log2(Distance / MovementStateFullPrecisionDistance)) + 1 : 0;
+
+	const FVector ViewDirection = ViewRotation.Vector();
+	if (Distance > MovementStateFullPrecisionDistance && FVector::DotProduct(ViewDirection, ToTarget / Distance) < MovementStateInViewCosAngle)
+	{
+		Tier++;
+	}
+
+	return static_cast<uint8>(FMath::Clamp<int32>(Tier, 0, MovementStateMaxPrecisionTier));
+}
+
+static void SerializeScaledVector(FVector& Vector, float Step, FArchive& Ar, bool& bOutSuccess)
+{
+	FVector Scaled = Ar.IsSaving() ? Vector / Step : FVector::ZeroVector;
+	bOutSuccess &= SerializePackedVector<1, MovementStateMaxLocationBits>(Scaled, Ar);
+
+	if (Ar.IsLoading())
+	{
+		Vector = Scaled * Step;
+	}
+}
+
+static void SerializeQuatSmallestThree(FQuat& Quat, FArchive& Ar, int32 ComponentBits)
+{
+	// the largest component is never sent, the other three are within [-1/sqrt(2), 1/sqrt(2)]
+	const float ComponentRange = 0.70710678f;
+	const uint32 MaxQuantized = (1 << ComponentBits) - 1;
+
+	uint32 LargestIndex = 0;
+	uint32 Quantized[3] = { 0, 0, 0 };
+
+	if (Ar.IsSaving())
+	{
+		FQuat Normalized = Quat.GetNormalized();
+		float Components[4] = { Normalized.X, Normalized.Y, Normalized.Z, Normalized.W };
+
+		for (uint32 Index = 1; Index < 4; ++Index)
+		{
+			if (FMath::Abs(Components[Index]) > FMath::Abs(Components[LargestIndex]))
+			{
+				LargestIndex = Index;
+			}
+		}
+
+		// q and -q are the same rotation, keep the largest positive so it can be rebuilt
+		const float Sign = Components[LargestIndex] < 0.f ? -1.f : 1.f;
+
+		for (uint32 Index = 0, Out = 0; Index < 4; ++Index)
+		{
+			if (Index != LargestIndex)
+			{
+				const float Normalized01 = FMath::Clamp((Components[Index] * Sign / ComponentRange) * 0.5f + 0.5f, 0.f, 1.f);
+				Quantized[Out++] = static_cast<uint32>(FMath::RoundToInt(Normalized01 * MaxQuantized));
+			}
+		}
+	}
+
+	Ar.SerializeInt(LargestIndex, 4);
+	for (uint32 Index = 0; Index < 3; ++Index)
+	{
+		Ar.SerializeInt(Quantized[Index], MaxQuantized + 1);
+	}
+
+	if (Ar.IsLoading())
+	{
+		float Components[4];
+		float SumSquared = 0.f;
+
+		for (uint32 Index = 0, In = 0; Index < 4; ++Index)
+		{
+			if (Index != LargestIndex)
+			{
+				Components[Index] = ((static_cast<float>(Quantized[In++]) / MaxQuantized) - 0.5f) * 2.f * ComponentRange;
+				SumSquared += FMath::Square(Components[Index]);
+			}
+		}
+		Components[LargestIndex] = FMath::Sqrt(FMath::Max(0.f, 1.f - SumSquared));
+
+		Quat = FQuat(Components[0], Components[1], Components[2], Components[3]);
+		Quat.Normalize();
+	}
+}
+
+bool FMovementState::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint8 bDelta = bIsDelta ? 1 : 0;
+	Ar.SerializeBits(&bDelta, 1);
+	bIsDelta = (bDelta != 0);
+
+	uint16 WireStamp = Ar.IsSaving() ? ToWireStamp(Timestamp) : 0;
+	Ar << WireStamp;
+
+	if (bIsDelta)
+	{
+		Ar << BaselineStamp;
+	}
+
+	// chosen for the connection we are writing to, far away helicopters get coarser steps
+	uint8 PrecisionTier = Ar.IsSaving() ? GetMovementStatePrecisionTier(bIsDelta ? SenderWorldLocation : FVector(Location), Map) : 0;
+	Ar.SerializeBits(&PrecisionTier, 3);
+	PrecisionTier = FMath::Min(PrecisionTier, MovementStateMaxPrecisionTier);
+
+	const float StepScale = static_cast<float>(1 << PrecisionTier);
+
+	// deltas are usually only a few cm so the packed vector uses very few bits
+	FVector PackedLocation = Location;
+	SerializeScaledVector(PackedLocation, MovementStateLocationStep * StepScale, Ar, bOutSuccess);
+
+	FQuat Quat = Ar.IsSaving() ? Rotation.Quaternion() : FQuat::Identity;
+	SerializeQuatSmallestThree(Quat, Ar, MovementStateQuatComponentBits - PrecisionTier / 2);
+
+	FVector Linear = LinearVelocity.GetClampedToMaxSize(MovementStateMaxLinearSpeed);
+	FVector Angular = AngularVelocity.GetClampedToMaxSize(MovementStateMaxAngularSpeed);
+	SerializeScaledVector(Linear, MovementStateLinearVelocityStep * StepScale, Ar, bOutSuccess);
+	SerializeScaledVector(Angular, MovementStateAngularVelocityStep * StepScale, Ar, bOutSuccess);
+
+	if (Ar.IsLoading())
+	{
+		LinearVelocity = Linear;
+		AngularVelocity = Angular;
+		Location = PackedLocation;
+		Rotation = Quat.Rotator();
+		Stamp = WireStamp;
+		// receivers have to unwrap it against their own timeline
+		Timestamp = WireStamp / 1000.f;
+	}
+
+	return true;
+}
+
+FVector FMovementState::GetBaselineLocation(const FMovementState& Baseline) const
+{
+	// stamps are wrapped milliseconds
+	const float DeltaSeconds = static_cast<uint16>(Stamp - Baseline.Stamp) / 1000.f;
+
+	return Baseline.Location + Baseline.LinearVelocity * DeltaSeconds;
+}
+
+void FMovementState::EncodeDelta(const FMovementState& Baseline)
+{
+	SenderWorldLocation = Location;
+	Location = Location - GetBaselineLocation(Baseline);
+	BaselineStamp = Baseline.Stamp;
+	bIsDelta = true;
+}
+
+void FMovementState::DecodeDelta(const FMovementState& Baseline)
+{
+	Location = Location + GetBaselineLocation(Baseline);
+	bIsDelta = false;
+}
+
+/*
+	Move input packing
+*/
+
+static void SerializeInputAxis(float& Value, float NewerValue, FArchive& Ar)
+{
+	// axes are mostly held for a while, so older inputs usually repeat the newer one
+	uint8 bSameAsNewer = (Ar.IsSaving() && Value == NewerValue) ? 1 : 0;
+	Ar.SerializeBits(&bSameAsNewer, 1);
+
+	if (bSameAsNewer)
+	{
+		Value = NewerValue;
+	}
+	else
+	{
+		Ar << Value;
+	}
+}
+
+bool FHeliMoveInputPacket::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint32 NumMoves = FMath::Min(Moves.Num(), MaxMoves);
+	Ar.SerializeInt(NumMoves, MaxMoves + 1);
+
+	if (Ar.IsLoading())
+	{
+		Moves.SetNum(NumMoves);
+	}
+
+	for (uint32 Index = 0; Index < NumMoves && !Ar.IsError(); ++Index)
+	{
+		FHeliMoveInput& Move = Moves[Index];
+
+		uint8 bAutoRoll = Move.bAutoRollStabilization;
+		Ar.SerializeBits(&bAutoRoll, 1);
+		Move.bAutoRollStabilization = bAutoRoll;
+
+		if (Index == 0)
+		{
+			Ar << Move.Sequence;
+			Ar << Move.Timestamp;
+			Ar << Move.Pitch;
+			Ar << Move.Yaw;
+			Ar << Move.Roll;
+			Ar << Move.Thrust;
+
+			uint8 bHasAcked = Move.bHasAckedState;
+			Ar.SerializeBits(&bHasAcked, 1);
+			Move.bHasAckedState = bHasAcked;
+
+			if (bHasAcked)
+			{
+				Ar << Move.AckedStateStamp;
+			}
+
+			// whole milliseconds, a byte or two
+			uint32 ProxyViewDelayMs = Ar.IsSaving() ? static_cast<uint32>(FMath::Max(0, FMath::RoundToInt(Move.ProxyViewDelay * 1000.f))) : 0;
+			Ar.SerializeIntPacked(ProxyViewDelayMs);
+			if (Ar.IsLoading())
+			{
+				Move.ProxyViewDelay = ProxyViewDelayMs / 1000.f;
+			}
+
+			continue;
+		}
+
+		const FHeliMoveInput& Newer = Moves[Index - 1];
+
+		// usually consecutive, a few bits each
+		uint32 SequenceGap = static_cast<uint16>(Newer.Sequence - Move.Sequence);
+		Ar.SerializeIntPacked(SequenceGap);
+
+		uint32 TimestampGapMs = Ar.IsSaving() ? static_cast<uint32>(FMath::Max(0, FMath::RoundToInt((Newer.Timestamp - Move.Timestamp) * 1000.f))) : 0;
+		Ar.SerializeIntPacked(TimestampGapMs);
+
+		SerializeInputAxis(Move.Pitch, Newer.Pitch, Ar);
+		SerializeInputAxis(Move.Yaw, Newer.Yaw, Ar);
+		SerializeInputAxis(Move.Roll, Newer.Roll, Ar);
+		SerializeInputAxis(Move.Thrust, Newer.Thrust, Ar);
+
+		if (Ar.IsLoading())
+		{
+			Move.Sequence = Newer.Sequence - static_cast<uint16>(SequenceGap);
+			Move.Timestamp = Newer.Timestamp - TimestampGapMs / 1000.f;
+			// the newest acknowledgement is valid for every move in the packet
+			Move.bHasAckedState = Newer.bHasAckedState;
+			Move.AckedStateStamp = Newer.AckedStateStamp;
+			Move.ProxyViewDelay = Newer.ProxyViewDelay;
+		}
+	}
+
+	bOutSuccess = !Ar.IsError();
+
+	return bOutSuccess;
+}
+
 UHeliMoveComp::UHeliMoveComp(const FObjectInitializer& ObjectInitializer)
 {
 	PrimaryComponentTick.bCanEverTick = true;
@@ -30,292 +334,1068 @@ UHeliMoveComp::UHeliMoveComp(const FObjectInitializer& ObjectInitializer)
 
 	BaseThrust = 10000.f;
 
+	// AHelicopter sets the linear damping of its body to 0.4
+	WindResponse = 0.4f;
+	RotorWashTurbulenceScale = 2.f;
+	WindField = nullptr;
+
+	bUseFlightSubstepping = true;
+	FlightStepRate = 120.f;
+	MaxFlightStepsPerSubstep = 8;
+	bFlownByFlightManager = false;
+	OnCalculateFlightPhysics.BindUObject(this, &UHeliMoveComp::SubstepFlightPhysics);
+
 	MinimumTiltInclinationAcceleration = 3000.f;
 
 	MaximumAngularVelocity = 100.f;
 
-	MaxInterpolationSpeed = 60.f;
-	MinInterpolationSpeed = 1.f;
-	CurrentInterpolationSpeed = MaxInterpolationSpeed;
+	bUseKinematicProxies = true;
 	bUseInterpolationForMovementReplication = true;
+	MaxSnapshots = 32;
+	MinInterpolationDelay = 0.05f;
+	MaxInterpolationDelay = 0.3f;
+	JitterDelayMultiplier = 2.f;
+	MaxExtrapolationTime = 0.25f;
+
+	bSmoothProxyCorrections = true;
+	MeshSmoothingTime = 0.1f;
+	MaxMeshSmoothingDistance = 500.f;
+	SmoothedMeshComponent = nullptr;
+	SmoothedMeshBaseTransform = FTransform::Identity;
+	MeshTranslationOffset = FVector::ZeroVector;
+	MeshRotationOffset = FQuat::Identity;
+	bHasProxyMovementState = false;
+	JitterSmoothingWeight = 0.1f;
+	SnapshotClockOffset = 0.f;
+	bHasSnapshotClockOffset = false;
+	SnapshotJitter = 0.f;
+	SnapshotInterval = 0.f;
+	CurrentInterpolationDelay = TargetInterpolationDelay = MinInterpolationDelay;
+
+	bUseDeltaCompression = true;
+	KeyframeInterval = 0.5f;
+	LastKeyframeTime = 0.f;
+	bHasReceivedCorrection = false;
+	LastReceivedCorrectionStamp = 0;
+	bHasUnwrapReference = false;
+	bReplicatedByMovementReplicator = false;
+	bUnwrapUsesClockSync = false;
+	UnwrapReferenceStamp = 0;
+	UnwrapReferenceTime = 0.f;
 
 	bAutoRollStabilization = false;
-	AutoRollInterpSpeed = 1.f;
+	AutoRollProportionalGain = 2.f;
+	AutoRollDerivativeGain = 4.f;
+	MaxAutoRollRate = 45.f;
+	MaxAutoRollTorque = 3.f;
+	bControlsCrashed = false;
 
 	bDrawRole = false;
+
+	MaxSavedMoves = 64;
+	RedundantMoveCount = 4;
+	NextMoveSequence = 0;
+	ServerCorrectionRate = 10.f;
+	MaxLocationErrorBeforeCorrection = 25.f;
+	MaxRotationErrorBeforeCorrection = 5.f;
+	MaxInputAxisValue = 100.f;
+	bHasServerInput = false;
+	LastReceivedMoveSequence = 0;
+	NumRecoveredMoves = 0;
+	NumDuplicateMoves = 0;
+	LastCorrectionSentTime = 0.f;
+	ServerAckedMoveSequence = 0;
+	bHasServerAckedMove = false;
+
+	MaxSendRate = 30.f;
+	MinSendRate = 10.f;
+	SendLocationErrorThreshold = 10.f;
+	SendRotationErrorThreshold = 2.f;
+	SendInputChangeThreshold = 0.05f;
+	LastSendTime = 0.f;
+	NumSentMovementUpdates = 0;
+	NumSuppressedMovementUpdates = 0;
+	bDrawSendPolicyStats = false;
 }
 
 /*
 Controls
 */
+
+// pilot input is only accumulated here, the flight model applies the whole frame at once
 void UHeliMoveComp::AddPitch(float InPitch)
+{
+	PendingInput.Pitch += InPitch;
+}
+
+void UHeliMoveComp::AddYaw(float InYaw)
+{
+	PendingInput.Yaw += InYaw;
+}
+
+void UHeliMoveComp::AddRoll(float InRoll)
+{
+	PendingInput.Roll += InRoll;
+}
+
+void UHeliMoveComp::AddThrust(float InThrust)
+{
+	PendingInput.Thrust += InThrust;
+}
+
+FHeliFlightParams UHeliMoveComp::GetFlightParams() const
+{
+	FHeliFlightParams Params;
+	Params.GravityZ = GetGravityZ();
+	Params.GravityWeight = GravityWeight;
+	Params.MinimumTiltInclinationAcceleration = MinimumTiltInclinationAcceleration;
+	Params.BaseThrust = BaseThrust;
+	Params.MaximumAngularVelocity = MaximumAngularVelocity;
+	Params.AutoRollProportionalGain = AutoRollProportionalGain;
+	Params.AutoRollDerivativeGain = AutoRollDerivativeGain;
+	Params.MaxAutoRollRate = MaxAutoRollRate;
+	Params.MaxAutoRollTorque = MaxAutoRollTorque;
+	Params.WindResponse = WindResponse;
+	Params.RotorWashTurbulenceScale = RotorWashTurbulenceScale;
+	Params.bAddLift = bAddLift;
+	Params.bAccelChange = bAccelChange;
+
+	// physics damps the body itself, the flight model only needs it where it integrates on its own
+	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
+	FBodyInstance* BodyInstance = BaseComp ? BaseComp->GetBodyInstance(BoneName) : nullptr;
+	if (BodyInstance)
+	{
+		Params.LinearDamping = BodyInstance->LinearDamping;
+		Params.AngularDamping = BodyInstance->AngularDamping;
+	}
+
+	return Params;
+}
+
+FHeliFlightInput UHeliMoveComp::ToFlightInput(const FHeliMoveInput& Input)
+{
+	FHeliFlightInput FlightModelInput;
+	FlightModelInput.Pitch = Input.Pitch;
+	FlightModelInput.Yaw = Input.Yaw;
+	FlightModelInput.Roll = Input.Roll;
+	FlightModelInput.Thrust = Input.Thrust;
+	FlightModelInput.bAutoRollStabilization = Input.bAutoRollStabilization;
+
+	return FlightModelInput;
+}
+
+FHeliFlightWind UHeliMoveComp::SampleWind(const FVector& Location) const
+{
+	// calm without a wind field, only the linear damping of the body drags it
+	return WindField ? SampleWind(Location, GetSyncedServerTime()) : FHeliFlightWind();
+}
+
+FHeliFlightWind UHeliMoveComp::SampleWind(const FVector& Location, float ServerTime) const
+{
+	return WindField ? WindField->Sample(Location, ServerTime) : FHeliFlightWind();
+}
+
+FBodyInstance* UHeliMoveComp::GetFlightBodyInstance() const
+{
+	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
+
+	return (IsActive() && BaseComp && BaseComp->IsSimulatingPhysics()) ? BaseComp->GetBodyInstance(BoneName) : nullptr;
+}
+
+bool UHeliMoveComp::CanUseBatchedFlight() const
+{
+	return bUseFlightSubstepping && bUseAddForceForThrust && bUseAddTorque;
+}
+
+void UHeliMoveComp::ApplyFlightForces(FBodyInstance* BodyInstance, const FHeliFlightBodyState& BodyState, const FHeliMoveInput& Input, float ForceScale, float NumSteps, bool bAllowSubstepping)
+{
+	const FHeliFlightParams Params = GetFlightParams();
+	const FHeliFlightInput ModelInput = ToFlightInput(Input);
+
+	FHeliFlightForces Forces;
+	FHeliFlightModel::ComputeForces(BodyState, ModelInput, Params, Forces);
+
+	if (!bUseAddForceForThrust && ModelInput.Thrust != 0.f)
+	{
+		// thrust goes straight into the velocity, the force left is only lift
+		BodyInstance->SetLinearVelocity(FHeliFlightModel::ComputeThrust(BodyState.Rotation, ModelInput.Thrust, Params) * NumSteps, bAddToCurrent);
+		Forces.Acceleration = FHeliFlightModel::ComputeWindAcceleration(BodyState.Wind, Params);
+	}
+
+	// lift and thrust together, one call into the physics engine
+	const FVector Force = FHeliFlightModel::ComputeBodyForce(Forces.Force, Forces.Acceleration, BodyState.Mass);
+	if (!Force.IsZero())
+	{
+		BodyInstance->AddForce(Force * ForceScale, bAllowSubstepping, false);
+	}
+
+	if (!Forces.Torque.IsZero())
+	{
+		if (bUseAddTorque)
+		{
+			BodyInstance->AddTorqueInRadians(Forces.Torque * ForceScale, bAllowSubstepping, bAccelChange);
+		}
+		else
+		{
+			BodyInstance->SetAngularVelocityInRadians(FMath::DegreesToRadians(Forces.Torque * NumSteps), bAddToCurrent);
+		}
+	}
+}
+
+/*
+	Flight Substepping
+*/
+
+void UHeliMoveComp::SubstepFlightPhysics(float DeltaTime, FBodyInstance* BodyInstance)
+{
+	if (!BodyInstance || DeltaTime <= 0.f)
+	{
+		return;
+	}
+
+	float NumSteps = 0.f;
+	const float ForceScale = FHeliFlightModel::ComputeSubstepWeight(DeltaTime, FlightStepRate, MaxFlightStepsPerSubstep, NumSteps);
+
+	const FTransform BodyTransform = BodyInstance->GetUnrealWorldTransform_AssumesLocked();
+
+	FHeliFlightBodyState BodyState;
+	BodyState.Location = BodyTransform.GetLocation();
+	BodyState.Rotation = BodyTransform.GetRotation();
+	BodyState.LinearVelocity = BodyInstance->GetUnrealWorldVelocity_AssumesLocked();
+	BodyState.AngularVelocity = FMath::RadiansToDegrees(BodyInstance->GetUnrealWorldAngularVelocityInRadians_AssumesLocked());
+	BodyState.Mass = BodyInstance->GetBodyMass();
+	BodyState.Wind = SampleWind(BodyState.Location);
+
+	// forces act over the whole substep, only the dropped part of a hitch is scaled away
+	ApplyFlightForces(BodyInstance, BodyState, FlightInput, ForceScale, NumSteps, false);
+}
+
+FVector UHeliMoveComp::GetPhysicsLinearVelocity()
+{
+	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
+	if (BaseComp && BaseComp->IsSimulatingPhysics())
+	{
+		return BaseComp->GetPhysicsLinearVelocity();
+	}
+
+	// kinematic proxies move at the replicated velocity
+	return Velocity;
+}
+
+FVector UHeliMoveComp::GetPhysicsAngularVelocity()
+{
+	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
+	if (BaseComp && BaseComp->IsSimulatingPhysics())
+	{
+		return BaseComp->GetPhysicsAngularVelocityInDegrees();
+	}
+
+	return FVector::ZeroVector;
+}
+
+
+void UHeliMoveComp::SetMovementState(const FMovementState& TargetMovementState)
+{
+	if (TargetMovementState.Location.IsNearlyZero())
+	{
+		return;
+	}
+
+	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
+	if (BaseComp)
+	{
+		FRotator rotation = TargetMovementState.Rotation;
+		FVector location = TargetMovementState.Location;
+		FVector linearVelocity = TargetMovementState.LinearVelocity;
+		FVector angularVelocity = TargetMovementState.AngularVelocity;
+
+		// one transform update, the body follows without sweeping nor waking up anything
+		BaseComp->SetWorldLocationAndRotation(location, rotation.Quaternion(), false, nullptr, ETeleportType::TeleportPhysics);
+
+		if (BaseComp->IsSimulatingPhysics())
+		{
+			BaseComp->SetPhysicsLinearVelocity(linearVelocity);
+			BaseComp->SetPhysicsAngularVelocityInDegrees(angularVelocity);
+		}
+		else
+		{
+			// kinematic proxy, the velocity is only kept for whoever asks the movement component
+			Velocity = linearVelocity;
+		}
+	}
+}
+
+void UHeliMoveComp::UpdateProxyPhysicsMode()
 {
 	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (IsActive() && BaseComp && BaseComp->IsSimulatingPhysics() && FMath::Abs(BaseComp->GetPhysicsAngularVelocityInDegrees().Size()) <= MaximumAngularVelocity)
+	if (!bUseKinematicProxies || !BaseComp || BaseComp->GetCollisionEnabled() == ECollisionEnabled::NoCollision)
+	{
+		return;
+	}
+
+	// also catches a possession that replicated after the helicopter was initialized
+	const bool bShouldSimulate = IsSimulatingAuthoritatively();
+	if (BaseComp->IsSimulatingPhysics() != bShouldSimulate)
+	{
+		BaseComp->SetSimulatePhysics(bShouldSimulate);
+		if (!bShouldSimulate)
+		{
+			Velocity = FVector::ZeroVector;
+		}
+	}
+}
+
+void UHeliMoveComp::OnRep_ReplicatedMovementState()
+{
+	// keyframe arrives in the same bunch, it is already deserialized at this point
+	if (!ReplicatedKeyframeState.Location.IsNearlyZero() && !ReplicatedKeyframeState.bIsDelta)
+	{
+		FMovementState ExistingKeyframe;
+		if (!FindBaseline(ReceivedBaselines, ReplicatedKeyframeState.Stamp, ExistingKeyframe))
+		{
+			StoreBaseline(ReceivedBaselines, ReplicatedKeyframeState);
+		}
+	}
+
+	ReceiveReplicatedMovementState(ReplicatedMovementState);
+}
+
+void UHeliMoveComp::ReceiveReplicatedMovementState(const FMovementState& State)
+{
+	if (!State.bIsDelta && !State.Location.IsNearlyZero())
+	{
+		FMovementState ExistingBaseline;
+		if (!FindBaseline(ReceivedBaselines, State.Stamp, ExistingBaseline))
+		{
+			StoreBaseline(ReceivedBaselines, State);
+		}
+	}
+
+	FMovementState ReceivedState = State;
+	if (ResolveReceivedState(ReceivedState))
+	{
+		LatestReceivedMovementState = ReceivedState;
+		AddSnapshot(ReceivedState);
+	}
+}
+
+void UHeliMoveComp::ReceiveReplicatedKeyframe(const FMovementState& Keyframe)
+{
+	FMovementState ExistingKeyframe;
+	if (!Keyframe.bIsDelta && !Keyframe.Location.IsNearlyZero() && !FindBaseline(ReceivedBaselines, Keyframe.Stamp, ExistingKeyframe))
+	{
+		StoreBaseline(ReceivedBaselines, Keyframe);
+	}
+}
+
+const FMovementState& UHeliMoveComp::GetServerMovementState() const
+{
+	return ServerMovementState;
+}
+
+void UHeliMoveComp::UpdateReplicatedMovementState()
+{
+	if (!bUseDeltaCompression)
+	{
+		ReplicatedMovementState = ServerMovementState;
+		return;
+	}
+
+	const float CurrentTime = ServerMovementState.Timestamp;
+	if (ReplicatedKeyframeState.Location.IsNearlyZero() || (CurrentTime - LastKeyframeTime) >= KeyframeInterval)
+	{
+		ReplicatedKeyframeState = ServerMovementState;
+		LastKeyframeTime = CurrentTime;
+	}
+
+	// offset from the keyframe extrapolated to now, much smaller than the world location
+	ReplicatedMovementState = ServerMovementState;
+	ReplicatedMovementState.EncodeDelta(ReplicatedKeyframeState);
+}
+
+bool UHeliMoveComp::ResolveReceivedState(FMovementState& State)
+{
+	if (State.bIsDelta)
+	{
+		FMovementState Baseline;
+		if (!FindBaseline(ReceivedBaselines, State.BaselineStamp, Baseline))
+		{
+			// baseline was lost, wait for the next one
+			return false;
+		}
+
+		State.DecodeDelta(Baseline);
+	}
+
+	State.Timestamp = UnwrapTimestamp(State.Stamp);
+
+	return true;
+}
+
+float UHeliMoveComp::UnwrapTimestamp(uint16 Stamp)
+{
+	// with a synced clock, received stamps go straight to the server timeline
+	AHeliPlayerController* LocalPlayerController = Cast<AHeliPlayerController>(GetWorld()->GetFirstPlayerController());
+	const bool bClockSynced = LocalPlayerController && LocalPlayerController->HasClockSync();
+
+	// buffered snapshots are on the other timeline, start over
+	if (bClockSynced != bUnwrapUsesClockSync)
+	{
+		bUnwrapUsesClockSync = bClockSynced;
+		SnapshotBuffer.Reset();
+		bHasSnapshotClockOffset = false;
+	}
+
+	if (bClockSynced)
+	{
+		const float ServerTime = GetSyncedServerTime();
+		return ServerTime + static_cast<int16>(Stamp - FMovementState::ToWireStamp(ServerTime)) / 1000.f;
+	}
+
+	if (!bHasUnwrapReference)
+	{
+		bHasUnwrapReference = true;
+		UnwrapReferenceStamp = Stamp;
+		UnwrapReferenceTime = Stamp / 1000.f;
+		return UnwrapReferenceTime;
+	}
+
+	// stamps wrap every ~65 seconds, so anything within half of that is considered close to the reference
+	const float Timestamp = UnwrapReferenceTime + static_cast<int16>(Stamp - UnwrapReferenceStamp) / 1000.f;
+
+	if (Timestamp > UnwrapReferenceTime)
+	{
+		UnwrapReferenceStamp = Stamp;
+		UnwrapReferenceTime = Timestamp;
+	}
+
+	return Timestamp;
+}
+
+float UHeliMoveComp::GetSyncedServerTime() const
+{
+	AHeliPlayerController* LocalPlayerController = Cast<AHeliPlayerController>(GetWorld()->GetFirstPlayerController());
+	if (LocalPlayerController)
+	{
+		return LocalPlayerController->GetSyncedServerTime();
+	}
+
+	return GetWorld()->TimeSeconds;
+}
+
+void UHeliMoveComp::StoreBaseline(TArray<FMovementState>& Baselines, const FMovementState& State)
+{
+	const int32 MaxBaselines = 16;
+
+	if (Baselines.Num() >= MaxBaselines)
+	{
+		Baselines.RemoveAt(0, Baselines.Num() - MaxBaselines + 1, false);
+	}
+
+	Baselines.Add(State);
+}
+
+bool UHeliMoveComp::FindBaseline(const TArray<FMovementState>& Baselines, uint16 Stamp, FMovementState& OutBaseline)
+{
+	for (int32 Index = Baselines.Num() - 1; Index >= 0; --Index)
+	{
+		if (Baselines[Index].Stamp == Stamp)
+		{
+			OutBaseline = Baselines[Index];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void UHeliMoveComp::AddSnapshot(const FMovementState& Snapshot)
+{
+	if (Snapshot.Location.IsNearlyZero())
+	{
+		return;
+	}
+
+	// drop duplicated and out of order snapshots
+	if (SnapshotBuffer.Num() > 0 && Snapshot.Timestamp <= SnapshotBuffer.Last().Timestamp)
+	{
+		return;
+	}
+
+	const float ReceiveTime = GetWorld()->TimeSeconds;
+	const float Offset = ReceiveTime - Snapshot.Timestamp;
+
+	if (!bHasSnapshotClockOffset)
+	{
+		SnapshotClockOffset = Offset;
+		SnapshotJitter = 0.f;
+		bHasSnapshotClockOffset = true;
+	}
+	else
+	{
+		const float Deviation = Offset - SnapshotClockOffset;
+		SnapshotJitter = FMath::Lerp(SnapshotJitter, FMath::Abs(Deviation), JitterSmoothingWeight);
+
+		// follow faster arrivals right away, late ones only slowly (so we still track clock drift)
+		SnapshotClockOffset += (Deviation < 0.f) ? Deviation : Deviation * JitterSmoothingWeight * JitterSmoothingWeight;
+	}
+
+	if (SnapshotBuffer.Num() > 0)
+	{
+		const float Interval = Snapshot.Timestamp - SnapshotBuffer.Last().Timestamp;
+		SnapshotInterval = (SnapshotInterval > 0.f) ? FMath::Lerp(SnapshotInterval, Interval, JitterSmoothingWeight) : Interval;
+	}
+
+	SnapshotBuffer.Add(Snapshot);
+	if (SnapshotBuffer.Num() > MaxSnapshots)
+	{
+		SnapshotBuffer.RemoveAt(0, SnapshotBuffer.Num() - MaxSnapshots, false);
+	}
+
+	// we need at least one snapshot ahead of render time, plus whatever the network jitter is
+	TargetInterpolationDelay = FMath::Clamp(SnapshotInterval + JitterDelayMultiplier * SnapshotJitter, MinInterpolationDelay, MaxInterpolationDelay);
+}
+
+bool UHeliMoveComp::SampleSnapshotBuffer(float RenderTime, FMovementState& OutState) const
+{
+	if (SnapshotBuffer.Num() == 0)
+	{
+		return false;
+	}
+
+	if (RenderTime <= SnapshotBuffer[0].Timestamp)
+	{
+		OutState = SnapshotBuffer[0];
+		return true;
+	}
+
+	for (int32 Index = 0; Index < SnapshotBuffer.Num() - 1; ++Index)
+	{
+		const FMovementState& From = SnapshotBuffer[Index];
+		const FMovementState& To = SnapshotBuffer[Index + 1];
+
+		if (RenderTime <= To.Timestamp)
+		{
+			const float Duration = To.Timestamp - From.Timestamp;
+			const float Alpha = Duration > KINDA_SMALL_NUMBER ? (RenderTime - From.Timestamp) / Duration : 1.f;
+
+			// Hermite spline using the replicated velocities as tangents
+			const FVector P0 = From.Location;
+			const FVector P1 = To.Location;
+			const FVector T0 = FVector(From.LinearVelocity) * Duration;
+			const FVector T1 = FVector(To.LinearVelocity) * Duration;
+
+			OutState.Location = FMath::CubicInterp(P0, T0, P1, T1, Alpha);
+			OutState.LinearVelocity = Duration > KINDA_SMALL_NUMBER ? FMath::CubicInterpDerivative(P0, T0, P1, T1, Alpha) / Duration : FVector(To.LinearVelocity);
+			OutState.Rotation = FQuat::Slerp(From.Rotation.Quaternion(), To.Rotation.Quaternion(), Alpha).Rotator();
+			OutState.AngularVelocity = FMath::Lerp(FVector(From.AngularVelocity), FVector(To.AngularVelocity), Alpha);
+			OutState.Timestamp = RenderTime;
+
+			return true;
+		}
+	}
+
+	// buffer ran dry, extrapolate the newest snapshot but not for too long
+	const FMovementState& Newest = SnapshotBuffer.Last();
+	OutState = ExtrapolateMovementState(Newest, FMath::Min(RenderTime - Newest.Timestamp, MaxExtrapolationTime));
+
+	return true;
+}
+
+void UHeliMoveComp::UpdateSnapshotInterpolation(float DeltaTime)
+{
+	if (SnapshotBuffer.Num() == 0)
+	{
+		return;
+	}
+
+	// change the delay slowly, otherwise proxies would visibly speed up or slow down
+	CurrentInterpolationDelay = FMath::FInterpTo(CurrentInterpolationDelay, TargetInterpolationDelay, DeltaTime, 1.f);
+
+	const float RenderTime = GetWorld()->TimeSeconds - SnapshotClockOffset - CurrentInterpolationDelay;
+
+	// keep only one snapshot older than render time
+	int32 NumOlder = 0;
+	while (NumOlder + 1 < SnapshotBuffer.Num() && SnapshotBuffer[NumOlder + 1].Timestamp <= RenderTime)
+	{
+		NumOlder++;
+	}
+	if (NumOlder > 0)
+	{
+		SnapshotBuffer.RemoveAt(0, NumOlder, false);
+	}
+
+	FMovementState RenderState;
+	if (SampleSnapshotBuffer(RenderTime, RenderState))
+	{
+		// the buffer is sampled every frame, only what the last sample did not predict is a correction
+		ApplyProxyMovementState(RenderState, DeltaTime);
+	}
+}
+
+float UHeliMoveComp::GetProxyViewDelay() const
+{
+	// every proxy adapts to its own snapshot stream, they all come through our connection so they stay close to each other
+	float TotalDelay = 0.f;
+	int32 NumProxies = 0;
+
+	for (TActorIterator<AHelicopter> It(GetWorld()); It; ++It)
+	{
+		const UHeliMoveComp* ProxyMoveComp = Cast<UHeliMoveComp>(It->GetMovementComponent());
+		if (ProxyMoveComp && ProxyMoveComp != this && ProxyMoveComp->bHasSnapshotClockOffset)
+		{
+			TotalDelay += ProxyMoveComp->CurrentInterpolationDelay;
+			NumProxies++;
+		}
+	}
+
+	return NumProxies > 0 ? TotalDelay / NumProxies : MinInterpolationDelay;
+}
+
+void UHeliMoveComp::ApplyProxyMovementState(const FMovementState& State, float PredictionTime)
+{
+	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
+	if (!BaseComp || State.Location.IsNearlyZero())
+	{
+		return;
+	}
+
+	if (bSmoothProxyCorrections && SmoothedMeshComponent && bHasProxyMovementState)
 	{
-		const FVector AngularVelocity = BaseComp->GetRightVector() * InPitch;
+		const FMovementState Expected = ExtrapolateMovementState(LastProxyMovementState, PredictionTime);
+		const FQuat ExpectedRotation = Expected.Rotation.Quaternion();
+		const FQuat TargetRotation = State.Rotation.Quaternion();
 
-		if (bUseAddTorque)
-		{
-			BaseComp->AddTorqueInRadians(AngularVelocity, BoneName, bAccelChange);
-		}
-		else
+		// keep drawing the mesh where the root would have been without the correction
+		MeshTranslationOffset += Expected.Location - State.Location;
+		MeshRotationOffset = ExpectedRotation * TargetRotation.Inverse() * MeshRotationOffset;
+		MeshRotationOffset.Normalize();
+
+		// respawns and big errors are not worth hiding
+		if (MeshTranslationOffset.SizeSquared() > FMath::Square(MaxMeshSmoothingDistance))
 		{
-			BaseComp->SetPhysicsAngularVelocityInDegrees(AngularVelocity, bAddToCurrent);
+			MeshTranslationOffset = FVector::ZeroVector;
+			MeshRotationOffset = FQuat::Identity;
 		}
 	}
+
+	// collision goes straight to the corrected state
+	SetMovementState(State);
+
+	LastProxyMovementState = State;
+	bHasProxyMovementState = true;
 }
 
-void UHeliMoveComp::AddYaw(float InYaw)
+void UHeliMoveComp::UpdateMeshSmoothing(float DeltaTime)
 {
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (IsActive() && BaseComp && BaseComp->IsSimulatingPhysics() && FMath::Abs(BaseComp->GetPhysicsAngularVelocityInDegrees().Size()) <= MaximumAngularVelocity)
+	if (!SmoothedMeshComponent || !UpdatedComponent)
 	{
-		const FVector AngularVelocity = BaseComp->GetUpVector() * InYaw;
+		return;
+	}
 
-		if (bUseAddTorque)
-		{
-			BaseComp->AddTorqueInRadians(AngularVelocity, BoneName, bAccelChange);
-		}
-		else
-		{
-			BaseComp->SetPhysicsAngularVelocityInDegrees(AngularVelocity, bAddToCurrent);
-		}
+	if (MeshSmoothingTime > 0.f)
+	{
+		// exponential decay, frame rate independent
+		const float Alpha = FMath::Exp(-DeltaTime / MeshSmoothingTime);
+		MeshTranslationOffset *= Alpha;
+		MeshRotationOffset = FQuat::Slerp(FQuat::Identity, MeshRotationOffset, Alpha);
+	}
+	else
+	{
+		MeshTranslationOffset = FVector::ZeroVector;
+		MeshRotationOffset = FQuat::Identity;
 	}
+
+	if (MeshTranslationOffset.IsNearlyZero(0.01f) && MeshRotationOffset.Equals(FQuat::Identity, KINDA_SMALL_NUMBER))
+	{
+		MeshTranslationOffset = FVector::ZeroVector;
+		MeshRotationOffset = FQuat::Identity;
+	}
+
+	// mesh has no collision, moving it is only a render transform update
+	const FTransform RootTransform = UpdatedComponent->GetComponentTransform();
+	const FQuat MeshRotation = MeshRotationOffset * RootTransform.GetRotation();
+	const FVector MeshLocation = RootTransform.GetLocation() + MeshTranslationOffset + MeshRotation.RotateVector(SmoothedMeshBaseTransform.GetLocation() * RootTransform.GetScale3D());
+
+	SmoothedMeshComponent->SetWorldLocationAndRotation(MeshLocation, MeshRotation * SmoothedMeshBaseTransform.GetRotation());
 }
 
-void UHeliMoveComp::AddRoll(float InRoll)
+FMovementState UHeliMoveComp::GetCurrentMovementState() const
 {
 	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (IsActive() && BaseComp && BaseComp->IsSimulatingPhysics() && FMath::Abs(BaseComp->GetPhysicsAngularVelocityInDegrees().Size()) <= MaximumAngularVelocity)
+	if (BaseComp)
 	{
-		const FVector AngularVelocity = BaseComp->GetForwardVector() * InRoll;
-
-		if (bUseAddTorque)
-		{
-			BaseComp->AddTorqueInRadians(AngularVelocity, BoneName, bAccelChange);
-		}
-		else
-		{
-			BaseComp->SetPhysicsAngularVelocityInDegrees(AngularVelocity, bAddToCurrent);
-		}
-		//UE_LOG(LogTemp, Display, TEXT("InRoll = %f - Angular Velocity Rolling: (%s) = %f"), InRoll, *BaseComp->GetPhysicsAngularVelocityInDegrees().ToString(), FMath::Abs(BaseComp->GetPhysicsAngularVelocityInDegrees().Size()) );
+		return FMovementState(
+			BaseComp->GetComponentLocation(),
+			BaseComp->GetComponentRotation(),
+			BaseComp->GetPhysicsLinearVelocity(),
+			BaseComp->GetPhysicsAngularVelocityInDegrees(),
+			GetWorld()->TimeSeconds
+		);
 	}
+
+	return FMovementState();
+}
+
+bool UHeliMoveComp::IsSimulatingAuthoritatively() const
+{
+	return GetPawnOwner() && (GetPawnOwner()->Role == ROLE_Authority || GetPawnOwner()->IsLocallyControlled());
 }
 
+FMovementState UHeliMoveComp::ExtrapolateMovementState(const FMovementState& State, float DeltaSeconds)
+{
+	FMovementState Extrapolated = State;
+	Extrapolated.Location = State.Location + State.LinearVelocity * DeltaSeconds;
+
+	// angular velocity is in degrees per second around world axes
+	const FVector RotationAxisAngle = State.AngularVelocity * DeltaSeconds;
+	const float Angle = FMath::DegreesToRadians(RotationAxisAngle.Size());
+	if (Angle > KINDA_SMALL_NUMBER)
+	{
+		const FQuat DeltaRotation(RotationAxisAngle.GetSafeNormal(), Angle);
+		Extrapolated.Rotation = (DeltaRotation * State.Rotation.Quaternion()).Rotator();
+	}
 
+	Extrapolated.Timestamp = State.Timestamp + DeltaSeconds;
 
-/*
-Thrust
-*/
+	return Extrapolated;
+}
 
-FVector UHeliMoveComp::ComputeThrust(UPrimitiveComponent* BaseComp, float InThrust)
+bool UHeliMoveComp::ShouldSendMovementUpdate(const FMovementState& CurrentState, float CurrentTime) const
 {
-	FVector ThrustForce = FVector::ZeroVector;
+	const float TimeSinceLastSend = CurrentTime - LastSendTime;
 
-	if (BaseComp && BaseComp->IsSimulatingPhysics())
+	// never faster than max rate
+	if (MaxSendRate > 0.f && TimeSinceLastSend < (1.f / MaxSendRate))
 	{
-		if (InThrust < 0.f)
-		{
-			ThrustForce = FVector::UpVector * InThrust * BaseThrust;
-		}
-		else
-		{
+		return false;
+	}
 
+	// heartbeat, at least min rate and never below the correction rate: every correction should ack a move
+	// that started shortly before it, the older the acked move the more the replay has to make up for
+	const float HeartbeatRate = FMath::Max(MinSendRate, ServerCorrectionRate);
+	if (HeartbeatRate <= 0.f || TimeSinceLastSend >= (1.f / HeartbeatRate))
+	{
+		return true;
+	}
 
-			float InclinationAngle = FVector::DotProduct(FVector::UpVector, BaseComp->GetForwardVector());
-			float ZWeight = 1.f - FMath::Abs(InclinationAngle);
+	// pilot changed its commands
+	if (FMath::Abs(PendingInput.Pitch - LastSentInput.Pitch) > SendInputChangeThreshold ||
+		FMath::Abs(PendingInput.Yaw - LastSentInput.Yaw) > SendInputChangeThreshold ||
+		FMath::Abs(PendingInput.Roll - LastSentInput.Roll) > SendInputChangeThreshold ||
+		FMath::Abs(PendingInput.Thrust - LastSentInput.Thrust) > SendInputChangeThreshold ||
+		bAutoRollStabilization != LastSentInput.bAutoRollStabilization)
+	{
+		return true;
+	}
 
-			FVector UpForceCorrection = FVector(1.f, 1.f, ZWeight);
+	// what would the others guess from the last state we have sent?
+	const FMovementState Predicted = ExtrapolateMovementState(LastSentMovementState, TimeSinceLastSend);
 
-			ThrustForce = (BaseComp->GetUpVector() * UpForceCorrection) * BaseThrust * InThrust;
-		}
+	const float LocationError = FVector::Dist(Predicted.Location, CurrentState.Location);
+	if (LocationError > SendLocationErrorThreshold)
+	{
+		return true;
+	}
 
+	const float RotationError = FMath::RadiansToDegrees(Predicted.Rotation.Quaternion().AngularDistance(CurrentState.Rotation.Quaternion()));
+	if (RotationError > SendRotationErrorThreshold)
+	{
+		return true;
 	}
 
-	return ThrustForce;
+	return false;
 }
 
-void UHeliMoveComp::AddThrust(float InThrust)
+void UHeliMoveComp::SendMovementState()
 {
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (IsActive() && BaseComp && BaseComp->IsSimulatingPhysics())
+	if (GetPawnOwner() && GetPawnOwner()->IsLocallyControlled() && GetPawnOwner()->Role == ROLE_AutonomousProxy)
 	{
-		FVector ThrustForce = ComputeThrust(BaseComp, InThrust);
-
-		if (bUseAddForceForThrust)
-		{
-			BaseComp->AddForce(ThrustForce, BoneName, bAccelChange);
-		}
-		else
+		UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
+		if (BaseComp && BaseComp->IsSimulatingPhysics() && SavedMoves.Num() > 0)
 		{
-			BaseComp->SetPhysicsLinearVelocity(ThrustForce, bAddToCurrent);
+			const float CurrentTime = GetWorld()->TimeSeconds;
+			const FMovementState CurrentState = GetCurrentMovementState();
+
+			if (!ShouldSendMovementUpdate(CurrentState, CurrentTime))
+			{
+				// server keeps applying the last input we have sent
+				NumSuppressedMovementUpdates++;
+				return;
+			}
+
+			// on the server timeline, so the server knows when we pressed the controls
+			PendingInput.Timestamp = GetSyncedServerTime();
+			PendingInput.Sequence = NextMoveSequence++;
+			PendingInput.bAutoRollStabilization = bAutoRollStabilization;
+			PendingInput.bHasAckedState = bHasReceivedCorrection;
+			PendingInput.AckedStateStamp = LastReceivedCorrectionStamp;
+			PendingInput.ProxyViewDelay = GetProxyViewDelay();
+
+			// keep what we predicted at this point so we can compare it against the server later on
+			FHeliSavedMove& SavedMove = GetSavedMove(PendingInput.Sequence);
+			SavedMove.Input = PendingInput;
+			SavedMove.PredictedState = CurrentState;
+			SavedMove.bValid = true;
+
+			// previous inputs the server has not acknowledged yet ride along, in case their own packet got lost
+			FHeliMoveInputPacket Packet;
+			Packet.Moves.Add(PendingInput);
+
+			const int32 MaxPacketMoves = FMath::Clamp(RedundantMoveCount + 1, 1, FHeliMoveInputPacket::MaxMoves);
+			for (uint16 Sequence = PendingInput.Sequence - 1; Packet.Moves.Num() < MaxPacketMoves; --Sequence)
+			{
+				const FHeliSavedMove& Move = GetSavedMove(Sequence);
+				if (!Move.bValid || Move.Input.Sequence != Sequence)
+				{
+					break;
+				}
+
+				Packet.Moves.Add(Move.Input);
+			}
+
+			Server_SendMoveInputs(Packet);
+
+			LastSentInput = PendingInput;
+			LastSentMovementState = CurrentState;
+			LastSendTime = CurrentTime;
+			NumSentMovementUpdates++;
 		}
 	}
 }
 
+int32 UHeliMoveComp::GetNumSentMovementUpdates() const
+{
+	return NumSentMovementUpdates;
+}
 
+int32 UHeliMoveComp::GetNumSuppressedMovementUpdates() const
+{
+	return NumSuppressedMovementUpdates;
+}
 
-/*
-Lift
-*/
-FVector UHeliMoveComp::ComputeLift(UPrimitiveComponent* BaseComp)
+int32 UHeliMoveComp::GetNumRecoveredMoves() const
+{
+	return NumRecoveredMoves;
+}
+
+int32 UHeliMoveComp::GetNumDuplicateMoves() const
 {
-	FVector LiftForce = FVector::ZeroVector;
+	return NumDuplicateMoves;
+}
 
-	if (BaseComp && BaseComp->IsSimulatingPhysics())
+bool UHeliMoveComp::Server_SendMoveInputs_Validate(const FHeliMoveInputPacket& Packet)
+{
+	if (Packet.Moves.Num() == 0 || Packet.Moves.Num() > FHeliMoveInputPacket::MaxMoves)
 	{
-		float GravityAcceleration = FMath::Abs(GetGravityZ()) * GravityWeight;
-
-		float InclinationAngle = FVector::DotProduct(FVector::UpVector, BaseComp->GetForwardVector());
-		float TiltAngle = FVector::DotProduct(FVector::UpVector, BaseComp->GetRightVector());
+		return false;
+	}
 
-		float InclinationWeight = 1 - FMath::Abs(InclinationAngle);
-		float TiltWeight = 1 - FMath::Abs(TiltAngle);
+	for (const FHeliMoveInput& Move : Packet.Moves)
+	{
+		if (!FMath::IsFinite(Move.Pitch) || !FMath::IsFinite(Move.Yaw) || !FMath::IsFinite(Move.Roll) || !FMath::IsFinite(Move.Thrust))
+		{
+			return false;
+		}
+	}
 
-		// weights gravity acceleration based on inclination and tilt
-		float WeightedGravityAcceleration = GravityAcceleration * InclinationWeight * TiltWeight;
+	return true;
+}
 
-		// up momentum will produce zero net force against gravity force when stationary (F = m*a)
-		FVector UpMomentum = BaseComp->GetUpVector() * (BaseComp->GetMass() * WeightedGravityAcceleration);
+void UHeliMoveComp::Server_SendMoveInputs_Implementation(const FHeliMoveInputPacket& Packet)
+{
+	// oldest first, so gaps left by lost packets are filled in order
+	for (int32 Index = Packet.Moves.Num() - 1; Index >= 0; --Index)
+	{
+		const FHeliMoveInput& Move = Packet.Moves[Index];
 
-		// adds momentum for inclination and tilt (m = a * tanh(-angle) a.k.a. hyperbolic tangent function) 
-		float InclinationAcceleration = MinimumTiltInclinationAcceleration * FMath::Tan(-InclinationAngle);
-		float TiltAcceleration = MinimumTiltInclinationAcceleration * FMath::Tan(-TiltAngle);
+		// already received, either in its own packet or as a redundant copy (sequence wraps around)
+		if (bHasServerInput && static_cast<int16>(Move.Sequence - LastReceivedMoveSequence) <= 0)
+		{
+			NumDuplicateMoves++;
+			continue;
+		}
 
-		FVector InclinationMomentum = BaseComp->GetForwardVector() * GravityAcceleration * InclinationAcceleration;
-		FVector TiltMomentum = BaseComp->GetRightVector() * GravityAcceleration *  TiltAcceleration;
+		if (Index > 0)
+		{
+			NumRecoveredMoves++;
+		}
 
-		// compute net lift force
-		LiftForce = UpMomentum + InclinationMomentum + TiltMomentum;
+		ReceiveMoveInput(Move);
 	}
-
-	return LiftForce;
 }
 
-void UHeliMoveComp::AddLift()
+void UHeliMoveComp::ReceiveMoveInput(const FHeliMoveInput& NewInput)
 {
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (IsActive() && BaseComp && BaseComp->IsSimulatingPhysics())
+	FHeliMoveInput ClampedInput = NewInput;
+	ClampedInput.Pitch = FMath::Clamp(NewInput.Pitch, -MaxInputAxisValue, MaxInputAxisValue);
+	ClampedInput.Yaw = FMath::Clamp(NewInput.Yaw, -MaxInputAxisValue, MaxInputAxisValue);
+	ClampedInput.Roll = FMath::Clamp(NewInput.Roll, -MaxInputAxisValue, MaxInputAxisValue);
+	ClampedInput.Thrust = FMath::Clamp(NewInput.Thrust, -MaxInputAxisValue, MaxInputAxisValue);
+
+	// don't let a burst of recovered inputs pile up latency, drop the oldest ones instead
+	if (ServerPendingInputs.Num() >= FHeliMoveInputPacket::MaxMoves)
 	{
-		FVector Lift = ComputeLift(BaseComp);
+		ServerPendingInputs.RemoveAt(0, ServerPendingInputs.Num() - FHeliMoveInputPacket::MaxMoves + 1, false);
+	}
 
-		BaseComp->AddForce(Lift, BoneName, false);
+	ServerPendingInputs.Add(ClampedInput);
+	LastReceivedMoveSequence = NewInput.Sequence;
+	bHasServerInput = true;
+
+	// a client reporting a huge delay would get to rewind further, it can't go past what honest interpolation uses
+	AHeliPlayerController* PlayerController = GetPawnOwner() ? Cast<AHeliPlayerController>(GetPawnOwner()->GetController()) : nullptr;
+	if (PlayerController)
+	{
+		PlayerController->SetReportedProxyViewDelay(FMath::Clamp(NewInput.ProxyViewDelay, 0.f, MaxInterpolationDelay));
 	}
 }
 
-FVector UHeliMoveComp::GetPhysicsLinearVelocity()
+void UHeliMoveComp::ApplyInput(const FHeliMoveInput& Input)
 {
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (BaseComp && BaseComp->IsSimulatingPhysics())
+	FBodyInstance* BodyInstance = GetFlightBodyInstance();
+	if (BodyInstance)
 	{
-		return BaseComp->GetPhysicsLinearVelocity();
+		const FTransform BodyTransform = BodyInstance->GetUnrealWorldTransform();
+
+		FHeliFlightBodyState BodyState;
+		BodyState.Location = BodyTransform.GetLocation();
+		BodyState.Rotation = BodyTransform.GetRotation();
+		BodyState.LinearVelocity = BodyInstance->GetUnrealWorldVelocity();
+		BodyState.AngularVelocity = FMath::RadiansToDegrees(BodyInstance->GetUnrealWorldAngularVelocityInRadians());
+		BodyState.Mass = BodyInstance->GetBodyMass();
+		BodyState.Wind = SampleWind(BodyState.Location);
+
+		// held for the whole frame, the engine spreads it over its substeps
+		ApplyFlightForces(BodyInstance, BodyState, Input, 1.f, 1.f, true);
 	}
-
-	return FVector::ZeroVector;
 }
 
-FVector UHeliMoveComp::GetPhysicsAngularVelocity()
+void UHeliMoveComp::SendCorrectionToOwningClient()
 {
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (BaseComp && BaseComp->IsSimulatingPhysics())
+	const float CurrentTime = GetWorld()->TimeSeconds;
+	if (bHasServerAckedMove && ServerCorrectionRate > 0.f && (CurrentTime - LastCorrectionSentTime) >= (1.f / ServerCorrectionRate))
 	{
-		return BaseComp->GetPhysicsAngularVelocityInDegrees();
-	}
+		LastCorrectionSentTime = CurrentTime;
 
-	return FVector::ZeroVector;
-}
+		// the state at the start of the acked input, not the current one: the client compares it to what it had when it sent that input
+		FMovementState Correction = ServerAckedMoveState;
+		StoreBaseline(SentCorrections, ServerAckedMoveState);
 
+		FMovementState AckedCorrection;
+		if (bUseDeltaCompression && ServerCurrentInput.bHasAckedState && FindBaseline(SentCorrections, ServerCurrentInput.AckedStateStamp, AckedCorrection))
+		{
+			Correction.EncodeDelta(AckedCorrection);
+		}
 
-void UHeliMoveComp::SetMovementState(const FMovementState& TargetMovementState)
+		Client_AdjustMovementState(ServerAckedMoveSequence, Correction);
+	}
+}
+
+void UHeliMoveComp::Client_AdjustMovementState_Implementation(uint16 AckSequence, const FMovementState& ServerState)
 {
-	if (TargetMovementState.Location.IsNearlyZero())
+	FMovementState ReceivedState = ServerState;
+	if (!ResolveReceivedState(ReceivedState))
 	{
 		return;
 	}
 
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (BaseComp)
-	{
-		FRotator rotation = TargetMovementState.Rotation;
-		FVector location = TargetMovementState.Location;
-		FVector linearVelocity = TargetMovementState.LinearVelocity;
-		FVector angularVelocity = TargetMovementState.AngularVelocity;
+	StoreBaseline(ReceivedBaselines, ReceivedState);
+	bHasReceivedCorrection = true;
+	LastReceivedCorrectionStamp = ReceivedState.Stamp;
 
-		BaseComp->SetWorldRotation(rotation.Quaternion());
-		BaseComp->SetWorldLocation(location);
-		BaseComp->SetPhysicsLinearVelocity(linearVelocity);
-		BaseComp->SetPhysicsAngularVelocityInDegrees(angularVelocity);
-	}
+	ReconcileWithServerState(AckSequence, ReceivedState);
 }
 
-void UHeliMoveComp::SetMovementStateSmoothly(const FMovementState& TargetMovementState, float DeltaTime)
-{	
-	if (TargetMovementState.Location.IsNearlyZero())
+void UHeliMoveComp::ReconcileWithServerState(uint16 AckSequence, const FMovementState& ServerState)
+{
+	if (SavedMoves.Num() == 0 || ServerState.Location.IsNearlyZero())
 	{
 		return;
 	}
 
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (BaseComp)
+	FHeliSavedMove& AckedMove = GetSavedMove(AckSequence);
+	if (!AckedMove.bValid || AckedMove.Input.Sequence != AckSequence)
 	{
-		// NOTE(andrey): should we use slerp or rinterpto for rotation interpolation?
-		//Quat rotation = FQuat::Slerp(BaseComp->GetComponentRotation().Quaternion(), TargetPhysMovementState.Rotation.Quaternion(), 0.1f);
-		FRotator rotation = FMath::RInterpTo(BaseComp->GetComponentRotation(), TargetMovementState.Rotation, DeltaTime, CurrentInterpolationSpeed);
-		FVector location = FMath::VInterpTo(BaseComp->GetComponentLocation(), TargetMovementState.Location, DeltaTime, CurrentInterpolationSpeed);
-		FVector linearVelocity = FMath::VInterpTo(BaseComp->GetPhysicsLinearVelocity(), TargetMovementState.LinearVelocity, DeltaTime, CurrentInterpolationSpeed);
-		FVector angularVelocity = FMath::VInterpTo(BaseComp->GetPhysicsAngularVelocityInDegrees(), TargetMovementState.AngularVelocity, DeltaTime, CurrentInterpolationSpeed);
-
-		//BaseComp->SetWorldRotation(rotation);
-		BaseComp->SetWorldRotation(rotation.Quaternion());
-		BaseComp->SetWorldLocation(location);
-		BaseComp->SetPhysicsLinearVelocity(linearVelocity);
-		BaseComp->SetPhysicsAngularVelocityInDegrees(angularVelocity);
+		// too old, the ring buffer has already been overwritten
+		return;
 	}
-}
 
-void UHeliMoveComp::SendMovementState()
-{
-	if ((GetPawnOwner() && GetPawnOwner()->IsLocallyControlled())) // && GetPawnOwner()->Role >= ENetRole::ROLE_AutonomousProxy))
+	const float LocationError = FVector::Dist(AckedMove.PredictedState.Location, ServerState.Location);
+	const float RotationError = FMath::RadiansToDegrees(AckedMove.PredictedState.Rotation.Quaternion().AngularDistance(ServerState.Rotation.Quaternion()));
+
+	FBodyInstance* BodyInstance = GetFlightBodyInstance();
+
+	if (BodyInstance && (LocationError > MaxLocationErrorBeforeCorrection || RotationError > MaxRotationErrorBeforeCorrection))
 	{
-		UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-		if (BaseComp && BaseComp->IsSimulatingPhysics())
+		// the server state is from the instant the acked move started to be flown, so the acked move is flown again too,
+		// then every move sent since, each until the next one was sampled and the newest one until now
+		FMovementState Corrected = ServerState;
+		const float Mass = BodyInstance->GetBodyMass();
+
+		for (uint16 Sequence = AckSequence; Sequence != NextMoveSequence; ++Sequence)
 		{
-			if (BaseComp->GetPhysicsLinearVelocity().IsNearlyZero())
+			const FHeliSavedMove& Move = GetSavedMove(Sequence);
+			if (!Move.bValid || Move.Input.Sequence != Sequence)
 			{
-				return;
+				break;
 			}
 
-			/*
-			 // TODO(andrey): don't try to replicate faster than server can handle, it will just consume resource. 
-			 // recently I've notice a huge % amount of Server_SetMovementState calls while profiling									
-			float serverDeltaTickRate = GEngine->NetClientTicksPerSecond;
-			float differenceTime = GetWorld()->TimeSeconds - LastTimeReplicatedMovementWasSent;
-			if (differenceTime < serverDeltaTickRate)
-			{
-				return;
-			}
-			*/						
+			const uint16 NextSequence = Sequence + 1;
+			const FHeliSavedMove& NextMove = GetSavedMove(NextSequence);
+			const bool bHasNextMove = NextSequence != NextMoveSequence && NextMove.bValid && NextMove.Input.Sequence == NextSequence;
 
-			Server_SetMovementState(FMovementState(
-				BaseComp->GetComponentLocation(),
-				BaseComp->GetComponentRotation(),
-				BaseComp->GetPhysicsLinearVelocity(),
-				BaseComp->GetPhysicsAngularVelocityInDegrees(),
-				GetWorld()->TimeSeconds
-			));
+			ReplaySavedMove(Corrected, Move, bHasNextMove ? NextMove.Input.Timestamp : GetSyncedServerTime(), Mass);
 		}
+
+		SetMovementState(Corrected);
 	}
-}
 
-bool UHeliMoveComp::Server_SetMovementState_Validate(const FMovementState& NewMovementState)
-{
-	return true;
+	// everything up to the acknowledged move is not needed anymore
+	for (FHeliSavedMove& Move : SavedMoves)
+	{
+		if (Move.bValid && static_cast<int16>(Move.Input.Sequence - AckSequence) <= 0)
+		{
+			Move.bValid = false;
+		}
+	}
 }
 
-void UHeliMoveComp::Server_SetMovementState_Implementation(const FMovementState& NewMovementState)
+void UHeliMoveComp::ReplaySavedMove(FMovementState& State, const FHeliSavedMove& Move, float EndTime, float Mass) const
 {
-	ReplicatedMovementState = NewMovementState;
+	// never longer than the heartbeat, a stalled move is not held for longer on the server either, see ShouldSendMovementUpdate
+	const float HeartbeatRate = FMath::Max3(MinSendRate, ServerCorrectionRate, 1.f);
+	const float Duration = FMath::Clamp(EndTime - Move.Input.Timestamp, 0.f, 1.f / HeartbeatRate);
+	if (Duration <= 0.f)
+	{
+		return;
+	}
+
+	const FHeliFlightParams Params = GetFlightParams();
+	const FHeliFlightInput Input = ToFlightInput(Move.Input);
+
+	FHeliFlightBodyState BodyState;
+	BodyState.Location = State.Location;
+	BodyState.Rotation = State.Rotation.Quaternion();
+	BodyState.LinearVelocity = State.LinearVelocity;
+	BodyState.AngularVelocity = State.AngularVelocity;
+	BodyState.Mass = Mass;
+
+	// at the rate the flight forces are applied, the last step takes what is left
+	const int32 NumSteps = FMath::Max(FMath::CeilToInt(Duration * FlightStepRate), 1);
+	const float StepTime = Duration / NumSteps;
+
+	for (int32 Step = 0; Step < NumSteps; ++Step)
+	{
+		// the gusts as they were when the move was flown
+		BodyState.Wind = SampleWind(BodyState.Location, Move.Input.Timestamp + Step * StepTime);
+		FHeliFlightModel::Step(BodyState, Input, Params, StepTime);
+	}
+
+	State.Location = BodyState.Location;
+	State.Rotation = BodyState.Rotation.Rotator();
+	State.LinearVelocity = BodyState.LinearVelocity;
+	State.AngularVelocity = BodyState.AngularVelocity;
 }
 
 bool UHeliMoveComp::IsNetworkSmoothingFactorActive()
@@ -323,34 +1403,48 @@ bool UHeliMoveComp::IsNetworkSmoothingFactorActive()
 	return bUseInterpolationForMovementReplication;
 }
 
-void UHeliMoveComp::SetNetworkSmoothingFactor(float inNetworkSmoothingFactor)
-{				
-	if (inNetworkSmoothingFactor < 0.1f)
-	{
-		// turn interpolation off	
-		CurrentInterpolationSpeed = MaxInterpolationSpeed;
-		bUseInterpolationForMovementReplication = false;
-		//UE_LOG(LogTemp, Display, TEXT("UHeliMoveComp::SetNetworkSmoothingFactor ~ Network Smoothing Factor Deactivated!"));
-	}
-	else if (inNetworkSmoothingFactor >= 100.f)
+void UHeliMoveComp::SetSmoothedMeshComponent(USceneComponent* InSmoothedMeshComponent)
+{
+	SmoothedMeshComponent = InSmoothedMeshComponent;
+	SmoothedMeshBaseTransform = SmoothedMeshComponent ? SmoothedMeshComponent->GetRelativeTransform() : FTransform::Identity;
+	MeshTranslationOffset = FVector::ZeroVector;
+	MeshRotationOffset = FQuat::Identity;
+}
+
+void UHeliMoveComp::ResetMovementState()
+{
+	PendingInput.ResetAxes();
+	FlightInput.ResetAxes();
+	Velocity = FVector::ZeroVector;
+	bControlsCrashed = false;
+
+	// [server] the next input is accepted whatever its sequence, it may come from another client
+	ServerCurrentInput = FHeliMoveInput();
+	ServerPendingInputs.Reset();
+	bHasServerInput = false;
+	bHasServerAckedMove = false;
+	SentCorrections.Reset();
+
+	// [client] nothing left to replay nor to decode against, the server starts over with full states
+	for (FHeliSavedMove& SavedMove : SavedMoves)
 	{
-		// minimum interpolation we allow
-		CurrentInterpolationSpeed = MinInterpolationSpeed;
-		bUseInterpolationForMovementReplication = true;
-		//UE_LOG(LogTemp, Display, TEXT("UHeliMoveComp::SetNetworkSmoothingFactor ~ Network Smoothing Factor is 100%, CurrentInterpolationSpeed = %f"), MinInterpolationSpeed);
+		SavedMove.bValid = false;
 	}
-	else
-	{
-		// normalize it between MinInterpolationSpeed and MaxInterpolationSpeed
-		// ((limitMax - limitMin) * (valueIn - baseMin) / (baseMax - baseMin)) + limitMin;		
-		float smoothFactorNormalized = ((MaxInterpolationSpeed - MinInterpolationSpeed) * (inNetworkSmoothingFactor - 0.f) / (100.f - 0.f)) + MinInterpolationSpeed;
-		
-		// smaller values means more interpolation speed, greater values means that interpolation should happen more smoothly (slow interp speed)
-		CurrentInterpolationSpeed = MaxInterpolationSpeed - smoothFactorNormalized;
-		bUseInterpolationForMovementReplication = true;
+	bHasReceivedCorrection = false;
+	ReceivedBaselines.Reset();
+	bHasUnwrapReference = false;
+
+	// [simulated proxy] never interpolate from where we died
+	SnapshotBuffer.Reset();
+	bHasProxyMovementState = false;
+	MeshTranslationOffset = FVector::ZeroVector;
+	MeshRotationOffset = FQuat::Identity;
+}
 
-		//UE_LOG(LogTemp, Warning, TEXT("UHeliMoveComp::SetNetworkSmoothingFactor ~ inNetworkSmoothingFactor = %f, smoothFactorNormalized = %f, CurrentInterpolationSpeed = %f"), inNetworkSmoothingFactor, smoothFactorNormalized, CurrentInterpolationSpeed);
-	}
+void UHeliMoveComp::SetNetworkSmoothingFactor(float inNetworkSmoothingFactor)
+{
+	// snapshot interpolation tunes its delay by itself from the measured jitter, the factor only turns it on or off
+	bUseInterpolationForMovementReplication = inNetworkSmoothingFactor >= 0.1f;
 }
 
 FString UHeliMoveComp::GetRoleAsString(ENetRole inRole)
@@ -373,24 +1467,14 @@ FString UHeliMoveComp::GetRoleAsString(ENetRole inRole)
 }
 
 
-void UHeliMoveComp::AutoRollStabilization(float deltaTime)
+void UHeliMoveComp::SetAutoRollStabilization(bool bNewAutoRollStabilization)
 {
-	UPrimitiveComponent* BaseComp = Cast<UPrimitiveComponent>(UpdatedComponent);
-	if (BaseComp && BaseComp->IsSimulatingPhysics())
-	{
-		FRotator CurrentRotation = BaseComp->GetComponentRotation();
-
-		float TargetRoll = FMath::FInterpTo(CurrentRotation.Roll, 0.f, deltaTime, AutoRollInterpSpeed);
-
-		FRotator TargetRotation = FRotator(CurrentRotation.Pitch, CurrentRotation.Yaw, TargetRoll);
-
-		BaseComp->SetAllPhysicsRotation(TargetRotation);
-	}	
+	bAutoRollStabilization = bNewAutoRollStabilization;
 }
 
-void UHeliMoveComp::SetAutoRollStabilization(bool bNewAutoRollStabilization)
+void UHeliMoveComp::SetControlsCrashed(bool bNewControlsCrashed)
 {
-	bAutoRollStabilization = bNewAutoRollStabilization;
+	bControlsCrashed = bNewControlsCrashed;
 }
 
 bool UHeliMoveComp::IsAutoRollingStabilization()
@@ -414,11 +1498,55 @@ void UHeliMoveComp::InitializeComponent()
 	{
 		SetAutoRollStabilization(heliGameUserSettings->GetPilotAssist() > 0 ? true : false);
 	}
+
+	SavedMoves.SetNum(FMath::RoundUpToPowerOfTwo(FMath::Max(MaxSavedMoves, 2)));
 }
 
 void UHeliMoveComp::BeginPlay()
 {
 	Super::BeginPlay();	
+
+	// same map, same asset: server and clients fly through the same wind
+	WindField = AHeliWindVolume::FindWindField(GetWorld());
+
+	AHeliMovementReplicator* MovementReplicator = AHeliMovementReplicator::Get(this);
+	if (MovementReplicator && GetPawnOwner() && GetPawnOwner()->Role == ROLE_Authority)
+	{
+		MovementReplicator->RegisterMoveComp(this);
+		bReplicatedByMovementReplicator = true;
+	}
+
+	AHeliFlightManager* FlightManager = AHeliFlightManager::Get(this);
+	if (FlightManager && CanUseBatchedFlight() && GetPawnOwner() && GetPawnOwner()->Role == ROLE_Authority)
+	{
+		FlightManager->RegisterMoveComp(this);
+		bFlownByFlightManager = true;
+	}
+}
+
+void UHeliMoveComp::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bReplicatedByMovementReplicator)
+	{
+		AHeliMovementReplicator* MovementReplicator = AHeliMovementReplicator::Get(this);
+		if (MovementReplicator)
+		{
+			MovementReplicator->UnregisterMoveComp(this);
+		}
+		bReplicatedByMovementReplicator = false;
+	}
+
+	if (bFlownByFlightManager)
+	{
+		AHeliFlightManager* FlightManager = AHeliFlightManager::Get(this);
+		if (FlightManager)
+		{
+			FlightManager->UnregisterMoveComp(this);
+		}
+		bFlownByFlightManager = false;
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void UHeliMoveComp::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
@@ -431,44 +1559,114 @@ void UHeliMoveComp::TickComponent(float DeltaTime, enum ELevelTick TickType, FAc
 		return;
 	}	
 
-	bool bLocalPlayerAuthority = GetPawnOwner() && GetPawnOwner()->IsLocallyControlled() && GetPawnOwner()->Role >= ENetRole::ROLE_AutonomousProxy;
+	const bool bIsServer = GetPawnOwner()->Role == ROLE_Authority;
+	const bool bIsLocallyControlled = GetPawnOwner()->IsLocallyControlled();
 
-	// add lift only to pawns that simulate physics
-	if (bAddLift && bLocalPlayerAuthority) {
-		AddLift();
+	// what the pilot pressed while the controls are gone is neither flown nor sent
+	if (bControlsCrashed)
+	{
+		PendingInput.ResetAxes();
 	}
 
-	// apply received replicated movement state for whatever pawn that is NOT locally controlled
-	if (GetPawnOwner() && !GetPawnOwner()->IsLocallyControlled())
+	// [server] remote pilots only send input, the server flies their helicopter
+	bool bStartedServerMove = false;
+	if (bIsServer && !bIsLocallyControlled && bHasServerInput)
 	{
-		if (bUseInterpolationForMovementReplication)
+		// every received input gets at least one tick, the last one is held until a new one arrives
+		if (ServerPendingInputs.Num() > 0)
+		{
+			ServerCurrentInput = ServerPendingInputs[0];
+			ServerPendingInputs.RemoveAt(0, 1, false);
+			bStartedServerMove = true;
+		}
+	}
+
+	UpdateProxyPhysicsMode();
+
+	// flight forces only for pawns that simulate physics (server and predicting owning client)
+	if (IsSimulatingAuthoritatively())
+	{
+		// the whole frame of input as one record
+		FlightInput = (bIsServer && !bIsLocallyControlled) ? ServerCurrentInput : PendingInput;
+		if ((bIsServer && !bIsLocallyControlled && !bHasServerInput) || bControlsCrashed)
+		{
+			FlightInput.ResetAxes();
+		}
+
+		// pilot assist steers through torque like the pilot, see FHeliFlightModel::ComputeAutoRollTorque
+		FlightInput.bAutoRollStabilization = (bIsServer && !bIsLocallyControlled) ? ServerCurrentInput.bAutoRollStabilization : bAutoRollStabilization;
+
+		if (bUseFlightSubstepping)
 		{
-			SetMovementStateSmoothly(ReplicatedMovementState, DeltaTime);
+			FBodyInstance* BodyInstance = bFlownByFlightManager ? nullptr : GetFlightBodyInstance();
+			if (BodyInstance)
+			{
+				// registration only lasts for the next physics step
+				BodyInstance->AddCustomPhysics(OnCalculateFlightPhysics);
+			}
 		}
 		else
 		{
-			SetMovementState(ReplicatedMovementState);
+			ApplyInput(FlightInput);
 		}
 	}
 
-	// send movement state
-	// Don't need to replicate movement in single player games
-	if (GEngine->GetNetMode(GetWorld()) != NM_Standalone)
+	if (bIsServer)
 	{
-		SendMovementState();
+		// server state is the authoritative one
+		ServerMovementState = GetCurrentMovementState();
+
+		// physics has not run yet this frame, this is where the new input starts from
+		if (bStartedServerMove)
+		{
+			ServerAckedMoveState = ServerMovementState;
+			ServerAckedMoveSequence = ServerCurrentInput.Sequence;
+			bHasServerAckedMove = true;
+		}
+
+		if (!bReplicatedByMovementReplicator)
+		{
+			UpdateReplicatedMovementState();
+		}
+
+		if (!bIsLocallyControlled)
+		{
+			SendCorrectionToOwningClient();
+		}
 	}
+	else if (!bIsLocallyControlled)
+	{
+		// apply received replicated movement state for simulated proxies
+		if (bUseInterpolationForMovementReplication)
+		{
+			UpdateSnapshotInterpolation(DeltaTime);
+		}
+		else if (!bHasProxyMovementState || LatestReceivedMovementState.Timestamp != LastProxyMovementState.Timestamp)
+		{
+			// root stays put between updates, the mesh starts from where it was drawn
+			ApplyProxyMovementState(LatestReceivedMovementState, 0.f);
+		}
 
-	if (bAutoRollStabilization)
+		UpdateMeshSmoothing(DeltaTime);
+	}
+	else
 	{
-		AutoRollStabilization(DeltaTime);
+		// owning client sends its input to the server
+		SendMovementState();
 	}
 
+	PendingInput.ResetAxes();
 
 	if (bDrawRole)
 	{
 		DrawDebugString(GetWorld(), FVector(0, 0, 200), GetRoleAsString(GetPawnOwner()->Role), GetPawnOwner(), FColor::White, DeltaTime);
 	}
 
+	if (bDrawSendPolicyStats && bIsLocallyControlled && !bIsServer)
+	{
+		DrawDebugString(GetWorld(), FVector(0, 0, 250), FString::Printf(TEXT("Sent: %d  Suppressed: %d"), NumSentMovementUpdates, NumSuppressedMovementUpdates), GetPawnOwner(), FColor::Yellow, DeltaTime);
+	}
+
 }
 
 //							Replication List
@@ -479,6 +1677,7 @@ void UHeliMoveComp::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & Out
 	//DOREPLIFETIME(UHeliMoveComp, ReplicatedMovementState);
 
 	DOREPLIFETIME_CONDITION(UHeliMoveComp, ReplicatedMovementState, COND_SimulatedOnly);
+	DOREPLIFETIME_CONDITION(UHeliMoveComp, ReplicatedKeyframeState, COND_SimulatedOnly);
 }
 
 
@@ -0,0 +1,269 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliMovementReplicator.h"
+#include "HeliGame.h"
+#include "HeliGameMode.h"
+
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Net/UnrealNetwork.h"
+#include "Engine/World.h"
+
+void FHeliMovementEntry::PostReplicatedAdd(const FHeliMovementEntryArray& InArraySerializer)
+{
+	PostReplicatedChange(InArraySerializer);
+}
+
+void FHeliMovementEntry::PostReplicatedChange(const FHeliMovementEntryArray& InArraySerializer)
+{
+	// owning client predicts its own pawn and gets corrections instead
+	if (Pawn && Pawn->Role == ROLE_SimulatedProxy)
+	{
+		UHeliMoveComp* MoveComp = Cast<UHeliMoveComp>(Pawn->GetMovementComponent());
+		if (MoveComp)
+		{
+			if (InArraySerializer.bKeyframes)
+			{
+				MoveComp->ReceiveReplicatedKeyframe(State);
+			}
+			else
+			{
+				MoveComp->ReceiveReplicatedMovementState(State);
+			}
+		}
+	}
+}
+
+AHeliMovementReplicator::AHeliMovementReplicator(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	// connections replicate, we only keep track of helicopters and players
+	bReplicates = false;
+
+	KeyframeInterval = 0.5f;
+}
+
+AHeliMovementReplicator* AHeliMovementReplicator::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	AHeliGameMode* GameMode = World ? World->GetAuthGameMode<AHeliGameMode>() : nullptr;
+
+	return GameMode ? GameMode->GetMovementReplicator() : nullptr;
+}
+
+void AHeliMovementReplicator::RegisterMoveComp(UHeliMoveComp* MoveComp)
+{
+	if (!MoveComp || Sources.ContainsByPredicate([MoveComp](const FHeliMovementSource& Source) { return Source.MoveComp == MoveComp; }))
+	{
+		return;
+	}
+
+	FHeliMovementSource& Source = Sources[Sources.AddDefaulted()];
+	Source.MoveComp = MoveComp;
+}
+
+void AHeliMovementReplicator::UnregisterMoveComp(UHeliMoveComp* MoveComp)
+{
+	// connections drop their entry on their next update
+	Sources.RemoveAllSwap([MoveComp](const FHeliMovementSource& Source) { return Source.MoveComp == MoveComp; });
+}
+
+void AHeliMovementReplicator::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	UpdateConnections();
+
+	for (FHeliMovementSource& Source : Sources)
+	{
+		if (!Source.MoveComp)
+		{
+			continue;
+		}
+
+		const FMovementState& CurrentState = Source.MoveComp->GetServerMovementState();
+		if (CurrentState.Location.IsNearlyZero())
+		{
+			continue;
+		}
+
+		// every connection encodes against the same keyframe, receivers keep it as the baseline for the next deltas
+		if (!Source.bHasKeyframe || (CurrentState.Timestamp - Source.Keyframe.Timestamp) >= KeyframeInterval)
+		{
+			Source.Keyframe = CurrentState;
+			Source.bHasKeyframe = true;
+		}
+	}
+}
+
+void AHeliMovementReplicator::UpdateConnections()
+{
+	for (int32 Index = Connections.Num() - 1; Index >= 0; --Index)
+	{
+		AHeliMovementReplicatorConnection* Connection = Connections[Index];
+		if (!Connection || Connection->IsPendingKill() || !Connection->GetOwner() || Connection->GetOwner()->IsPendingKill())
+		{
+			if (Connection && !Connection->IsPendingKill())
+			{
+				Connection->Destroy();
+			}
+			Connections.RemoveAtSwap(Index);
+		}
+	}
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+
+		// local players see the server state as it is
+		if (!PlayerController || PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		const bool bHasConnection = Connections.ContainsByPredicate([PlayerController](const AHeliMovementReplicatorConnection* Connection) { return Connection->GetOwner() == PlayerController; });
+		if (bHasConnection)
+		{
+			continue;
+		}
+
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Owner = PlayerController;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+
+		AHeliMovementReplicatorConnection* Connection = GetWorld()->SpawnActor<AHeliMovementReplicatorConnection>(SpawnInfo);
+		if (Connection)
+		{
+			Connection->SetReplicator(this);
+			Connections.Add(Connection);
+		}
+	}
+}
+
+AHeliMovementReplicatorConnection::AHeliMovementReplicatorConnection(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	bReplicates = true;
+	bAlwaysRelevant = false;
+	bOnlyRelevantToOwner = true;
+	NetUpdateFrequency = 30.f;
+	NetPriority = 3.f;
+
+	Keyframes.bKeyframes = true;
+
+	Replicator = nullptr;
+}
+
+bool AHeliMovementReplicatorConnection::IsRelevantForViewer(APawn* Pawn, APlayerController* Viewer, const AActor* ViewTarget, const FVector& ViewLocation) const
+{
+	// the owner predicts its pawn and gets corrections instead
+	if (!Pawn || Pawn->IsPendingKill() || Pawn->IsOwnedBy(Viewer))
+	{
+		return false;
+	}
+
+	// same rules as the actor channel of the pawn, see AHeliNetRelevancyManager
+	return Pawn->IsNetRelevantFor(Viewer, ViewTarget, ViewLocation);
+}
+
+void AHeliMovementReplicatorConnection::AddEntry(UHeliMoveComp* MoveComp)
+{
+	MoveComps.Add(MoveComp);
+
+	FHeliMovementEntry& Keyframe = Keyframes.Items[Keyframes.Items.AddDefaulted()];
+	Keyframe.Pawn = MoveComp->GetPawnOwner();
+
+	FHeliMovementEntry& Entry = Entries.Items[Entries.Items.AddDefaulted()];
+	Entry.Pawn = MoveComp->GetPawnOwner();
+}
+
+void AHeliMovementReplicatorConnection::RemoveEntry(int32 Index)
+{
+	MoveComps.RemoveAtSwap(Index);
+	Keyframes.Items.RemoveAtSwap(Index);
+	Entries.Items.RemoveAtSwap(Index);
+	Keyframes.MarkArrayDirty();
+	Entries.MarkArrayDirty();
+}
+
+void AHeliMovementReplicatorConnection::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	APlayerController* Viewer = Cast<APlayerController>(GetOwner());
+	if (!Replicator || !Viewer)
+	{
+		return;
+	}
+
+	const TArray<FHeliMovementSource>& Sources = Replicator->GetSources();
+
+	const AActor* ViewTarget = Viewer->GetViewTarget() ? Viewer->GetViewTarget() : Viewer;
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	Viewer->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	// drop what is gone or out of sight, the pawn is not relevant anymore on that client either
+	for (int32 Index = MoveComps.Num() - 1; Index >= 0; --Index)
+	{
+		UHeliMoveComp* MoveComp = MoveComps[Index];
+		const bool bRegistered = MoveComp && Sources.ContainsByPredicate([MoveComp](const FHeliMovementSource& Source) { return Source.MoveComp == MoveComp; });
+		if (!bRegistered || !IsRelevantForViewer(MoveComp->GetPawnOwner(), Viewer, ViewTarget, ViewLocation))
+		{
+			RemoveEntry(Index);
+		}
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for (const FHeliMovementSource& Source : Sources)
+	{
+		if (!Source.MoveComp || !Source.bHasKeyframe)
+		{
+			continue;
+		}
+
+		int32 Index = MoveComps.Find(Source.MoveComp);
+		if (Index == INDEX_NONE)
+		{
+			if (!IsRelevantForViewer(Source.MoveComp->GetPawnOwner(), Viewer, ViewTarget, ViewLocation))
+			{
+				continue;
+			}
+
+			Index = MoveComps.Num();
+			AddEntry(Source.MoveComp);
+		}
+
+		FHeliMovementEntry& Keyframe = Keyframes.Items[Index];
+		if (Keyframe.State.Stamp != Source.Keyframe.Stamp || Keyframe.State.Location.IsNearlyZero())
+		{
+			Keyframe.State = Source.Keyframe;
+			Keyframes.MarkItemDirty(Keyframe);
+		}
+
+		// far away helicopters get a lower NetUpdateFrequency from AHeliNetRelevancyManager
+		FHeliMovementEntry& Entry = Entries.Items[Index];
+		const APawn* Pawn = Source.MoveComp->GetPawnOwner();
+		const float SendInterval = Pawn->NetUpdateFrequency > 0.f ? 1.f / Pawn->NetUpdateFrequency : 0.f;
+
+		if ((Now - Entry.LastSentTime) < SendInterval)
+		{
+			continue;
+		}
+
+		Entry.State = Source.MoveComp->GetServerMovementState();
+		Entry.State.EncodeDelta(Source.Keyframe);
+		Entry.LastSentTime = Now;
+		Entries.MarkItemDirty(Entry);
+	}
+}
+
+void AHeliMovementReplicatorConnection::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AHeliMovementReplicatorConnection, Keyframes);
+	DOREPLIFETIME(AHeliMovementReplicatorConnection, Entries);
+}
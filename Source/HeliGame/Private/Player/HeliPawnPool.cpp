@@ -0,0 +1,162 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliPawnPool.h"
+#include "HeliGame.h"
+#include "HeliGameMode.h"
+#include "Helicopter.h"
+
+#include "Public/TimerManager.h"
+#include "Engine/World.h"
+
+AHeliPawnPool::AHeliPawnPool(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = false;
+
+	PawnsPerTeam = 4;
+	ReturnToPoolDelay = 3.f;
+	ParkingLocation = FVector(0.f, 0.f, -50000.f);
+
+	NumReusedPawns = 0;
+	NumSpawnedPawns = 0;
+}
+
+AHeliPawnPool* AHeliPawnPool::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	AHeliGameMode* GameMode = World ? World->GetAuthGameMode<AHeliGameMode>() : nullptr;
+
+	return GameMode ? GameMode->GetPawnPool() : nullptr;
+}
+
+UClass* AHeliPawnPool::GetPawnClass() const
+{
+	return PawnClass;
+}
+
+void AHeliPawnPool::Prewarm(UClass* InPawnClass, int32 NumTeams)
+{
+	if (!InPawnClass || !InPawnClass->IsChildOf(AHelicopter::StaticClass()) || Teams.Num() > 0)
+	{
+		return;
+	}
+
+	PawnClass = InPawnClass;
+
+	// free for all matches have no teams, everybody takes from the first one
+	Teams.SetNum(FMath::Max(NumTeams, 1));
+
+	for (int32 TeamNumber = 0; TeamNumber < Teams.Num(); ++TeamNumber)
+	{
+		for (int32 Index = 0; Index < PawnsPerTeam; ++Index)
+		{
+			AHelicopter* Pawn = SpawnParkedPawn(TeamNumber);
+			if (Pawn)
+			{
+				Teams[TeamNumber].Pawns.Add(Pawn);
+			}
+		}
+	}
+
+	UE_LOG(LogHeliNet, Log, TEXT("PawnPool: %d pawns parked for %d teams"), GetNumParkedPawns(), Teams.Num());
+}
+
+int32 AHeliPawnPool::GetTeamIndex(int32 TeamNumber) const
+{
+	return Teams.IsValidIndex(TeamNumber) ? TeamNumber : 0;
+}
+
+AHelicopter* AHeliPawnPool::SpawnParkedPawn(int32 TeamNumber)
+{
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AHelicopter* Pawn = GetWorld()->SpawnActor<AHelicopter>(PawnClass, ParkingLocation, FRotator::ZeroRotator, SpawnInfo);
+	if (Pawn)
+	{
+		Pawn->SetPoolTeamNumber(TeamNumber);
+		Pawn->ParkInPool(ParkingLocation);
+	}
+
+	return Pawn;
+}
+
+AHelicopter* AHeliPawnPool::AcquirePawn(int32 TeamNumber, const FTransform& SpawnTransform)
+{
+	if (Teams.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	TArray<AHelicopter*>& Pawns = Teams[GetTeamIndex(TeamNumber)].Pawns;
+
+	while (Pawns.Num() > 0)
+	{
+		AHelicopter* Pawn = Pawns.Pop(false);
+		if (Pawn && !Pawn->IsPendingKill())
+		{
+			Pawn->RespawnFromPool(SpawnTransform);
+			NumReusedPawns++;
+			return Pawn;
+		}
+	}
+
+	return nullptr;
+}
+
+void AHeliPawnPool::AddPawn(AHelicopter* Pawn, int32 TeamNumber)
+{
+	if (Pawn && Teams.Num() > 0 && Pawn->GetClass() == PawnClass)
+	{
+		Pawn->SetPoolTeamNumber(GetTeamIndex(TeamNumber));
+		NumSpawnedPawns++;
+	}
+}
+
+void AHeliPawnPool::ReleasePawn(AHelicopter* Pawn)
+{
+	if (!Pawn || Pawn->GetPoolTeamNumber() == INDEX_NONE)
+	{
+		return;
+	}
+
+	// every dead pawn waits on its own, the handle is not needed afterwards
+	FTimerHandle TimerHandle;
+	FTimerDelegate ParkDelegate = FTimerDelegate::CreateUObject(this, &AHeliPawnPool::ParkPawn, TWeakObjectPtr<AHelicopter>(Pawn));
+	GetWorldTimerManager().SetTimer(TimerHandle, ParkDelegate, FMath::Max(ReturnToPoolDelay, 0.01f), false);
+}
+
+void AHeliPawnPool::ParkPawn(TWeakObjectPtr<AHelicopter> Pawn)
+{
+	// a pawn can't be respawned while it waits here, but it may have been destroyed by a map change
+	if (!Pawn.IsValid() || Pawn->IsPendingKill() || Pawn->GetController() != nullptr)
+	{
+		return;
+	}
+
+	Pawn->ParkInPool(ParkingLocation);
+
+	Teams[GetTeamIndex(Pawn->GetPoolTeamNumber())].Pawns.AddUnique(Pawn.Get());
+}
+
+int32 AHeliPawnPool::GetNumParkedPawns() const
+{
+	int32 NumParkedPawns = 0;
+	for (const FHeliPawnPoolTeam& Team : Teams)
+	{
+		NumParkedPawns += Team.Pawns.Num();
+	}
+
+	return NumParkedPawns;
+}
+
+void AHeliPawnPool::DumpStats() const
+{
+	UE_LOG(LogHeliNet, Log, TEXT("PawnPool: %d parked, %d respawns reused a pawn, %d had to spawn one"), GetNumParkedPawns(), NumReusedPawns, NumSpawnedPawns);
+
+	for (int32 TeamNumber = 0; TeamNumber < Teams.Num(); ++TeamNumber)
+	{
+		UE_LOG(LogHeliNet, Log, TEXT("    team %d: %d parked"), TeamNumber, Teams[TeamNumber].Pawns.Num());
+	}
+}
@@ -32,6 +32,20 @@ AHeliPlayerController::AHeliPlayerController(const FObjectInitializer& ObjectIni
 {
 	bAllowGameActions = true;
 	this->SetReplicates(true);
+
+	ServerClockOffset = 0.f;
+	ClockSyncRoundTripTime = 0.f;
+	bHasClockSync = false;
+	NumClockSyncResponses = 0;
+	ClockSyncInterval = 1.f;
+	InitialClockSyncInterval = 0.2f;
+	NumInitialClockSyncs = 5;
+	MaxClockSyncSamples = 8;
+	ClockSyncSmoothing = 0.2f;
+	ClockSyncSnapThreshold = 0.25f;
+	ReportedProxyViewDelay = 0.f;
+
+	NetRelevancyViewerIndex = INDEX_NONE;
 }
 
 
@@ -965,3 +979,124 @@ void AHeliPlayerController::Possess(APawn* aPawn)
 
 	Super::Possess(aPawn);
 }
+
+void AHeliPlayerController::ReceivedPlayer()
+{
+	Super::ReceivedPlayer();
+
+	StartClockSync();
+}
+
+/*
+*	Clock Sync
+*/
+
+void AHeliPlayerController::StartClockSync()
+{
+	// server owns the clock
+	if (Role == ROLE_Authority || !IsLocalController())
+	{
+		return;
+	}
+
+	ClockSyncSamples.Reset();
+	NumClockSyncResponses = 0;
+
+	GetWorldTimerManager().SetTimer(TimerHandle_ClockSync, this, &AHeliPlayerController::RequestClockSync, InitialClockSyncInterval, true, 0.f);
+}
+
+void AHeliPlayerController::RequestClockSync()
+{
+	Server_RequestClockSync(GetWorld()->GetTimeSeconds());
+}
+
+bool AHeliPlayerController::Server_RequestClockSync_Validate(float ClientSendTime)
+{
+	return FMath::IsFinite(ClientSendTime);
+}
+
+void AHeliPlayerController::Server_RequestClockSync_Implementation(float ClientSendTime)
+{
+	Client_ReceiveClockSync(ClientSendTime, GetWorld()->GetTimeSeconds());
+}
+
+void AHeliPlayerController::Client_ReceiveClockSync_Implementation(float ClientSendTime, float ServerTime)
+{
+	const float ClientReceiveTime = GetWorld()->GetTimeSeconds();
+	const float RoundTripTime = ClientReceiveTime - ClientSendTime;
+	if (RoundTripTime < 0.f)
+	{
+		return;
+	}
+
+	// assume the reply took half of the round trip to get here
+	FClockSyncSample Sample;
+	Sample.RoundTripTime = RoundTripTime;
+	Sample.Offset = (ServerTime + RoundTripTime * 0.5f) - ClientReceiveTime;
+
+	if (ClockSyncSamples.Num() >= MaxClockSyncSamples)
+	{
+		ClockSyncSamples.RemoveAt(0, ClockSyncSamples.Num() - MaxClockSyncSamples + 1, false);
+	}
+	ClockSyncSamples.Add(Sample);
+
+	// samples that waited in some queue have a bigger round trip and a less symmetric one, trust the fastest
+	const FClockSyncSample* Best = &ClockSyncSamples[0];
+	for (const FClockSyncSample& Candidate : ClockSyncSamples)
+	{
+		if (Candidate.RoundTripTime < Best->RoundTripTime)
+		{
+			Best = &Candidate;
+		}
+	}
+
+	if (!bHasClockSync || FMath::Abs(Best->Offset - ServerClockOffset) > ClockSyncSnapThreshold)
+	{
+		ServerClockOffset = Best->Offset;
+		ClockSyncRoundTripTime = Best->RoundTripTime;
+		bHasClockSync = true;
+	}
+	else
+	{
+		ServerClockOffset = FMath::Lerp(ServerClockOffset, Best->Offset, ClockSyncSmoothing);
+		ClockSyncRoundTripTime = FMath::Lerp(ClockSyncRoundTripTime, Best->RoundTripTime, ClockSyncSmoothing);
+	}
+
+	// converged, slow down
+	if (++NumClockSyncResponses == NumInitialClockSyncs)
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_ClockSync, this, &AHeliPlayerController::RequestClockSync, ClockSyncInterval, true);
+	}
+}
+
+float AHeliPlayerController::GetSyncedServerTime() const
+{
+	const float LocalTime = GetWorld()->GetTimeSeconds();
+
+	if (Role == ROLE_Authority || !bHasClockSync)
+	{
+		return LocalTime;
+	}
+
+	return LocalTime + ServerClockOffset;
+}
+
+float AHeliPlayerController::GetClockSyncRoundTripTime() const
+{
+	return ClockSyncRoundTripTime;
+}
+
+bool AHeliPlayerController::HasClockSync() const
+{
+	return Role == ROLE_Authority || bHasClockSync;
+}
+
+float AHeliPlayerController::GetReportedProxyViewDelay() const
+{
+	return ReportedProxyViewDelay;
+}
+
+void AHeliPlayerController::SetReportedProxyViewDelay(float Delay)
+{
+	ReportedProxyViewDelay = Delay;
+}
@@ -0,0 +1,125 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliSignificanceManager.h"
+#include "HeliGame.h"
+#include "HeliFighterVehicle.h"
+#include "HeliHud.h"
+
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+
+AHeliSignificanceManager::AHeliSignificanceManager(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+	// significance changes slowly, no need to score every frame
+	PrimaryActorTick.TickInterval = 0.2f;
+
+	bReplicates = false;
+
+	HighScreenSize = 0.1f;
+	MediumScreenSize = 0.02f;
+	OffScreenTime = 0.5f;
+	OffScreenScale = 0.25f;
+}
+
+AHeliSignificanceManager* AHeliSignificanceManager::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	APlayerController* LocalPC = World ? World->GetFirstPlayerController() : nullptr;
+	AHeliHud* HeliHud = LocalPC ? Cast<AHeliHud>(LocalPC->GetHUD()) : nullptr;
+
+	return HeliHud ? HeliHud->GetSignificanceManager() : nullptr;
+}
+
+void AHeliSignificanceManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<AHeliFighterVehicle> It(GetWorld()); It; ++It)
+	{
+		RegisterVehicle(*It);
+	}
+}
+
+void AHeliSignificanceManager::RegisterVehicle(AHeliFighterVehicle* Vehicle)
+{
+	if (Vehicle && !Vehicle->IsPendingKill() && !Vehicles.Contains(Vehicle))
+	{
+		Vehicles.Add(Vehicle);
+	}
+}
+
+void AHeliSignificanceManager::UnregisterVehicle(AHeliFighterVehicle* Vehicle)
+{
+	Vehicles.RemoveSingleSwap(Vehicle, false);
+}
+
+void AHeliSignificanceManager::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	APlayerController* LocalPC = GetWorld()->GetFirstPlayerController();
+	if (!LocalPC)
+	{
+		return;
+	}
+
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	LocalPC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	const float FOV = LocalPC->PlayerCameraManager ? LocalPC->PlayerCameraManager->GetFOVAngle() : 90.f;
+	const float TanHalfFOV = FMath::Tan(FMath::DegreesToRadians(FMath::Clamp(FOV, 1.f, 170.f) * 0.5f));
+
+	const AActor* ViewTarget = LocalPC->GetViewTarget();
+	const APawn* LocalPawn = LocalPC->GetPawn();
+
+	for (int32 Index = Vehicles.Num() - 1; Index >= 0; --Index)
+	{
+		AHeliFighterVehicle* Vehicle = Vehicles[Index];
+		if (!Vehicle || Vehicle->IsPendingKill())
+		{
+			Vehicles.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		EHeliSignificance NewSignificance = EHeliSignificance::Low;
+		if (Vehicle == ViewTarget || Vehicle == LocalPawn)
+		{
+			// our own helicopter, or the one we are spectating
+			NewSignificance = EHeliSignificance::High;
+		}
+		else
+		{
+			const float ScreenSize = ComputeScreenSize(Vehicle, ViewLocation, TanHalfFOV);
+			if (ScreenSize >= HighScreenSize)
+			{
+				NewSignificance = EHeliSignificance::High;
+			}
+			else if (ScreenSize >= MediumScreenSize)
+			{
+				NewSignificance = EHeliSignificance::Medium;
+			}
+		}
+
+		Vehicle->SetSignificance(NewSignificance);
+	}
+}
+
+float AHeliSignificanceManager::ComputeScreenSize(const AHeliFighterVehicle* Vehicle, const FVector& ViewLocation, float TanHalfFOV) const
+{
+	const FBoxSphereBounds Bounds = Vehicle->GetRootComponent() ? Vehicle->GetRootComponent()->Bounds : FBoxSphereBounds(Vehicle->GetActorLocation(), FVector::ZeroVector, 0.f);
+
+	const float Distance = FMath::Max(FVector::Dist(ViewLocation, Bounds.Origin), 1.f);
+	float ScreenSize = Bounds.SphereRadius / (Distance * TanHalfFOV);
+
+	if (!Vehicle->WasRecentlyRendered(OffScreenTime))
+	{
+		ScreenSize *= OffScreenScale;
+	}
+
+	return ScreenSize;
+}
@@ -0,0 +1,122 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliWindField.h"
+#include "HeliGame.h"
+
+namespace
+{
+	int8 QuantizeWind(float Value, float MaxValue)
+	{
+		return static_cast<int8>(FMath::Clamp(FMath::RoundToInt(Value / MaxValue * 127.f), -127, 127));
+	}
+}
+
+UHeliWindField::UHeliWindField(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	Origin = FVector::ZeroVector;
+	CellSize = 2000.f;
+	Dimensions = FIntVector::ZeroValue;
+	MaxWindSpeed = 0.f;
+	MaxTurbulenceSpeed = 0.f;
+	TurbulenceFrequency = 0.5f;
+}
+
+bool UHeliWindField::IsValidField() const
+{
+	return Dimensions.X >= 2 && Dimensions.Y >= 2 && Dimensions.Z >= 2 && CellSize > 0.f
+		&& Cells.Num() == Dimensions.X * Dimensions.Y * Dimensions.Z;
+}
+
+FHeliFlightWind UHeliWindField::Sample(const FVector& Location, float ServerTime) const
+{
+	FHeliFlightWind Wind;
+	if (!IsValidField())
+	{
+		return Wind;
+	}
+
+	// grid coordinates, the last cell of every axis starts one point before its end
+	const FVector GridLocation = (Location - Origin) / CellSize;
+
+	const float X = FMath::Clamp(GridLocation.X, 0.f, Dimensions.X - 1.f);
+	const float Y = FMath::Clamp(GridLocation.Y, 0.f, Dimensions.Y - 1.f);
+	const float Z = FMath::Clamp(GridLocation.Z, 0.f, Dimensions.Z - 1.f);
+
+	const int32 X0 = FMath::Min(FMath::FloorToInt(X), Dimensions.X - 2);
+	const int32 Y0 = FMath::Min(FMath::FloorToInt(Y), Dimensions.Y - 2);
+	const int32 Z0 = FMath::Min(FMath::FloorToInt(Z), Dimensions.Z - 2);
+
+	const float Alpha[3] = { X - X0, Y - Y0, Z - Z0 };
+
+	FVector WindSum = FVector::ZeroVector;
+	FVector TurbulenceSum = FVector::ZeroVector;
+	float GroundProximitySum = 0.f;
+
+	for (int32 Corner = 0; Corner < 8; ++Corner)
+	{
+		const int32 DX = Corner & 1;
+		const int32 DY = (Corner >> 1) & 1;
+		const int32 DZ = (Corner >> 2) & 1;
+
+		const float Weight = (DX ? Alpha[0] : 1.f - Alpha[0]) * (DY ? Alpha[1] : 1.f - Alpha[1]) * (DZ ? Alpha[2] : 1.f - Alpha[2]);
+
+		const FHeliWindCell& Cell = Cells[GetCellIndex(X0 + DX, Y0 + DY, Z0 + DZ)];
+
+		WindSum += FVector(Cell.WindX, Cell.WindY, Cell.WindZ) * Weight;
+		TurbulenceSum += FVector(Cell.TurbulenceX, Cell.TurbulenceY, Cell.TurbulenceZ) * Weight;
+		GroundProximitySum += Cell.GroundProximity * Weight;
+	}
+
+	Wind.Velocity = WindSum * (MaxWindSpeed / 127.f);
+	// gusts come and go, neighbouring air is a little out of phase and every axis swings on its own
+	const float Phase = 2.f * PI * TurbulenceFrequency * ServerTime + (X * 1.7f + Y * 2.3f + Z * 2.9f);
+	const FVector Swing(FMath::Sin(Phase), FMath::Sin(Phase + 2.1f), FMath::Sin(Phase + 4.2f));
+
+	Wind.Turbulence = TurbulenceSum * Swing * (MaxTurbulenceSpeed / 127.f);
+	Wind.GroundProximity = GroundProximitySum / 255.f;
+
+	return Wind;
+}
+
+void UHeliWindField::Store(const FVector& InOrigin, float InCellSize, const FIntVector& InDimensions, const TArray<FHeliFlightWind>& Winds)
+{
+	const int32 NumCells = InDimensions.X * InDimensions.Y * InDimensions.Z;
+	if (Winds.Num() != NumCells)
+	{
+		UE_LOG(LogHeliFlight, Warning, TEXT("WindField %s: %d winds for %d grid points, not stored"), *GetName(), Winds.Num(), NumCells);
+		return;
+	}
+
+	Origin = InOrigin;
+	CellSize = InCellSize;
+	Dimensions = InDimensions;
+
+	// the fastest component of the map sets the scale of a byte
+	MaxWindSpeed = KINDA_SMALL_NUMBER;
+	MaxTurbulenceSpeed = KINDA_SMALL_NUMBER;
+	for (const FHeliFlightWind& Wind : Winds)
+	{
+		MaxWindSpeed = FMath::Max(MaxWindSpeed, Wind.Velocity.GetAbsMax());
+		MaxTurbulenceSpeed = FMath::Max(MaxTurbulenceSpeed, Wind.Turbulence.GetAbsMax());
+	}
+
+	Cells.SetNum(NumCells);
+	for (int32 Index = 0; Index < NumCells; ++Index)
+	{
+		const FHeliFlightWind& Wind = Winds[Index];
+		FHeliWindCell& Cell = Cells[Index];
+
+		Cell.WindX = QuantizeWind(Wind.Velocity.X, MaxWindSpeed);
+		Cell.WindY = QuantizeWind(Wind.Velocity.Y, MaxWindSpeed);
+		Cell.WindZ = QuantizeWind(Wind.Velocity.Z, MaxWindSpeed);
+		Cell.TurbulenceX = QuantizeWind(Wind.Turbulence.X, MaxTurbulenceSpeed);
+		Cell.TurbulenceY = QuantizeWind(Wind.Turbulence.Y, MaxTurbulenceSpeed);
+		Cell.TurbulenceZ = QuantizeWind(Wind.Turbulence.Z, MaxTurbulenceSpeed);
+		Cell.GroundProximity = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Wind.GroundProximity * 255.f), 0, 255));
+	}
+
+	MarkPackageDirty();
+
+	UE_LOG(LogHeliFlight, Log, TEXT("WindField %s: %dx%dx%d grid points, %.1f KB"), *GetName(), Dimensions.X, Dimensions.Y, Dimensions.Z,
+		Cells.Num() * sizeof(FHeliWindCell) / 1024.f);
+}
@@ -5,7 +5,10 @@
 #include "HeliMoveComp.h"
 #include "HeliProjectile.h"
 #include "HeliPlayerState.h"
+#include "HeliPlayerController.h"
 #include "HeliGameUserSettings.h"
+#include "HeliPawnPool.h"
+#include "Weapon.h"
 
 #include "Curves/CurveFloat.h"
 #include "Sound/SoundCue.h"
@@ -13,6 +16,7 @@
 #include "Public/Engine.h"
 #include "Components/AudioComponent.h"
 #include "Components/StaticMeshComponent.h"
+#include "Net/UnrealNetwork.h"
 
 
 AHelicopter::AHelicopter(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
@@ -56,6 +60,7 @@ AHelicopter::AHelicopter(const FObjectInitializer& ObjectInitializer) : Super(Ob
 	// min and max pitch for rotor sound
 	MaxRotorPitch = 1.11f;
 	MinRotorPitch = 0.88f;
+	RotorPitch = 1.f;
 
 	// max speed of the main and tail rotors
 	RotorMaxSpeed = 50.f;
@@ -73,6 +78,14 @@ AHelicopter::AHelicopter(const FObjectInitializer& ObjectInitializer) : Super(Ob
 	TailRotorMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	TailRotorMeshComponent->SetSimulatePhysics(false);
 
+	// hidden copy of the main mesh, only remote helicopters draw it
+	ProxyMeshComponent = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("ProxyMeshComp"));
+	ProxyMeshComponent->AttachToComponent(MainStaticMeshComponent, FAttachmentTransformRules::KeepRelativeTransform);
+	ProxyMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	ProxyMeshComponent->SetSimulatePhysics(false);
+	ProxyMeshComponent->bGenerateOverlapEvents = false;
+	ProxyMeshComponent->SetVisibility(false);
+
 
 	// HUD Throttle
 	// throttle power starts at 55% and minimum at 10%
@@ -86,8 +99,10 @@ AHelicopter::AHelicopter(const FObjectInitializer& ObjectInitializer) : Super(Ob
 
 	// Health and repairing settings	
 	HealthRegenRate = 0.5f;
-	LastHealedTime = 0.0f;
 	MinRestoreHealthValue = 1.f;
+	MaxRepairHealthPercent = 1.f;
+	bIsRepairing = false;
+	RepairServerTime = 0.f;
 	RepairVelocityThreshould = 100.f;
 
 	// crash impact settings
@@ -144,6 +159,8 @@ void AHelicopter::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
+	PilotMoveComp = Cast<UHeliMoveComp>(HeliMovementComponent);
+
 	// setup user settings
 	UHeliGameUserSettings* heliGameUserSettings = Cast<UHeliGameUserSettings>(GEngine->GetGameUserSettings());
 	if (heliGameUserSettings)
@@ -161,9 +178,14 @@ void AHelicopter::BeginPlay()
 
 	Super::BeginPlay();
 
-	// Use a local timer handle as we don't need to store it for later but we don't need to look for something to clear
-	FTimerHandle TimerHandle;
-	GetWorld()->GetTimerManager().SetTimer(TimerHandle, this, &AHelicopter::InitHelicopter, SpawnDelay, false);
+	// waiting in the pool, RespawnFromPool starts it
+	if (IsParkedInPool())
+	{
+		DisableHelicopter();
+		return;
+	}
+
+	GetWorld()->GetTimerManager().SetTimer(TimerHandle_InitHelicopter, this, &AHelicopter::InitHelicopter, SpawnDelay, false);
 }
 
 /** Tell client that the Pawn is begin restarted. Calls Restart(). */
@@ -172,6 +194,15 @@ void AHelicopter::PawnClientRestart()
 	//UE_LOG(LogTemp, Display, TEXT("AHelicopter::PawnClientRestart - %f"), GetWorld()->GetRealTimeSeconds());
 
 	Super::PawnClientRestart();
+
+	UpdateProxyMesh();
+}
+
+void AHelicopter::OnRep_Controller()
+{
+	Super::OnRep_Controller();
+
+	UpdateProxyMesh();
 }
 
 /**
@@ -183,106 +214,87 @@ void AHelicopter::PossessedBy(class AController* InController)
 	//UE_LOG(LogTemp, Display, TEXT("AHelicopter::PossessedBy ~ %s %s Role %d and RemoteRole %d"), InController->IsLocalPlayerController() ? *FString::Printf(TEXT("Local")) : *FString::Printf(TEXT("Remote")), *InController->GetName(), (int32)InController->Role, (int32)InController->GetRemoteRole());
 
 	Super::PossessedBy(InController);	
+
+	UpdateProxyMesh();
 }
 
 /*
 6-DoF Physics based movements
 */
 
-void AHelicopter::MousePitch(float Value)
+UHeliMoveComp* AHelicopter::GetPilotMoveComp() const
 {
 	AHeliPlayerController* MyPC = Cast<AHeliPlayerController>(Controller);
-	if (MyPC && MyPC->IsGameInputAllowed() && Value != 0.f)
+
+	return (MyPC && MyPC->IsGameInputAllowed()) ? PilotMoveComp : nullptr;
+}
+
+void AHelicopter::MousePitch(float Value)
+{
+	UHeliMoveComp* MovementComponent = Value != 0.f ? GetPilotMoveComp() : nullptr;
+	if (MovementComponent)
 	{
-		UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
-		if (MovementComponent)
-		{
-			MovementComponent->AddPitch(Value*MouseSensitivity*InvertedAim);
-		}
+		MovementComponent->AddPitch(Value*MouseSensitivity*InvertedAim);
 	}
 }
 
 void AHelicopter::MouseYaw(float Value)
 {
-	AHeliPlayerController* MyPC = Cast<AHeliPlayerController>(Controller);
-	if (MyPC && MyPC->IsGameInputAllowed() && Value != 0.f)
+	UHeliMoveComp* MovementComponent = Value != 0.f ? GetPilotMoveComp() : nullptr;
+	if (MovementComponent)
 	{
-		UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
-		if (MovementComponent)
-		{
-			MovementComponent->AddYaw(Value*MouseSensitivity);
-		}
+		MovementComponent->AddYaw(Value*MouseSensitivity);
 	}
 }
 
 void AHelicopter::MouseRoll(float Value)
 {
-	AHeliPlayerController* MyPC = Cast<AHeliPlayerController>(Controller);
-	if (MyPC && MyPC->IsGameInputAllowed() && Value != 0.f)
+	UHeliMoveComp* MovementComponent = Value != 0.f ? GetPilotMoveComp() : nullptr;
+	if (MovementComponent)
 	{
-		UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
-		if (MovementComponent)
-		{
-			MovementComponent->AddRoll(Value*MouseSensitivity);
-		}
+		MovementComponent->AddRoll(Value*MouseSensitivity);
 	}
 }
 
 void AHelicopter::KeyboardPitch(float Value)
 {
-	AHeliPlayerController* MyPC = Cast<AHeliPlayerController>(Controller);
-	if (MyPC && MyPC->IsGameInputAllowed() && Value != 0.f)
+	UHeliMoveComp* MovementComponent = Value != 0.f ? GetPilotMoveComp() : nullptr;
+	if (MovementComponent)
 	{
-		UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
-		if (MovementComponent)
-		{
-			MovementComponent->AddPitch(Value*KeyboardSensitivity);
-		}
+		MovementComponent->AddPitch(Value*KeyboardSensitivity);
 	}
 }
 
 void AHelicopter::KeyboardYaw(float Value)
 {
-	AHeliPlayerController* MyPC = Cast<AHeliPlayerController>(Controller);
-	if (MyPC && MyPC->IsGameInputAllowed() && Value != 0.f)
+	UHeliMoveComp* MovementComponent = Value != 0.f ? GetPilotMoveComp() : nullptr;
+	if (MovementComponent)
 	{
-		UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
-		if (MovementComponent)
-		{
-			MovementComponent->AddYaw(Value*KeyboardSensitivity);
-		}
+		MovementComponent->AddYaw(Value*KeyboardSensitivity);
 	}
 }
 
 void AHelicopter::KeyboardRoll(float Value)
 {
-	AHeliPlayerController* MyPC = Cast<AHeliPlayerController>(Controller);
-	if (MyPC && MyPC->IsGameInputAllowed() && Value != 0.f)
+	UHeliMoveComp* MovementComponent = Value != 0.f ? GetPilotMoveComp() : nullptr;
+	if (MovementComponent)
 	{
-		UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
-		if (MovementComponent)
-		{
-			MovementComponent->AddRoll(Value*KeyboardSensitivity);
-		}
+		MovementComponent->AddRoll(Value*KeyboardSensitivity);
 	}
 }
 
 void AHelicopter::Thrust(float Value)
 {
-	AHeliPlayerController* MyPC = Cast<AHeliPlayerController>(Controller);
-	if (MyPC && MyPC->IsGameInputAllowed() && Value != 0.f)
+	UHeliMoveComp* MovementComponent = Value != 0.f ? GetPilotMoveComp() : nullptr;
+	if (MovementComponent)
 	{
-		UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
-		if (MovementComponent)
-		{
-			MovementComponent->AddThrust(Value);
-		}
+		MovementComponent->AddThrust(Value);
 	}
 }
 
 void AHelicopter::SwitchCameraViewpoint()
 {
-	if (SpringArmFirstPerson->IsActive())
+	if (IsFirstPersonView())
 	{
 		EnableThirdPersonViewpoint();
 		DisableFirstPersonHud();
@@ -298,6 +310,92 @@ UStaticMeshComponent* AHelicopter::GetHeliMeshComponent()
 	return MainStaticMeshComponent;
 }
 
+USceneComponent* AHelicopter::GetWeaponAttachComponent() const
+{
+	return (ProxyMeshComponent && ProxyMeshComponent->IsVisible()) ? ProxyMeshComponent : Super::GetWeaponAttachComponent();
+}
+
+void AHelicopter::EnableProxyMesh()
+{
+	UHeliMoveComp* heliMovementComponent = Cast<UHeliMoveComp>(HeliMovementComponent);
+	if (!ProxyMeshComponent || ProxyMeshComponent->IsVisible() || !heliMovementComponent)
+	{
+		return;
+	}
+
+	// same mesh and materials the blueprint gave to the collision mesh
+	ProxyMeshComponent->SetStaticMesh(MainStaticMeshComponent->GetStaticMesh());
+	for (int32 MaterialIndex = 0; MaterialIndex < MainStaticMeshComponent->GetNumMaterials(); ++MaterialIndex)
+	{
+		ProxyMeshComponent->SetMaterial(MaterialIndex, MainStaticMeshComponent->GetMaterial(MaterialIndex));
+	}
+
+	// rotors and weapon follow the drawn mesh, cameras and health bar stay on the root
+	TArray<USceneComponent*> AttachedComponents = MainStaticMeshComponent->GetAttachChildren();
+	for (USceneComponent* AttachedComponent : AttachedComponents)
+	{
+		if (AttachedComponent && AttachedComponent != ProxyMeshComponent && AttachedComponent->IsA<UMeshComponent>())
+		{
+			AttachedComponent->AttachToComponent(ProxyMeshComponent, FAttachmentTransformRules::KeepRelativeTransform, AttachedComponent->GetAttachSocketName());
+		}
+	}
+
+	// collision mesh keeps colliding, it is just not drawn anymore
+	MainStaticMeshComponent->SetVisibility(false);
+	ProxyMeshComponent->SetVisibility(true);
+
+	heliMovementComponent->SetSmoothedMeshComponent(ProxyMeshComponent);
+}
+
+void AHelicopter::DisableProxyMesh()
+{
+	if (!ProxyMeshComponent)
+	{
+		return;
+	}
+
+	TArray<USceneComponent*> AttachedComponents = ProxyMeshComponent->GetAttachChildren();
+	for (USceneComponent* AttachedComponent : AttachedComponents)
+	{
+		if (AttachedComponent)
+		{
+			AttachedComponent->AttachToComponent(MainStaticMeshComponent, FAttachmentTransformRules::KeepRelativeTransform, AttachedComponent->GetAttachSocketName());
+		}
+	}
+
+	// smoothing leaves an offset behind, EnableProxyMesh takes the relative transform as the base one
+	ProxyMeshComponent->SetRelativeTransform(FTransform::Identity);
+	ProxyMeshComponent->SetVisibility(false);
+
+	UHeliMoveComp* heliMovementComponent = Cast<UHeliMoveComp>(HeliMovementComponent);
+	if (heliMovementComponent)
+	{
+		heliMovementComponent->SetSmoothedMeshComponent(nullptr);
+	}
+}
+
+void AHelicopter::UpdateProxyMesh()
+{
+	// dead or respawning, InitHelicopter decides when we fly again
+	if (!MainStaticMeshComponent || !IsAlive() || GetWorldTimerManager().IsTimerActive(TimerHandle_InitHelicopter))
+	{
+		return;
+	}
+
+	if (IsLocallyControlled() || HasAuthority())
+	{
+		if (ProxyMeshComponent && ProxyMeshComponent->IsVisible())
+		{
+			DisableProxyMesh();
+			MainStaticMeshComponent->SetVisibility(true);
+		}
+	}
+	else
+	{
+		EnableProxyMesh();
+	}
+}
+
 void AHelicopter::DebugSomething()
 {	
 	UE_LOG(LogTemp, Warning, TEXT("AHelicopter::DebugSomething - %s - %s Team %d"), *GetName(), *GetPlayerName().ToString(), GetTeamNumber());	
@@ -316,10 +414,7 @@ void AHelicopter::ThrottleUpInput()
 
 	GetWorld()->GetTimerManager().SetTimer(ThrottleDisplayTimerHandle, this, &AHelicopter::UpdatesThrottleForDisplayingAdd, RefreshThrottleTime, true);
 
-	if (MainAudioComponent)
-	{
-		MainAudioComponent->SetPitchMultiplier(MaxRotorPitch);
-	}
+	SetRotorPitch(MaxRotorPitch);
 }
 
 void AHelicopter::ThrottleDownInput()
@@ -334,10 +429,7 @@ void AHelicopter::ThrottleDownInput()
 
 	GetWorld()->GetTimerManager().SetTimer(ThrottleDisplayTimerHandle, this, &AHelicopter::UpdatesThrottleForDisplayingSub, RefreshThrottleTime, true);
 
-	if (MainAudioComponent)
-	{
-		MainAudioComponent->SetPitchMultiplier(MinRotorPitch);
-	}
+	SetRotorPitch(MinRotorPitch);
 }
 
 void AHelicopter::ThrottleReleased()
@@ -356,10 +448,7 @@ void AHelicopter::ThrottleReleased()
 		GetWorld()->GetTimerManager().SetTimer(ThrottleDisplayTimerHandle, this, &AHelicopter::UpdatesThrottleForDisplayingAdd, RefreshThrottleTime, true);
 	}
 
-	if (MainAudioComponent)
-	{
-		MainAudioComponent->SetPitchMultiplier(1.0f);
-	}
+	SetRotorPitch(1.0f);
 }
 
 
@@ -398,11 +487,71 @@ float AHelicopter::GetThrottle()
 void AHelicopter::ApplyRotationOnRotors()
 {
 	if (MainRotorMeshComponent && TailRotorMeshComponent) {
+		// fewer updates by bigger steps keep the same rotor speed
+		const float RotorStep = RotorMaxSpeed * (GetSignificance() == EHeliSignificance::Medium ? FMath::Max(MediumSignificanceRotorStepMultiplier, 1) : 1);
+
 		// add yaw rotation for the main rotor
-		MainRotorMeshComponent->AddLocalRotation(FRotator(0, RotorMaxSpeed, 0));
+		MainRotorMeshComponent->AddLocalRotation(FRotator(0, RotorStep, 0));
 
 		// add pitch rotation for the tail rotor
-		TailRotorMeshComponent->AddLocalRotation(FRotator(RotorMaxSpeed, 0, 0));
+		TailRotorMeshComponent->AddLocalRotation(FRotator(RotorStep, 0, 0));
+	}
+}
+
+void AHelicopter::UpdateRotorAnimation()
+{
+	GetWorldTimerManager().ClearTimer(RotorAnimTimerHandle);
+
+	if (!bRotorsSpinning || !MainRotorMeshComponent || !TailRotorMeshComponent || GetSignificance() == EHeliSignificance::Low)
+	{
+		return;
+	}
+
+	const float RotorAnimationInterval = MaxTimeRotorAnimation * (GetSignificance() == EHeliSignificance::Medium ? FMath::Max(MediumSignificanceRotorStepMultiplier, 1) : 1);
+	GetWorldTimerManager().SetTimer(RotorAnimTimerHandle, this, &AHelicopter::ApplyRotationOnRotors, RotorAnimationInterval, true);
+}
+
+void AHelicopter::SetRotorsVisibility(bool bNewVisibility)
+{
+	if (MainRotorMeshComponent && TailRotorMeshComponent)
+	{
+		MainRotorMeshComponent->SetVisibility(bNewVisibility);
+		TailRotorMeshComponent->SetVisibility(bNewVisibility);
+	}
+}
+
+void AHelicopter::StripCosmeticComponents()
+{
+	Super::StripCosmeticComponents();
+
+	DestroyCosmeticComponent(MainRotorMeshComponent);
+	DestroyCosmeticComponent(TailRotorMeshComponent);
+	DestroyCosmeticComponent(ProxyMeshComponent);
+}
+
+void AHelicopter::SetSignificance(EHeliSignificance NewSignificance)
+{
+	if (GetSignificance() == NewSignificance)
+	{
+		return;
+	}
+
+	Super::SetSignificance(NewSignificance);
+
+	UpdateRotorAnimation();
+
+	// what changed while we were not listening
+	SetRotorPitch(RotorPitch);
+}
+
+void AHelicopter::SetRotorPitch(float NewRotorPitch)
+{
+	RotorPitch = NewRotorPitch;
+
+	// the engine loop keeps playing at low significance, it is only not worth updating
+	if (MainAudioComponent && GetSignificance() != EHeliSignificance::Low)
+	{
+		MainAudioComponent->SetPitchMultiplier(RotorPitch);
 	}
 }
 
@@ -443,36 +592,80 @@ void AHelicopter::EnableFirstPersonHud()
 
 void AHelicopter::OnCrashImpact(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	// the server simulates every helicopter and gets its own hit notifications, clients have no say in crash damage
+	if (!HasAuthority() || bIsDying)
+	{
+		return;
+	}
+
 	AHeliProjectile* HeliProjectile = Cast<AHeliProjectile>(OtherActor);
 	if (HeliProjectile)
 	{
 		return;
 	}
 
-	float Damage = ComputeCrashImpactDamage();
+	// scraping the terrain fires dozens of small hits per frame
+	if (NormalImpulse.SizeSquared() < FMath::Square(MinCrashImpactImpulse))
+	{
+		return;
+	}
+
+	CrashWindowDamage = FMath::Max(CrashWindowDamage, ComputeCrashImpactDamage());
 
-	if (Damage > 0.f)
+	if (!GetWorldTimerManager().IsTimerActive(TimerHandle_CrashImpactWindow))
 	{
-		Server_CrashImpactTakeDamage(Damage);
-		//UE_LOG(LogTemp, Error, TEXT("Damage = %f"), Damage);
+		GetWorldTimerManager().SetTimer(TimerHandle_CrashImpactWindow, this, &AHelicopter::EvaluateCrashImpact, CrashImpactWindow, false);
+	}
+}
+
+void AHelicopter::EvaluateCrashImpact()
+{
+	const float Damage = FMath::Min(CrashWindowDamage, MaxHealth * MaxCrashDamagePerWindow);
+
+	CrashWindowDamage = 0.f;
+
+	if (Damage <= 0.f || bIsDying)
+	{
+		return;
+	}
+
+	// decrease its health
+	Health -= Damage;
+
+	if (Health <= 0)
+	{
+		KilledBy(this);
+		return;
 	}
 
 	if (Damage >= (MaxHealth * CrashControlsOnImpactThreshold))
 	{
+		// only once per crash, the controls are already gone until the restore timer fires
+		if (!TimerHandle_RestoreControls.IsValid() && !IsLocallyControlled())
+		{
+			Client_CrashControls();
+		}
+
 		CrashControls();
-		
+
 		// TODO(andrey): 
 		// 1 - notify on HUD that controls are damaged
 		// 2 - impact crash HARD sound		
 	}
 }
 
+void AHelicopter::Client_CrashControls_Implementation()
+{
+	CrashControls();
+}
+
 void AHelicopter::CrashControls()
 {
 	UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
 	if (MovementComponent)
 	{
-		MovementComponent->SetActive(false);
+		// the component keeps ticking, the server still has to fly it and send corrections
+		MovementComponent->SetControlsCrashed(true);
 
 		// restore controls back to normal after some time
 		if (!TimerHandle_RestoreControls.IsValid())
@@ -481,10 +674,7 @@ void AHelicopter::CrashControls()
 		}
 	}
 
-	if (MainAudioComponent)
-	{
-		MainAudioComponent->SetPitchMultiplier(MinRotorPitch);
-	}
+	SetRotorPitch(MinRotorPitch);
 }
 
 void AHelicopter::RestoreControlsAfterCrashImpact()
@@ -492,15 +682,12 @@ void AHelicopter::RestoreControlsAfterCrashImpact()
 	UHeliMoveComp* MovementComponent = Cast<UHeliMoveComp>(GetMovementComponent());
 	if (MovementComponent)
 	{
-		MovementComponent->SetActive(true);
+		MovementComponent->SetControlsCrashed(false);
 
 		GetWorldTimerManager().ClearTimer(TimerHandle_RestoreControls);
 	}
 
-	if (MainAudioComponent)
-	{
-		MainAudioComponent->SetPitchMultiplier(1.f);
-	}
+	SetRotorPitch(1.f);
 }
 
 float AHelicopter::ComputeCrashImpactDamage()
@@ -528,78 +715,227 @@ float AHelicopter::ComputeCrashImpactDamage()
 	return ActualDamage;
 }
 
-bool AHelicopter::Server_CrashImpactTakeDamage_Validate(float Damage)
+
+/***************************************************************************************
+*                                       Health Regeneration                            *
+****************************************************************************************/
+float AHelicopter::GetRepairHealthPerSecond() const
 {
-	return true;
+	return HealthRegenRate > 0.f ? MinRestoreHealthValue / HealthRegenRate : 0.f;
 }
 
-void AHelicopter::Server_CrashImpactTakeDamage_Implementation(float Damage)
+float AHelicopter::GetCurrentHealth() const
 {
-	if (Damage > 0.f)
+	if (!bIsRepairing)
 	{
-		// decrease its health
-		Health -= Damage;
+		return Health;
+	}
 
-		if (Health <= 0)
-		{
-			KilledBy(this);
-		}
+	AHeliPlayerController* LocalPlayerController = Cast<AHeliPlayerController>(GetWorld()->GetFirstPlayerController());
+	const float ServerTime = LocalPlayerController ? LocalPlayerController->GetSyncedServerTime() : GetWorld()->GetTimeSeconds();
+
+	// never further than the next commit, the server may have stopped the repair in between
+	const float Elapsed = FMath::Clamp(ServerTime - RepairServerTime, 0.f, HealthRegenRate);
+
+	return FMath::Max(Health, FMath::Min(Health + GetRepairHealthPerSecond() * Elapsed, MaxHealth * MaxRepairHealthPercent));
+}
+
+void AHelicopter::StartRepair()
+{
+	if (bIsDying || bIsRepairing || GetVelocity().GetAbsMax() > RepairVelocityThreshould || Health >= MaxHealth * MaxRepairHealthPercent)
+	{
+		return;
 	}
+
+	bIsRepairing = true;
+	RepairServerTime = GetWorld()->GetTimeSeconds();
+
+	GetWorldTimerManager().SetTimer(TimerHandle_RestoreHealth, this, &AHelicopter::HandleRepairing, HealthRegenRate, true);
 }
 
+void AHelicopter::StopRepair()
+{
+	if (!bIsRepairing)
+	{
+		return;
+	}
+
+	CommitRepair();
 
-/***************************************************************************************
-*                                       Health Regeneration                            *
-****************************************************************************************/
-void AHelicopter::HandleRepairing()
+	bIsRepairing = false;
+	GetWorldTimerManager().ClearTimer(TimerHandle_RestoreHealth);
+}
+
+void AHelicopter::CommitRepair()
 {
-	if (IsLocallyControlled() && !(GetVelocity().GetAbsMax() > RepairVelocityThreshould))
+	const float ServerTime = GetWorld()->GetTimeSeconds();
+	const float MaxRepairHealth = MaxHealth * MaxRepairHealthPercent;
+
+	if (!bIsDying && Health < MaxRepairHealth)
 	{
-		// local client will notify server
-		if (Role < ROLE_Authority)
-		{
-			Server_AddHealth(MinRestoreHealthValue);
-		}
-		else
-		{
-			Health = (Health + MinRestoreHealthValue) <= MaxHealth ? (Health + MinRestoreHealthValue) : MaxHealth;
-		}
+		Health = FMath::Min(Health + GetRepairHealthPerSecond() * (ServerTime - RepairServerTime), MaxRepairHealth);
+	}
 
+	RepairServerTime = ServerTime;
+}
 
-		GetWorldTimerManager().SetTimer(TimerHandle_RestoreHealth, this, &AHelicopter::HandleRepairing, HealthRegenRate, false);
+void AHelicopter::HandleRepairing()
+{
+	CommitRepair();
+
+	if (bIsDying || GetVelocity().GetAbsMax() > RepairVelocityThreshould || Health >= MaxHealth * MaxRepairHealthPercent)
+	{
+		StopRepair();
 	}
+}
+
+bool AHelicopter::Server_StartRepair_Validate()
+{
+	return true;
+}
 
-	LastHealedTime = GetWorld()->GetTimeSeconds();
+void AHelicopter::Server_StartRepair_Implementation()
+{
+	StartRepair();
 }
 
-bool AHelicopter::Server_AddHealth_Validate(float Value)
+bool AHelicopter::Server_StopRepair_Validate()
 {
 	return true;
 }
 
-void AHelicopter::Server_AddHealth_Implementation(float Value)
+void AHelicopter::Server_StopRepair_Implementation()
 {
-	Health = (Health + MinRestoreHealthValue) <= MaxHealth ? (Health + MinRestoreHealthValue) : MaxHealth;
+	StopRepair();
 }
 
 void AHelicopter::OnStartRepair()
 {
-	const float GameTime = GetWorld()->GetTimeSeconds();
-
-	if (LastHealedTime > 0 && HealthRegenRate > 0.0f &&
-		LastHealedTime + HealthRegenRate > GameTime)
+	// one request, the server keeps repairing until we let go or fly away
+	if (Role < ROLE_Authority)
 	{
-		GetWorldTimerManager().SetTimer(TimerHandle_RestoreHealth, this, &AHelicopter::HandleRepairing, (LastHealedTime + HealthRegenRate - GameTime), false);
+		Server_StartRepair();
 	}
 	else
 	{
-		HandleRepairing();
+		StartRepair();
 	}
 }
 
 void AHelicopter::OnStopRepair()
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_RestoreHealth);
+	if (Role < ROLE_Authority)
+	{
+		Server_StopRepair();
+	}
+	else
+	{
+		StopRepair();
+	}
+}
+
+void AHelicopter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AHelicopter, bIsRepairing);
+	DOREPLIFETIME(AHelicopter, RepairServerTime);
+	DOREPLIFETIME(AHelicopter, PoolSpawnInfo);
+}
+
+
+/***************************************************************************************
+*                                       Pawn Pool                                      *
+****************************************************************************************/
+void AHelicopter::SetPoolTeamNumber(int32 NewPoolTeamNumber)
+{
+	PoolTeamNumber = NewPoolTeamNumber;
+	PoolSpawnInfo.bPooled = PoolTeamNumber != INDEX_NONE;
+}
+
+void AHelicopter::ParkInPool(const FVector& ParkingLocation)
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_InitHelicopter);
+
+	PoolSpawnInfo.bParked = true;
+
+	DisableHelicopter();
+	SetActorLocation(ParkingLocation, false, nullptr, ETeleportType::TeleportPhysics);
+
+	if (CurrentWeapon)
+	{
+		CurrentWeapon->SetActorHiddenInGame(true);
+	}
+
+	// clients keep the actor and its channel state, nothing is sent until it is respawned
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void AHelicopter::RespawnFromPool(const FTransform& SpawnTransform)
+{
+	SetNetDormancy(DORM_Awake);
+
+	PoolSpawnInfo.bParked = false;
+	PoolSpawnInfo.SpawnCount++;
+	PoolSpawnInfo.Location = SpawnTransform.GetLocation();
+	PoolSpawnInfo.Rotation = SpawnTransform.Rotator();
+
+	Health = MaxHealth;
+
+	if (CurrentWeapon)
+	{
+		CurrentWeapon->ResetAmmo();
+		CurrentWeapon->SetActorHiddenInGame(false);
+	}
+
+	ResetForRespawn();
+}
+
+void AHelicopter::OnRep_PoolSpawnInfo(const FHeliPoolSpawnInfo& PreviousPoolSpawnInfo)
+{
+	// BeginPlay takes care of the state the pawn was received with
+	if (!HasActorBegunPlay())
+	{
+		return;
+	}
+
+	if (PoolSpawnInfo.bParked)
+	{
+		DisableHelicopter();
+	}
+	else if (PoolSpawnInfo.SpawnCount != PreviousPoolSpawnInfo.SpawnCount)
+	{
+		ResetForRespawn();
+	}
+}
+
+void AHelicopter::ResetForRespawn()
+{
+	bIsDying = false;
+	Throttle = BaseThrottle;
+
+	// nothing of the crash of the previous life carries over
+	GetWorldTimerManager().ClearTimer(TimerHandle_CrashImpactWindow);
+	GetWorldTimerManager().ClearTimer(TimerHandle_RestoreControls);
+	CrashWindowDamage = 0.f;
+
+	// movement is not replicated while inactive, every machine teleports on its own
+	SetActorLocationAndRotation(PoolSpawnInfo.Location, PoolSpawnInfo.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+
+	// InitHelicopter enables the proxy mesh again if this is still a remote helicopter
+	DisableProxyMesh();
+	MainStaticMeshComponent->SetVisibility(true);
+	SetRotorsVisibility(true);
+
+	if (PilotMoveComp)
+	{
+		PilotMoveComp->ResetMovementState();
+	}
+
+	RestoreHealthWidget();
+
+	// same delay a freshly spawned helicopter waits in BeginPlay
+	GetWorldTimerManager().SetTimer(TimerHandle_InitHelicopter, this, &AHelicopter::InitHelicopter, SpawnDelay, false);
 }
 
 
@@ -635,10 +971,16 @@ void AHelicopter::InitHelicopter()
 	{
 		MainStaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 		
-		if (IsLocallyControlled())
+		// server is authoritative over every helicopter, the owning client simulates to predict its own movement.
+		// remote helicopters stay kinematic and follow the replicated state, see UHeliMoveComp::UpdateProxyPhysicsMode
+		if (IsLocallyControlled() || HasAuthority())
 		{
 			MainStaticMeshComponent->SetSimulatePhysics(true);	
 		}
+		else
+		{
+			EnableProxyMesh();
+		}
 	}
 	
 	// enable movements
@@ -647,9 +989,12 @@ void AHelicopter::InitHelicopter()
 		HeliMovementComponent->SetActive(true);		
 	}
 
-	// set timer for rotors animation
-	if (!RotorAnimTimerHandle.IsValid())
-		GetWorld()->GetTimerManager().SetTimer(RotorAnimTimerHandle, this, &AHelicopter::ApplyRotationOnRotors, MaxTimeRotorAnimation, true);
+	// set timer for rotors animation, at the rate the significance allows
+	if (!bRotorsSpinning)
+	{
+		bRotorsSpinning = true;
+		UpdateRotorAnimation();
+	}
 
 	// start sound
 	if ((MainAudioComponent == nullptr) || (MainAudioComponent && !MainAudioComponent->IsPlaying()))
@@ -684,19 +1029,10 @@ void AHelicopter::InitHelicopter()
 	SetupPlayerInfoWidget();
 }
 
-void AHelicopter::OnDeath(float KillingDamage, FDamageEvent const &DamageEvent, APawn *PawnInstigator, AActor *DamageCauser)
+void AHelicopter::DisableHelicopter()
 {
-	if (bIsDying)
-	{
-		return;
-	}
-
-	bIsDying = true;
-	Health = 0.0f;
-	//client will take authoritative control
-	bTearOff = true;
-
 	// turn off rotors anim
+	bRotorsSpinning = false;
 	GetWorldTimerManager().ClearTimer(RotorAnimTimerHandle);
 	// turn sound off
 	if (MainAudioComponent)
@@ -705,8 +1041,11 @@ void AHelicopter::OnDeath(float KillingDamage, FDamageEvent const &DamageEvent,
 	}
 	// hide meshes on game
 	MainStaticMeshComponent->SetVisibility(false);
-	MainRotorMeshComponent->SetVisibility(false);
-	TailRotorMeshComponent->SetVisibility(false);
+	SetRotorsVisibility(false);
+	if (ProxyMeshComponent)
+	{
+		ProxyMeshComponent->SetVisibility(false);
+	}
 	// disable movement component
 	if (HeliMovementComponent)
 	{
@@ -716,12 +1055,51 @@ void AHelicopter::OnDeath(float KillingDamage, FDamageEvent const &DamageEvent,
 	MainStaticMeshComponent->SetSimulatePhysics(false);
 	MainStaticMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
-	RemoveWeapons();
 	RemoveHealthWidget();
+}
+
+void AHelicopter::OnDeath(float KillingDamage, FDamageEvent const &DamageEvent, APawn *PawnInstigator, AActor *DamageCauser)
+{
+	if (bIsDying)
+	{
+		return;
+	}
+
+	bIsDying = true;
+	Health = 0.0f;
+	// wrecks are not repaired
+	bIsRepairing = false;
+	GetWorldTimerManager().ClearTimer(TimerHandle_RestoreHealth);
+	GetWorldTimerManager().ClearTimer(TimerHandle_InitHelicopter);
+
+	DisableHelicopter();
+
+	if (IsPooled())
+	{
+		// tearing off can't be undone, the pool keeps the pawn and its weapon for the next life
+		if (HasAuthority() && CurrentWeapon)
+		{
+			CurrentWeapon->StopFire();
+			CurrentWeapon->SetActorHiddenInGame(true);
+		}
+	}
+	else
+	{
+		//client will take authoritative control
+		bTearOff = true;
+
+		RemoveWeapons();
+	}
 
 	// detaching from controller will make game mode to call RestartPlayer
 	DetachFromControllerPendingDestroy();
 
+	AHeliPawnPool* PawnPool = (IsPooled() && HasAuthority()) ? AHeliPawnPool::Get(this) : nullptr;
+	if (PawnPool)
+	{
+		PawnPool->ReleasePawn(this);
+	}
+
 	// play sound and FX for death
 	PlayHit(KillingDamage, DamageEvent, PawnInstigator, DamageCauser, true);
 
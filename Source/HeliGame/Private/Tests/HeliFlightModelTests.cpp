@@ -0,0 +1,275 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliFlightModel.h"
+#include "HeliFlightVerification.h"
+#include "HeliGame.h"
+
+#include "Misc/AutomationTest.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/* forces are around Mass * |GravityZ|, a fixed tolerance would be either too loose or too tight */
+	bool IsNearlyEqualForce(const FVector& A, const FVector& B)
+	{
+		return FVector::Dist(A, B) <= 1.e-4f * FMath::Max3(A.Size(), B.Size(), 1.f);
+	}
+
+	/* somewhere in the flight envelope: tilted, moving, spinning and in the wind */
+	FHeliFlightBodyState MakeRandomBodyState(FRandomStream& RandomStream)
+	{
+		FHeliFlightBodyState State;
+		State.Location = RandomStream.GetUnitVector() * 10000.f;
+		State.Rotation = FRotator(RandomStream.FRandRange(-60.f, 60.f), RandomStream.FRandRange(-180.f, 180.f), RandomStream.FRandRange(-60.f, 60.f)).Quaternion();
+		State.LinearVelocity = RandomStream.GetUnitVector() * RandomStream.FRandRange(0.f, 3000.f);
+		State.AngularVelocity = RandomStream.GetUnitVector() * RandomStream.FRandRange(0.f, 150.f);
+		State.Mass = RandomStream.FRandRange(500.f, 5000.f);
+		State.Wind.Velocity = RandomStream.GetUnitVector() * RandomStream.FRandRange(0.f, 1000.f);
+		State.Wind.Turbulence = RandomStream.GetUnitVector() * RandomStream.FRandRange(0.f, 200.f);
+		State.Wind.GroundProximity = RandomStream.FRand();
+
+		return State;
+	}
+
+	FHeliFlightInput MakeRandomInput(FRandomStream& RandomStream)
+	{
+		FHeliFlightInput Input;
+		Input.Pitch = RandomStream.FRandRange(-1.f, 1.f);
+		Input.Yaw = RandomStream.FRandRange(-1.f, 1.f);
+		Input.Roll = RandomStream.FRandRange(-1.f, 1.f);
+		Input.Thrust = RandomStream.FRandRange(-1.f, 1.f);
+		Input.bAutoRollStabilization = RandomStream.FRand() < 0.5f;
+
+		return Input;
+	}
+
+	/* the terms one at a time, an independent way of adding up what ComputeForces and the batch compute */
+	FHeliFlightForces ComputeForcesFromTerms(const FHeliFlightBodyState& State, const FHeliFlightInput& Input, const FHeliFlightParams& Params)
+	{
+		FHeliFlightForces Forces;
+		Forces.Force = Params.bAddLift ? FHeliFlightModel::ComputeLift(State.Rotation, State.Mass, Params) : FVector::ZeroVector;
+		Forces.Acceleration = FHeliFlightModel::ComputeWindAcceleration(State.Wind, Params);
+
+		const FVector Thrust = FHeliFlightModel::ComputeThrust(State.Rotation, Input.Thrust, Params);
+		(Params.bAccelChange ? Forces.Acceleration : Forces.Force) += Thrust;
+
+		Forces.Torque = FHeliFlightModel::ComputeTorque(State.Rotation, State.AngularVelocity, Input, Params);
+		if (Input.bAutoRollStabilization)
+		{
+			Forces.Torque += FHeliFlightModel::ComputeAutoRollTorque(State.Rotation, State.AngularVelocity, Params);
+		}
+
+		return Forces;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHeliFlightModelHoverLiftTest, "HeliGame.FlightModel.HoverLift", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool FHeliFlightModelHoverLiftTest::RunTest(const FString& Parameters)
+{
+	FHeliFlightParams Params;
+
+	for (const float Mass : { 500.f, 1000.f, 4000.f })
+	{
+		// level, the lift alone holds GravityWeight of the weight up
+		const FVector Lift = FHeliFlightModel::ComputeLift(FQuat::Identity, Mass, Params);
+		const float ExpectedLift = Params.GravityWeight * FMath::Abs(Params.GravityZ) * Mass;
+
+		TestTrue(FString::Printf(TEXT("level lift of %.0f kg is straight up"), Mass), FMath::IsNearlyZero(Lift.X) && FMath::IsNearlyZero(Lift.Y));
+		TestTrue(FString::Printf(TEXT("level lift of %.0f kg balances %.0f%% of its weight"), Mass, Params.GravityWeight * 100.f), FMath::IsNearlyEqual(Lift.Z, ExpectedLift, ExpectedLift * 1.e-5f));
+	}
+
+	// with the whole weight lifted a level body at rest stays where it is
+	Params.GravityWeight = 1.f;
+
+	FHeliFlightBodyState State;
+	for (int32 Step = 0; Step < 120; ++Step)
+	{
+		FHeliFlightModel::Step(State, FHeliFlightInput(), Params, 1.f / 120.f);
+	}
+
+	TestTrue(TEXT("a level body hovers for a second"), State.Location.IsNearlyZero(1.f) && State.LinearVelocity.IsNearlyZero(1.f));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHeliFlightModelBatchTest, "HeliGame.FlightModel.BatchMatchesComputeForces", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool FHeliFlightModelBatchTest::RunTest(const FString& Parameters)
+{
+	const int32 NumHelicopters = 256;
+
+	FRandomStream RandomStream(12);
+
+	TArray<FHeliFlightBodyState> States;
+	TArray<FHeliFlightInput> Inputs;
+	for (int32 Index = 0; Index < NumHelicopters; ++Index)
+	{
+		States.Add(MakeRandomBodyState(RandomStream));
+		Inputs.Add(MakeRandomInput(RandomStream));
+	}
+
+	// every combination of the switches of the shared params
+	for (int32 Combination = 0; Combination < 8; ++Combination)
+	{
+		FHeliFlightBatch Batch;
+		Batch.Params.bAccelChange = (Combination & 1) != 0;
+		Batch.Params.bAddLift = (Combination & 2) == 0;
+		Batch.Params.WindResponse = (Combination & 4) != 0 ? 0.5f : 0.f;
+		Batch.Params.RotorWashTurbulenceScale = 2.f;
+
+		Batch.SetNum(NumHelicopters);
+		for (int32 Index = 0; Index < NumHelicopters; ++Index)
+		{
+			Batch.SetBody(Index, States[Index].Rotation, States[Index].AngularVelocity, States[Index].Mass, Inputs[Index], States[Index].Wind);
+		}
+
+		FHeliFlightModel::ComputeForcesBatch(Batch);
+
+		int32 NumMismatches = 0;
+		int32 NumDifferentBits = 0;
+		for (int32 Index = 0; Index < NumHelicopters; ++Index)
+		{
+			FHeliFlightForces BatchForces;
+			Batch.GetForces(Index, BatchForces);
+
+			// the per body path predicting clients use has to agree exactly, whatever the compiler did with the batch
+			FHeliFlightForces Forces;
+			FHeliFlightModel::ComputeForces(States[Index], Inputs[Index], Batch.Params, Forces);
+			if (Forces.Force != BatchForces.Force || Forces.Acceleration != BatchForces.Acceleration || Forces.Torque != BatchForces.Torque)
+			{
+				NumDifferentBits++;
+			}
+
+			const FHeliFlightForces TermForces = ComputeForcesFromTerms(States[Index], Inputs[Index], Batch.Params);
+			if (!IsNearlyEqualForce(TermForces.Force, BatchForces.Force) ||
+				!IsNearlyEqualForce(TermForces.Acceleration, BatchForces.Acceleration) ||
+				!IsNearlyEqualForce(TermForces.Torque, BatchForces.Torque))
+			{
+				// the first few tell enough
+				if (NumMismatches++ < 4)
+				{
+					AddError(FString::Printf(TEXT("switches %d, helicopter %d: terms %s %s %s, batch %s %s %s"), Combination, Index,
+						*TermForces.Force.ToString(), *TermForces.Acceleration.ToString(), *TermForces.Torque.ToString(),
+						*BatchForces.Force.ToString(), *BatchForces.Acceleration.ToString(), *BatchForces.Torque.ToString()));
+				}
+			}
+		}
+
+		TestEqual(FString::Printf(TEXT("switches %d, helicopters the batch computes differently than the terms"), Combination), NumMismatches, 0);
+		TestEqual(FString::Printf(TEXT("switches %d, helicopters the batch and ComputeForces disagree on"), Combination), NumDifferentBits, 0);
+
+		// a zero mass is a free slot of the batch
+		Batch.Masses[0] = 0.f;
+		FHeliFlightModel::ComputeForcesBatch(Batch);
+
+		FHeliFlightForces FreeSlotForces;
+		Batch.GetForces(0, FreeSlotForces);
+		TestTrue(TEXT("a free slot gets no forces"), FreeSlotForces.Force.IsZero() && FreeSlotForces.Acceleration.IsZero() && FreeSlotForces.Torque.IsZero());
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHeliFlightModelTorqueClampTest, "HeliGame.FlightModel.TorqueClamp", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool FHeliFlightModelTorqueClampTest::RunTest(const FString& Parameters)
+{
+	const FHeliFlightParams Params;
+
+	FRandomStream RandomStream(7);
+
+	FHeliFlightInput Input;
+	Input.Pitch = Input.Yaw = Input.Roll = 1.f;
+
+	for (int32 Index = 0; Index < 64; ++Index)
+	{
+		const FQuat Rotation = FRotator(RandomStream.FRandRange(-80.f, 80.f), RandomStream.FRandRange(-180.f, 180.f), RandomStream.FRandRange(-180.f, 180.f)).Quaternion();
+		const FVector SpinAxis = RandomStream.GetUnitVector();
+
+		// pilot torque is dropped as soon as the body spins faster than allowed, whichever way it spins
+		const FVector TooFast = SpinAxis * (Params.MaximumAngularVelocity * 1.01f);
+		if (!FHeliFlightModel::ComputeTorque(Rotation, TooFast, Input, Params).IsZero())
+		{
+			AddError(FString::Printf(TEXT("pilot torque at %.1f deg/s around %s"), TooFast.Size(), *SpinAxis.ToString()));
+		}
+
+		const FVector SlowEnough = SpinAxis * (Params.MaximumAngularVelocity * 0.99f);
+		if (FHeliFlightModel::ComputeTorque(Rotation, SlowEnough, Input, Params).IsZero())
+		{
+			AddError(FString::Printf(TEXT("no pilot torque at %.1f deg/s around %s"), SlowEnough.Size(), *SpinAxis.ToString()));
+		}
+
+		// auto roll never pushes harder than MaxAutoRollTorque, however far off level and however fast it rolls
+		const FVector AnySpin = SpinAxis * RandomStream.FRandRange(0.f, 1000.f);
+		const float AutoRollTorque = FHeliFlightModel::ComputeAutoRollTorque(Rotation, AnySpin, Params).Size();
+		if (AutoRollTorque > Params.MaxAutoRollTorque * (1.f + KINDA_SMALL_NUMBER))
+		{
+			AddError(FString::Printf(TEXT("auto roll torque %f over its limit %f"), AutoRollTorque, Params.MaxAutoRollTorque));
+		}
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHeliFlightModelBenchmarkTest, "HeliGame.FlightModel.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FHeliFlightModelBenchmarkTest::RunTest(const FString& Parameters)
+{
+	// no world involved, timings end up in the log
+	const FHeliFlightBenchmarkResult Result = FHeliFlightModel::RunBenchmark(1000, 600, 1.f / 120.f);
+
+	TestFalse(TEXT("benchmark flight blew up"), Result.Checksum.ContainsNaN());
+	TestTrue(TEXT("benchmark measured something"), Result.StepTime > 0.0 && Result.ForcesTime > 0.0 && Result.BatchedForcesTime > 0.0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHeliFlightVerificationTest, "HeliGame.FlightModel.Verification", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::SmokeFilter)
+
+bool FHeliFlightVerificationTest::RunTest(const FString& Parameters)
+{
+	// integrated and substepped, per body and batched, the way a predicting client and the server fly
+	for (const int32 NumSubsteps : { 1, 2, 4 })
+	{
+		TestTrue(FString::Printf(TEXT("per body and batched flight are identical over %d substeps"), NumSubsteps), FHeliFlightVerification::Run(600, NumSubsteps, FString(), NumSubsteps));
+	}
+
+	// a recording read back flies exactly as it was saved, through the wind field it was saved with
+	FHeliFlightRecording Recording;
+	Recording.Params.WindResponse = 0.5f;
+	FHeliFlightVerification::GenerateWindGrid(5, Recording.InitialState.Location, Recording);
+	FHeliFlightVerification::GenerateInputs(5, 600, Recording.Inputs);
+
+	const UHeliWindField* WindField = FHeliFlightVerification::CreateWindField(Recording);
+	TestNotNull(TEXT("wind field stored"), WindField);
+	FHeliFlightVerification::Simulate(Recording, WindField, false, 2, Recording.States);
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Writer << Recording;
+
+	FHeliFlightRecording Replay;
+	FMemoryReader Reader(Data);
+	Reader << Replay;
+
+	TestFalse(TEXT("recording reads back"), Reader.IsError());
+
+	TArray<FMovementState> ReplayStates;
+	FHeliFlightVerification::Simulate(Replay, FHeliFlightVerification::CreateWindField(Replay), true, 2, ReplayStates);
+
+	const FHeliFlightDivergence Divergence = FHeliFlightVerification::Compare(Recording.States, ReplayStates);
+	TestTrue(FString::Printf(TEXT("replayed recording identical, first divergence at frame %d (%s)"), Divergence.Frame, Divergence.Field), Divergence.IsDeterministic());
+
+	// the sampled wind is actually flown, without the field it is another flight
+	TArray<FMovementState> CalmStates;
+	FHeliFlightVerification::Simulate(Recording, nullptr, false, 2, CalmStates);
+	TestFalse(TEXT("wind field changes the flight"), FHeliFlightVerification::Compare(Recording.States, CalmStates).IsDeterministic());
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
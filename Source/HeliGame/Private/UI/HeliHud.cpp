@@ -5,6 +5,7 @@
 #include "HeliPlayerController.h"
 #include "Helicopter.h"
 #include "HeliGameState.h"
+#include "HeliSignificanceManager.h"
 #include "Blueprint/UserWidget.h"
 #include "UObject/ConstructorHelpers.h"
 #include "GameFramework/GameMode.h"
@@ -67,6 +68,9 @@ AHeliHud::AHeliHud()
 
 	BigFont = BigFontOb.Object;
 	NormalFont = NormalFontOb.Object;
+
+	SignificanceManagerClass = AHeliSignificanceManager::StaticClass();
+	SignificanceManager = nullptr;
 }
 
 void AHeliHud::BeginPlay()
@@ -79,8 +83,26 @@ void AHeliHud::BeginPlay()
 		// enables input from player
 		this->EnableInput(MyPC);
 	}
-	
 
+	// only the local player has a HUD, vehicles are scored from its point of view
+	if (SignificanceManagerClass)
+	{
+		FActorSpawnParameters SpawnInfo;
+		SpawnInfo.Owner = this;
+		SpawnInfo.ObjectFlags |= RF_Transient;
+		SignificanceManager = GetWorld()->SpawnActor<AHeliSignificanceManager>(SignificanceManagerClass, SpawnInfo);
+	}
+}
+
+void AHeliHud::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (SignificanceManager)
+	{
+		SignificanceManager->Destroy();
+		SignificanceManager = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AHeliHud::EnableFirstPersonHud()
@@ -455,7 +477,7 @@ void AHeliHud::DrawWarmupMatchTimers()
 		if (MyGameState->GetMatchState() == MatchState::WaitingToStart)
 		{
 			TextItem.Scale = FVector2D(ScaleUI, ScaleUI);
-			Text = LOCTEXT("WarmupString", "MATCH STARTS IN: ").ToString() + FString::FromInt(MyGameState->RemainingTime);
+			Text = LOCTEXT("WarmupString", "MATCH STARTS IN: ").ToString() + FString::FromInt(FMath::CeilToInt(MyGameState->GetSyncedRemainingTime()));
 			TextItem.SetColor(HUDLight);
 			TextItem.Text = FText::FromString(Text);
 
@@ -2,8 +2,12 @@
 
 #include "HeliProjectile.h"
 #include "HeliGame.h"
+#include "HeliProjectilePool.h"
 #include "ImpactEffect.h"
 #include "HeliDamageType.h"
+#include "HeliNetRelevancyManager.h"
+#include "HeliLagCompensation.h"
+#include "HeliFighterVehicle.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Components/SphereComponent.h"
 #include "Particles/ParticleSystemComponent.h"
@@ -12,6 +16,7 @@
 #include "CollisionQueryParams.h"
 #include "Public/DrawDebugHelpers.h"
 #include "Net/UnrealNetwork.h"
+#include "Public/TimerManager.h"
 #include "Engine/World.h"
 
 
@@ -48,6 +53,7 @@ AHeliProjectile::AHeliProjectile()
 	bReplicates = true;
 	bReplicateMovement = true;
 
+	bPooled = false;
 }
 
 void AHeliProjectile::PostInitializeComponents()
@@ -56,6 +62,13 @@ void AHeliProjectile::PostInitializeComponents()
 	MovementComp->OnProjectileStop.AddDynamic(this, &AHeliProjectile::OnImpact);
 	CollisionComp->MoveIgnoreActors.Add(Instigator);
 
+	// the sweep would hit helicopters where they are now on the server, Tick traces them where the shooter saw them
+	if (IsLagCompensated())
+	{
+		CollisionComp->SetCollisionResponseToChannel(COLLISION_HELICOPTER, ECR_Ignore);
+	}
+	LastLagCompensatedLocation = GetActorLocation();
+
 	AProjectileWeapon* OwnerWeapon = Cast<AProjectileWeapon>(GetOwner());
 	if (OwnerWeapon)
 	{
@@ -67,6 +80,25 @@ void AHeliProjectile::PostInitializeComponents()
 }
 
 
+bool AHeliProjectile::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	// shooter always sees its own projectiles
+	if (bAlwaysRelevant || IsOwnedBy(ViewTarget) || IsOwnedBy(RealViewer) || this == ViewTarget || ViewTarget == Instigator)
+	{
+		return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+	}
+
+	// the manager remembers itself on every actor it has seen, the game mode lookup is only for new ones
+	AHeliNetRelevancyManager* NetRelevancyManager = NetRelevancy.Manager.IsValid() ? NetRelevancy.Manager.Get() : AHeliNetRelevancyManager::Get(this);
+	if (NetRelevancyManager)
+	{
+		AHeliFighterVehicle* Shooter = Cast<AHeliFighterVehicle>(Instigator);
+		return NetRelevancyManager->IsNetRelevantFor(this, NetRelevancy, Shooter ? Shooter->GetTeamNumber() : -1, EHeliNetRelevancyNode::Projectile, RealViewer, SrcLocation);
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
 void AHeliProjectile::InitVelocity(FVector& ShootDirection, FVector& InitialVelocity)
 {
 	if (MovementComp)
@@ -75,11 +107,54 @@ void AHeliProjectile::InitVelocity(FVector& ShootDirection, FVector& InitialVelo
 	}
 }
 
+void AHeliProjectile::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (Role < ROLE_Authority || bExploded || IsParkedInPool() || !IsLagCompensated())
+	{
+		return;
+	}
+
+	FHitResult VehicleHit;
+	if (TraceLagCompensatedVehicles(GetActorLocation(), VehicleHit))
+	{
+		SetActorLocation(VehicleHit.Location);
+
+		Explode(VehicleHit);
+
+		DisableAndDestroy();
+	}
+}
+
+bool AHeliProjectile::IsLagCompensated() const
+{
+	return GetNetMode() != NM_Client && GetNetMode() != NM_Standalone;
+}
+
+bool AHeliProjectile::TraceLagCompensatedVehicles(const FVector& End, FHitResult& OutHit)
+{
+	static FName TraceTag = FName(TEXT("HeliProjectileLagCompensation"));
+
+	FCollisionQueryParams TraceParams(TraceTag, true, this);
+	TraceParams.AddIgnoredActor(Instigator);
+	TraceParams.bReturnPhysicalMaterial = true;
+
+	const FVector Start = LastLagCompensatedLocation;
+	LastLagCompensatedLocation = End;
+
+	return FHeliLagCompensation::LineTraceVehicles(GetWorld(), MyController.Get(), Start, End, TraceParams, OutHit);
+}
+
 void AHeliProjectile::OnImpact(const FHitResult& HitResult)
 {
 	if (Role == ROLE_Authority && !bExploded)
 	{	
-		Explode(HitResult);
+		// a helicopter where the shooter saw it may be in front of what the sweep hit this frame
+		FHitResult VehicleHit;
+		const bool bHitVehicle = IsLagCompensated() && TraceLagCompensatedVehicles(HitResult.Location, VehicleHit);
+
+		Explode(bHitVehicle ? VehicleHit : HitResult);
 
 		DisableAndDestroy();
 	}
@@ -163,7 +238,133 @@ void AHeliProjectile::DisableAndDestroy()
 	MovementComp->StopMovementImmediately();
 
 	// give clients some time to show explosion
-	SetLifeSpan(2.0f);
+	if (bPooled)
+	{
+		GetWorldTimerManager().SetTimer(TimerHandle_ReturnToPool, this, &AHeliProjectile::ReturnToPool, 2.0f, false);
+	}
+	else
+	{
+		SetLifeSpan(2.0f);
+	}
+}
+
+void AHeliProjectile::ParkInPool(const FVector& Location)
+{
+	bPooled = true;
+
+	// a parked projectile lives as long as the pool does
+	SetLifeSpan(0.f);
+	GetWorldTimerManager().ClearTimer(TimerHandle_ReturnToPool);
+
+	DisableProjectile();
+	SetActorHiddenInGame(true);
+	SetActorLocation(Location, false, nullptr, ETeleportType::TeleportPhysics);
+
+	// nothing to do until the next launch, a full pool shouldn't cost a tick per projectile
+	SetActorTickEnabled(false);
+
+	Instigator = nullptr;
+	SetOwner(nullptr);
+	MyController.Reset();
+
+	PoolState.bParked = true;
+
+	// who could see it before it was parked says nothing about where it is launched next
+	NetRelevancy = FHeliNetRelevancy();
+
+	// the parked state still goes out once, then the channel sleeps until the next launch
+	SetNetDormancy(DORM_DormantAll);
+}
+
+void AHeliProjectile::LaunchFromPool(AProjectileWeapon* Weapon, const FTransform& LaunchTransform, const FVector& ShootDirection, const FVector& InitialVelocity)
+{
+	Instigator = Weapon ? Weapon->Instigator : nullptr;
+	SetOwner(Weapon);
+
+	if (Weapon)
+	{
+		Weapon->ApplyWeaponConfig(WeaponConfig);
+	}
+	MyController = GetInstigatorController();
+
+	CollisionComp->MoveIgnoreActors.Reset();
+	CollisionComp->MoveIgnoreActors.Add(Instigator);
+
+	SetActorLocationAndRotation(LaunchTransform.GetLocation(), LaunchTransform.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+	SetActorHiddenInGame(false);
+	LastLagCompensatedLocation = LaunchTransform.GetLocation();
+
+	bExploded = false;
+	PoolState.bParked = false;
+	PoolState.LaunchCount++;
+	ResetForLaunch();
+
+	FVector ShootDir = ShootDirection;
+	FVector Velocity = InitialVelocity;
+	InitVelocity(ShootDir, Velocity);
+
+	// what SetLifeSpan does for projectiles that are destroyed
+	GetWorldTimerManager().SetTimer(TimerHandle_ReturnToPool, this, &AHeliProjectile::ReturnToPool, FMath::Max(WeaponConfig.ProjectileLife, 0.01f), false);
+
+	SetNetDormancy(DORM_Awake);
+	ForceNetUpdate();
+}
+
+void AHeliProjectile::ReturnToPool()
+{
+	AHeliProjectilePool* ProjectilePool = AHeliProjectilePool::Get(this);
+	if (ProjectilePool)
+	{
+		ProjectilePool->ReleaseProjectile(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+void AHeliProjectile::DisableProjectile()
+{
+	MovementComp->StopMovementImmediately();
+	MovementComp->Deactivate();
+
+	CollisionComp->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	if (ProjectileFX)
+	{
+		ProjectileFX->SetVisibility(false);
+		ProjectileFX->Deactivate();
+	}
+}
+
+void AHeliProjectile::ResetForLaunch()
+{
+	SetActorTickEnabled(true);
+
+	CollisionComp->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+
+	// a projectile movement that stopped has let go of its updated component
+	MovementComp->SetUpdatedComponent(CollisionComp);
+	MovementComp->Activate(true);
+
+	if (ProjectileFX)
+	{
+		ProjectileFX->SetVisibility(true);
+		ProjectileFX->Activate(true);
+	}
+}
+
+void AHeliProjectile::OnRep_PoolState(const FHeliProjectilePoolState& PreviousPoolState)
+{
+	if (PoolState.bParked)
+	{
+		DisableProjectile();
+		SetActorTickEnabled(false);
+	}
+	else if (PreviousPoolState.bParked || PoolState.LaunchCount != PreviousPoolState.LaunchCount)
+	{
+		ResetForLaunch();
+	}
 }
 
 
@@ -190,15 +391,22 @@ void AHeliProjectile::DealDamage(const FHitResult& Impact)
 	/* Handle special damage location on the helicopter body (types are setup in the Physics Asset of the helicopter */
 	UHeliDamageType* DmgType = Cast<UHeliDamageType>(WeaponConfig.DamageType->GetDefaultObject());	
 
-	// re-trace to get physics material for damage type information only
-	FVector ProjDirection = GetActorForwardVector();
-	const FVector StartTrace = GetActorLocation() - ProjDirection * 100;
-	const FVector EndTrace = GetActorLocation() + ProjDirection * 100;
-	FCollisionQueryParams TraceParams(FName(TEXT("ProjClient")), true, Instigator);
-	TraceParams.bReturnPhysicalMaterial = true;
-	
-	FHitResult HitResult;
-	GetWorld()->LineTraceSingleByChannel(HitResult, StartTrace, EndTrace, COLLISION_PROJECTILE, TraceParams);
+	// lag compensated hits already know the hit zone, the others re-trace at the impact to get physics material for damage type information only
+	FHitResult HitResult = Impact;
+	if (!HitResult.PhysMaterial.IsValid())
+	{
+		FVector ProjDirection = GetActorForwardVector();
+		const FVector StartTrace = Impact.ImpactPoint - ProjDirection * 100;
+		const FVector EndTrace = Impact.ImpactPoint + ProjDirection * 100;
+		FCollisionQueryParams TraceParams(FName(TEXT("ProjClient")), true, Instigator);
+		TraceParams.bReturnPhysicalMaterial = true;
+
+		FHitResult MaterialHit;
+		if (GetWorld()->LineTraceSingleByChannel(MaterialHit, StartTrace, EndTrace, COLLISION_PROJECTILE, TraceParams))
+		{
+			HitResult = MaterialHit;
+		}
+	}
 
 	UPhysicalMaterial* PhysMat = HitResult.PhysMaterial.Get();
 	if (PhysMat && DmgType)
@@ -247,6 +455,12 @@ FHitResult AHeliProjectile::Trace(const FVector& StartTrace, const FVector& EndT
 ///CODE_SNIPPET_START: AActor::GetActorLocation AActor::GetActorRotation
 void AHeliProjectile::OnRep_Exploded()
 {
+	// pooled projectiles are relaunched unexploded
+	if (!bExploded)
+	{
+		return;
+	}
+
 	FVector ProjDirection = GetActorForwardVector();
 
 	const FVector StartTrace = GetActorLocation() - ProjDirection * 200;
@@ -280,5 +494,6 @@ void AHeliProjectile::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & O
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
 	DOREPLIFETIME(AHeliProjectile, bExploded);
+	DOREPLIFETIME(AHeliProjectile, PoolState);
 }
 
@@ -0,0 +1,166 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#include "HeliProjectilePool.h"
+#include "HeliGame.h"
+#include "HeliGameMode.h"
+#include "HeliProjectile.h"
+
+#include "Engine/World.h"
+
+AHeliProjectilePool::AHeliProjectilePool(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = false;
+
+	ParkingLocation = FVector(0.f, 0.f, -60000.f);
+
+	NumReusedProjectiles = 0;
+	NumSpawnedProjectiles = 0;
+}
+
+AHeliProjectilePool* AHeliProjectilePool::Get(const UObject* WorldContextObject)
+{
+	UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	AHeliGameMode* GameMode = World ? World->GetAuthGameMode<AHeliGameMode>() : nullptr;
+
+	return GameMode ? GameMode->GetProjectilePool() : nullptr;
+}
+
+void AHeliProjectilePool::Reserve(UClass* ProjectileClass, int32 Count)
+{
+	if (!ProjectileClass || !ProjectileClass->IsChildOf(AHeliProjectile::StaticClass()) || Count <= 0)
+	{
+		return;
+	}
+
+	FHeliProjectilePoolEntry& Entry = Entries.FindOrAdd(ProjectileClass);
+	Entry.NumReserved += Count;
+
+	while (Entry.NumAlive < Entry.NumReserved)
+	{
+		AHeliProjectile* Projectile = SpawnParkedProjectile(ProjectileClass);
+		if (!Projectile)
+		{
+			break;
+		}
+
+		Entry.Projectiles.Add(Projectile);
+		Entry.NumAlive++;
+	}
+}
+
+void AHeliProjectilePool::Unreserve(UClass* ProjectileClass, int32 Count)
+{
+	FHeliProjectilePoolEntry* Entry = Entries.Find(ProjectileClass);
+	if (!Entry)
+	{
+		return;
+	}
+
+	Entry->NumReserved = FMath::Max(Entry->NumReserved - Count, 0);
+
+	// spare parked ones go right away, the ones in flight when they come back
+	while (Entry->NumAlive > Entry->NumReserved && Entry->Projectiles.Num() > 0)
+	{
+		AHeliProjectile* Projectile = Entry->Projectiles.Pop(false);
+		if (Projectile && !Projectile->IsPendingKill())
+		{
+			Projectile->Destroy();
+		}
+		Entry->NumAlive--;
+	}
+}
+
+AHeliProjectile* AHeliProjectilePool::SpawnParkedProjectile(UClass* ProjectileClass)
+{
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AHeliProjectile* Projectile = GetWorld()->SpawnActor<AHeliProjectile>(ProjectileClass, ParkingLocation, FRotator::ZeroRotator, SpawnInfo);
+	if (Projectile)
+	{
+		Projectile->ParkInPool(ParkingLocation);
+	}
+
+	return Projectile;
+}
+
+AHeliProjectile* AHeliProjectilePool::AcquireProjectile(UClass* ProjectileClass)
+{
+	if (!ProjectileClass || !ProjectileClass->IsChildOf(AHeliProjectile::StaticClass()))
+	{
+		return nullptr;
+	}
+
+	FHeliProjectilePoolEntry& Entry = Entries.FindOrAdd(ProjectileClass);
+
+	while (Entry.Projectiles.Num() > 0)
+	{
+		AHeliProjectile* Projectile = Entry.Projectiles.Pop(false);
+		if (Projectile && !Projectile->IsPendingKill())
+		{
+			NumReusedProjectiles++;
+			return Projectile;
+		}
+
+		// destroyed behind our back, a map change or a kill volume
+		Entry.NumAlive--;
+	}
+
+	// more in flight than reserved, it stays in the pool until the reservations say otherwise
+	AHeliProjectile* Projectile = SpawnParkedProjectile(ProjectileClass);
+	if (Projectile)
+	{
+		Entry.NumAlive++;
+		NumSpawnedProjectiles++;
+	}
+
+	return Projectile;
+}
+
+void AHeliProjectilePool::ReleaseProjectile(AHeliProjectile* Projectile)
+{
+	if (!Projectile || Projectile->IsPendingKill())
+	{
+		return;
+	}
+
+	FHeliProjectilePoolEntry* Entry = Entries.Find(Projectile->GetClass());
+	if (!Entry)
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	if (Entry->NumAlive > Entry->NumReserved)
+	{
+		Entry->NumAlive--;
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->ParkInPool(ParkingLocation);
+	Entry->Projectiles.AddUnique(Projectile);
+}
+
+int32 AHeliProjectilePool::GetNumParkedProjectiles() const
+{
+	int32 NumParkedProjectiles = 0;
+	for (const TPair<UClass*, FHeliProjectilePoolEntry>& Pair : Entries)
+	{
+		NumParkedProjectiles += Pair.Value.Projectiles.Num();
+	}
+
+	return NumParkedProjectiles;
+}
+
+void AHeliProjectilePool::DumpStats() const
+{
+	UE_LOG(LogHeliWeapon, Log, TEXT("ProjectilePool: %d parked, %d shots reused a projectile, %d had to spawn one"), GetNumParkedProjectiles(), NumReusedProjectiles, NumSpawnedProjectiles);
+
+	for (const TPair<UClass*, FHeliProjectilePoolEntry>& Pair : Entries)
+	{
+		UE_LOG(LogHeliWeapon, Log, TEXT("    %s: %d parked, %d alive, %d reserved"), *GetNameSafe(Pair.Key), Pair.Value.Projectiles.Num(), Pair.Value.NumAlive, Pair.Value.NumReserved);
+	}
+}
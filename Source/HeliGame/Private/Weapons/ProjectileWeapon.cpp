@@ -3,6 +3,7 @@
 #include "ProjectileWeapon.h"
 #include "HeliGame.h"
 #include "HeliProjectile.h"
+#include "HeliProjectilePool.h"
 #include "Helicopter.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "Kismet/KismetSystemLibrary.h"
@@ -17,6 +18,53 @@ AProjectileWeapon::AProjectileWeapon(const FObjectInitializer& ObjectInitializer
 	TrailTargetParam = TEXT("ShockBeamEnd");
 
 	Shotcounter = 0;
+
+	PooledProjectiles = 0;
+	NumReservedProjectiles = 0;
+}
+
+void AProjectileWeapon::BeginPlay()
+{
+	Super::BeginPlay();
+
+	AHeliProjectilePool* ProjectilePool = AHeliProjectilePool::Get(this);
+	if (ProjectilePool && Role == ROLE_Authority)
+	{
+		NumReservedProjectiles = GetNumProjectilesToReserve();
+		ProjectilePool->Reserve(ProjectileConfig.ProjectileClass, NumReservedProjectiles);
+	}
+}
+
+void AProjectileWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (NumReservedProjectiles > 0)
+	{
+		AHeliProjectilePool* ProjectilePool = AHeliProjectilePool::Get(this);
+		if (ProjectilePool)
+		{
+			ProjectilePool->Unreserve(ProjectileConfig.ProjectileClass, NumReservedProjectiles);
+		}
+		NumReservedProjectiles = 0;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 AProjectileWeapon::GetNumProjectilesToReserve() const
+{
+	if (PooledProjectiles > 0)
+	{
+		return PooledProjectiles;
+	}
+
+	// a projectile is in flight for its whole life when it misses
+	int32 NumInFlight = WeaponConfig.TimeBetweenShots > 0.f ? FMath::CeilToInt(ProjectileConfig.ProjectileLife / WeaponConfig.TimeBetweenShots) : 1;
+	if (WeaponConfig.AmmoPerClip > 0)
+	{
+		NumInFlight = FMath::Min(NumInFlight, WeaponConfig.AmmoPerClip);
+	}
+
+	return FMath::Max(NumInFlight, 1);
 }
 
 void AProjectileWeapon::FireWeapon()
@@ -74,6 +122,18 @@ bool AProjectileWeapon::ServerFireProjectile_Validate(FVector Origin, FVector_Ne
 void AProjectileWeapon::ServerFireProjectile_Implementation(FVector Origin, FVector_NetQuantizeNormal ShootDir)
 {
 	FTransform SpawnTM(ShootDir.Rotation(), Origin);
+
+	// a parked projectile costs no spawn nor new actor channel
+	AHeliProjectilePool* ProjectilePool = AHeliProjectilePool::Get(this);
+	AHeliProjectile* PooledProjectile = ProjectilePool ? ProjectilePool->AcquireProjectile(ProjectileConfig.ProjectileClass) : nullptr;
+	if (PooledProjectile)
+	{
+		PooledProjectile->LaunchFromPool(this, SpawnTM, ShootDir, GetPawnOwner()->GetVelocity());
+
+		Client_SpawnTrailEffect(Origin, ShootDir);
+		return;
+	}
+
 	AHeliProjectile* Projectile = Cast<AHeliProjectile>(UGameplayStatics::BeginDeferredActorSpawnFromClass(this, ProjectileConfig.ProjectileClass, SpawnTM));
 	if (Projectile)
 	{
@@ -105,7 +165,8 @@ void AProjectileWeapon::SpawnTrailEffect(const FVector& Origin, const FVector& S
 		return;
 	}
 
-	if (TrailFX)
+	// nobody sees the trail of a vehicle that is off screen or too far away
+	if (TrailFX && (!MyPawn || MyPawn->GetSignificance() != EHeliSignificance::Low))
 	{
 		UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, TrailFX, Origin);
 		if (TrailPSC)
@@ -161,7 +161,7 @@ void AWeapon::AttachMeshToPawn()
 	{
 		FName AttachPoint = MyPawn->GetCurrentWeaponAttachPoint();
 
-		bool isAttachOk = Mesh1P->AttachToComponent(MyPawn->GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform, AttachPoint);
+		bool isAttachOk = Mesh1P->AttachToComponent(MyPawn->GetWeaponAttachComponent(), FAttachmentTransformRules::KeepRelativeTransform, AttachPoint);
 		// UE_LOG(LogHeliWeapon, Log, TEXT("AWeapon::AttachMeshToPawn(%s) ---> Weapon was Attached to HeliMesh."), *AttachPoint.ToString());
 
 		bIsEquipped = true;
@@ -271,8 +271,9 @@ UAudioComponent* AWeapon::PlayWeaponSound(USoundCue* Sound)
 // Cosmetics - FX of weapon firing effect, sound and camera shaking
 void AWeapon::SimulateWeaponFire()
 {
-	// muzzle particle FX
-	if (MuzzleFX)
+	// muzzle particle FX, not worth it for vehicles the local player can barely see
+	const bool bIsSignificant = !MyPawn || MyPawn->GetSignificance() != EHeliSignificance::Low;
+	if (MuzzleFX && bIsSignificant)
 	{
 		if (MuzzlePSC == nullptr)
 		{
@@ -572,6 +573,15 @@ void AWeapon::UseAmmo()
 	}
 }
 
+void AWeapon::ResetAmmo()
+{
+	StopFire();
+	StopReload();
+
+	CurrentAmmoInClip = WeaponConfig.AmmoPerClip;
+	CurrentAmmo = WeaponConfig.AmmoPerClip * WeaponConfig.InitialClips;
+}
+
 void AWeapon::HandleFiring()
 {
 	if ((CurrentAmmoInClip > 0 || HasInfiniteClip() || HasInfiniteAmmo()) && CanFire())
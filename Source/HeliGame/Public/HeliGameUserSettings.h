@@ -26,8 +26,9 @@ class HELIGAME_API UHeliGameUserSettings : public UGameUserSettings
 	UPROPERTY(config)
 	int32 PilotAssist = -1;
 
+	/* values below 0.1 turn snapshot interpolation of remote helicopters off */
 	UPROPERTY(config)
-	float NetworkSmoothingFactor = 1000;
+	float NetworkSmoothingFactor = 100;
 
 	UPROPERTY(config)
 	FString PlayerName;
@@ -0,0 +1,70 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "HeliWindVolume.generated.h"
+
+class UBoxComponent;
+class UHeliWindField;
+
+/*
+* Where the wind of a map comes from. The level designer sizes the box over the playable area and bakes
+* the wind field asset from the editor; in game the asset is only read. One per map, the first one found wins.
+*/
+UCLASS()
+class HELIGAME_API AHeliWindVolume : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AHeliWindVolume(const FObjectInitializer& ObjectInitializer);
+
+	/* wind field of the first volume of the world that has one baked, null when the map has no wind */
+	static UHeliWindField* FindWindField(UWorld* World);
+
+	/* [editor] traces the ground under every grid column and writes wind, turbulence and ground proximity to WindField */
+	UFUNCTION(CallInEditor, Category = "Wind")
+	void BakeWindField();
+
+private:
+	/* the grid covers the world aligned bounds of this box */
+	UPROPERTY(VisibleAnywhere, Category = "Wind", meta = (AllowPrivateAccess = "true"))
+	UBoxComponent* Bounds;
+
+	/* asset the bake writes to and helicopters sample from */
+	UPROPERTY(EditAnywhere, Category = "Wind", meta = (AllowPrivateAccess = "true"))
+	UHeliWindField* WindField;
+
+	/* distance between grid points (cm), wind varies smoothly in between */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true", ClampMin = "100.0"))
+	float CellSize;
+
+	/* prevailing wind well above the ground (cm/s) */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true"))
+	FVector WindVelocity;
+
+	/* height above the ground (cm) under which the ground slows the wind down and slopes bend it up or down */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true", ClampMin = "1.0"))
+	float WindShearHeight;
+
+	/* how much of the wind blowing into a slope becomes updraft, and downdraft behind it */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true"))
+	float SlopeUpdraftScale;
+
+	/* strongest gust (cm/s) */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true"))
+	float TurbulenceSpeed;
+
+	/* height above the ground (cm) where rotor wash and ground turbulence start */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true", ClampMin = "1.0"))
+	float GroundTurbulenceHeight;
+
+	/* same seed and same map bake the same turbulence */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true"))
+	int32 TurbulenceSeed;
+
+	/* bakes bigger than this are refused, a grid point is 7 bytes */
+	UPROPERTY(EditAnywhere, Category = "Wind|Bake", meta = (AllowPrivateAccess = "true"))
+	int32 MaxGridPoints;
+};
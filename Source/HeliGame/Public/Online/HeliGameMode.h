@@ -6,6 +6,11 @@
 #include "HeliGameMode.generated.h"
 
 class APlayerStart;
+class AHeliNetRelevancyManager;
+class AHeliMovementReplicator;
+class AHeliFlightManager;
+class AHeliPawnPool;
+class AHeliProjectilePool;
 
 /**
  * 
@@ -45,6 +50,9 @@ public:
 
 	void RestartPlayerAtTransform(AController* NewPlayer, const FTransform& SpawnTransform) override;
 
+	/** takes a parked helicopter from the pawn pool when there is one, spawns a new pawn otherwise */
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation(AController* NewPlayer, const FTransform& SpawnTransform) override;
+
 	/** update remaining time */
 	virtual void DefaultTimer();
 
@@ -122,6 +130,45 @@ public:
 	UPROPERTY(BlueprintReadWrite, Category = "GameRules")
 	int32 MaxNumberOfPlayers;
 
+	/*
+	* Net Relevancy
+	*/
+
+	AHeliNetRelevancyManager* GetNetRelevancyManager() const;
+
+	AHeliMovementReplicator* GetMovementReplicator() const;
+
+	AHeliFlightManager* GetFlightManager() const;
+
+	AHeliPawnPool* GetPawnPool() const;
+
+	AHeliProjectilePool* GetProjectilePool() const;
+
+	/* log how many actors the net relevancy manager culled */
+	UFUNCTION(exec)
+	void NetRelevancyStats();
+
+	/* log how long lag compensation queries take */
+	UFUNCTION(exec)
+	void LagCompensationStats();
+
+	/* time the flight model alone, without physics scene nor components */
+	UFUNCTION(exec)
+	void BenchmarkFlightModel(int32 NumHelicopters = 1000, int32 NumSteps = 600);
+
+	/* fly the same input on the per body and batched flight paths, integrated and over NumSubsteps physics substeps, and report
+	   where they stop being bit for bit identical. With a RecordingName the flight is saved, or compared against when another build already saved it */
+	UFUNCTION(exec)
+	void VerifyFlightModel(int32 NumFrames = 3600, int32 Seed = 0, FString RecordingName = TEXT(""), int32 NumSubsteps = 2);
+
+	/* log how many respawns the pawn pool served */
+	UFUNCTION(exec)
+	void PawnPoolStats();
+
+	/* log how many shots the projectile pool served */
+	UFUNCTION(exec)
+	void ProjectilePoolStats();
+
 	/* check if immediately player restart after the player is dead is allowed */
 	virtual bool IsImmediatelyPlayerRestartAllowedAfterDeath();
 
@@ -186,6 +233,41 @@ public:
 
 	bool bAllowBots;		
 
+	/* [server] relevancy for helicopters, bots and projectiles */
+	UPROPERTY(Transient)
+	AHeliNetRelevancyManager* NetRelevancyManager;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Net Relevancy")
+	TSubclassOf<AHeliNetRelevancyManager> NetRelevancyManagerClass;
+
+	/* [server] replicates the movement of every helicopter, through one connection actor per remote player */
+	UPROPERTY(Transient)
+	AHeliMovementReplicator* MovementReplicator;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Replication")
+	TSubclassOf<AHeliMovementReplicator> MovementReplicatorClass;
+
+	/* [server] flies every helicopter in one batch */
+	UPROPERTY(Transient)
+	AHeliFlightManager* FlightManager;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Flight")
+	TSubclassOf<AHeliFlightManager> FlightManagerClass;
+
+	/* [server] parked helicopters players respawn with */
+	UPROPERTY(Transient)
+	AHeliPawnPool* PawnPool;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning")
+	TSubclassOf<AHeliPawnPool> PawnPoolClass;
+
+	/* [server] parked projectiles weapons fire */
+	UPROPERTY(Transient)
+	AHeliProjectilePool* ProjectilePool;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Spawning")
+	TSubclassOf<AHeliProjectilePool> ProjectilePoolClass;
+
 	/** spawning all bots for this game */
 	void StartBots();
 
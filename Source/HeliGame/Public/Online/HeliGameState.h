@@ -38,6 +38,17 @@ public:
 	UPROPERTY(BlueprintReadWrite, Transient, Replicated, Category = "GameSettings")
 	int32 RemainingTime;
 
+	/** server time when RemainingTime was last set, lets clients count down smoothly between updates */
+	UPROPERTY(Transient, Replicated)
+	float RemainingTimeServerTime;
+
+	/** [server] sets RemainingTime and stamps it with the current time */
+	void SetRemainingTime(int32 NewRemainingTime);
+
+	/** remaining time counted down with the synced server clock of the local player */
+	UFUNCTION(BlueprintCallable, Category = "GameSettings")
+	float GetSyncedRemainingTime() const;
+
 	/** name of the server */
 	UPROPERTY(BlueprintReadWrite, Transient, Replicated, Category = "GameSettings")
 	FString ServerName;
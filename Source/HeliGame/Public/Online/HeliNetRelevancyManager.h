@@ -0,0 +1,130 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "GameFramework/Info.h"
+#include "HeliNetRelevancyManager.generated.h"
+
+class APlayerController;
+
+/* which relevancy rule an actor goes through, also used to report culled actors */
+UENUM()
+enum class EHeliNetRelevancyNode : uint8
+{
+	Helicopter,
+	Bot,
+	Projectile,
+	MAX UMETA(Hidden)
+};
+
+/* [server] cached info about a remote player looking at the world */
+struct FHeliNetViewer
+{
+	const APlayerController* Controller;
+
+	FVector ViewLocation;
+
+	FIntPoint Cell;
+
+	int32 TeamNumber;
+
+	FHeliNetViewer()
+		: Controller(nullptr)
+		, ViewLocation(FVector::ZeroVector)
+		, Cell(FIntPoint::ZeroValue)
+		, TeamNumber(-1)
+	{}
+};
+
+/* [server] which viewers can see a tracked actor, kept by the actor and rebuilt by AHeliNetRelevancyManager every tick */
+struct FHeliNetRelevancy
+{
+	/* bit N is set when viewer N is within the cull distance */
+	uint64 RelevantViewers;
+
+	/* the manager that filled this in, unset until the actor has been seen once */
+	TWeakObjectPtr<class AHeliNetRelevancyManager> Manager;
+
+	FHeliNetRelevancy()
+		: RelevantViewers(0)
+	{}
+};
+
+/*
+* [server] Cheap relevancy for the actors that move a lot (helicopters, bots and projectiles).
+* Once per tick viewers are bucketed into a 2D grid of CullDistance sized cells, every tracked actor checks the viewers
+* of the cells around its own and keeps which ones are within CullDistance, so IsNetRelevantFor is a bit test.
+* Teammates are always relevant. Game state and player states are already always relevant by default.
+* It also lowers NetUpdateFrequency of actors that are far from every viewer.
+*/
+UCLASS(notplaceable, Transient)
+class HELIGAME_API AHeliNetRelevancyManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AHeliNetRelevancyManager(const FObjectInitializer& ObjectInitializer);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	/* returns the manager of the current game mode, null on clients */
+	static AHeliNetRelevancyManager* Get(const UObject* WorldContextObject);
+
+	/* called from the actors IsNetRelevantFor, after their owner/instigator checks */
+	bool IsNetRelevantFor(const AActor* Actor, const FHeliNetRelevancy& Relevancy, int32 ActorTeamNumber, EHeliNetRelevancyNode Node, const AActor* RealViewer, const FVector& SrcLocation);
+
+	/* logs how many actors each node culled since the last call */
+	void DumpStats();
+
+	/* actors in the same team as the viewer are always relevant */
+	UPROPERTY(EditAnywhere, Category = "Relevancy")
+	bool bTeammatesAlwaysRelevant;
+
+	/* actors further than this from the viewer are not relevant (cm), also the size of a grid cell */
+	UPROPERTY(EditAnywhere, Category = "Relevancy")
+	float CullDistance;
+
+	/* actors closer than this to any viewer replicate at their default frequency */
+	UPROPERTY(EditAnywhere, Category = "UpdateFrequency")
+	float FullFrequencyDistance;
+
+	/* actors further than this from every viewer replicate at MinNetUpdateFrequency */
+	UPROPERTY(EditAnywhere, Category = "UpdateFrequency")
+	float MinFrequencyDistance;
+
+	UPROPERTY(EditAnywhere, Category = "UpdateFrequency")
+	float MinNetUpdateFrequency;
+
+	/* log stats every this seconds, 0 to disable */
+	UPROPERTY(EditAnywhere, Category = "Debug")
+	float StatsLogInterval;
+
+	/* viewers past this many fall back to a distance check on every call */
+	static const int32 MaxTrackedViewers = 64;
+
+private:
+	FIntPoint GetCell(const FVector& Location) const;
+
+	/* refresh viewers and their grid cells */
+	void UpdateViewers();
+
+	/* which viewers see the actor, and its update frequency from the nearest one */
+	void UpdateActor(AActor* Actor, FHeliNetRelevancy& Relevancy);
+
+	/* index in Viewers of RealViewer, INDEX_NONE when it is not tracked */
+	int32 FindViewerIndex(const AActor* RealViewer) const;
+
+	TArray<FHeliNetViewer> Viewers;
+
+	/* viewers standing in each grid cell, as bits of their index */
+	TMap<FIntPoint, uint64> ViewerCells;
+
+	/* counters since last dump */
+	int32 NumCulled[(uint8)EHeliNetRelevancyNode::MAX];
+
+	int32 NumRelevant[(uint8)EHeliNetRelevancyNode::MAX];
+
+	int32 NumRelevantByTeam;
+
+	float LastStatsTime;
+};
@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
 #include "GameFramework/DamageType.h"
+#include "HeliSignificanceManager.h"
+#include "HeliNetRelevancyManager.h"
 #include "HeliFighterVehicle.generated.h"
 
 class USoundCue;
@@ -126,12 +128,23 @@ private:
 	virtual void OnRep_PlayerState() override;
 
 protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* [client] how much cosmetic work this vehicle is worth to the local player */
+	EHeliSignificance Significance;
+
+	/* [dedicated server] strips the cosmetic components before they are registered, see bUseServerArchetype */
+	virtual void PreRegisterAllComponents() override;
+
 	/* Take damage & handle death */
 	virtual float TakeDamage(float Damage, struct FDamageEvent const &DamageEvent, class AController *EventInstigator, class AActor *DamageCauser) override;
 
 public:
-	// Called every frame
-	// virtual void Tick(float DeltaTime) override;
+	// Called every frame, only enabled on servers to record the transform history
+	virtual void Tick(float DeltaTime) override;
 	
 	// Called to bind functionality to input	
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
@@ -141,7 +154,15 @@ public:
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty> &OutLifetimeProps) const override;
 
+	/* [server] far away enemies are not relevant, see AHeliNetRelevancyManager */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	FHeliNetRelevancy& GetNetRelevancy() { return NetRelevancy; }
+
 private:
+	/* [server] viewers that can see us, filled in by AHeliNetRelevancyManager */
+	FHeliNetRelevancy NetRelevancy;
+
 	/** socket or bone name for attaching Primary weapon mesh */
  	UPROPERTY(Category = "Weapon", EditAnywhere, BlueprintReadWrite, meta = (AllowPrivateAccess = "true"))
  	FName PrimaryWeaponAttachPoint;
@@ -174,6 +195,10 @@ protected:
 
 	UPROPERTY(Category = "HealthSettings", VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	class UWidgetComponent *HealthBarWidgetComponent;
+
+	/* health bar tick interval (seconds) while the vehicle has Medium significance */
+	UPROPERTY(Category = "HealthSettings", EditDefaultsOnly, meta = (AllowPrivateAccess = "true"))
+	float MediumSignificanceHealthBarTickInterval;
 	
 	/*
 	* Camera
@@ -193,6 +218,31 @@ protected:
 
 	float SpawnDelay = 1.f;
 
+	/*
+	*	Server Archetype
+	*/
+
+	/* dedicated servers only build collision, physics body, movement and weapon: cameras, health bar and
+	* other cosmetic components are destroyed before being registered, so they never tick nor join the scene */
+	UPROPERTY(Category = "Optimization", EditDefaultsOnly, meta = (AllowPrivateAccess = "true"))
+	bool bUseServerArchetype;
+
+	/* whether this instance runs without its cosmetic components */
+	bool IsServerArchetype() const;
+
+	/* destroys what nothing on a dedicated server will ever draw, play or look through. Derived vehicles add their own */
+	virtual void StripCosmeticComponents();
+
+	template<class TComponent>
+	static void DestroyCosmeticComponent(TComponent*& Component)
+	{
+		if (Component)
+		{
+			Component->DestroyComponent();
+			Component = nullptr;
+		}
+	}
+
 	/*
 	*	Weapons
 	*/
@@ -233,6 +283,9 @@ protected:
 	UFUNCTION()
 	void OnRep_LastTakeHitInfo();
 
+	/* hits of the same instigator and damage type until this time are merged into LastTakeHitInfo */
+	float LastTakeHitTimeTimeout;
+
 	bool bIsDying;
 
 	virtual void PlayHit(float DamageTaken, struct FDamageEvent const &DamageEvent, APawn *PawnInstigator, AActor *DamageCauser, bool bKilled);
@@ -259,6 +312,32 @@ protected:
 	UPROPERTY(BlueprintReadWrite, Category = "Sound", meta = (AllowPrivateAccess = "true"))
 	class UAudioComponent* MainAudioComponent;
 
+	/*
+	*	Lag Compensation
+	*/
+
+	struct FTransformHistoryEntry
+	{
+		float Time;
+		FTransform Transform;
+	};
+
+	/* [server] ring buffer of the collision transform, one entry per tick */
+	TArray<FTransformHistoryEntry> TransformHistory;
+
+	int32 TransformHistoryHead;
+
+	int32 TransformHistoryNum;
+
+	UPROPERTY(EditDefaultsOnly, Category = "LagCompensation", meta = (AllowPrivateAccess = "true"))
+	int32 TransformHistorySize;
+
+	/* hits are never rewound further than this (seconds) */
+	UPROPERTY(EditDefaultsOnly, Category = "LagCompensation", meta = (AllowPrivateAccess = "true"))
+	float MaxRewindTime;
+
+	void RecordTransformHistory();
+
 public:
 	AHeliFighterVehicle(const FObjectInitializer &ObjectInitializer);
 	
@@ -275,6 +354,14 @@ public:
 	
 	/** get current weapon attach point */
 	FName GetCurrentWeaponAttachPoint() const;
+
+	EHeliSignificance GetSignificance() const { return Significance; }
+
+	/* [client] throttles health bar and engine audio, called by AHeliSignificanceManager */
+	virtual void SetSignificance(EHeliSignificance NewSignificance);
+
+	/** component owning the weapon attach point, the root unless the vehicle draws another mesh */
+	virtual USceneComponent* GetWeaponAttachComponent() const;
 	bool bPrimaryWeaponEquiped;
 	
 	/** Current weapon */
@@ -339,6 +426,15 @@ public:
 	*/
 	bool IsEnemyFor(AController *TestPC) const;
 
+	/*
+	* Lag Compensation
+	*/
+
+	/* [server] collision transform at the given server time, interpolated from the history and clamped to the rewind window */
+	bool GetHistoricalTransform(float Time, FTransform& OutTransform) const;
+
+	float GetMaxRewindTime() const;
+
 	/*
 	* Player Info (HUD)
 	*/
@@ -351,6 +447,9 @@ public:
 	void SetPlayerName(FName NewPlayerName);
 	
 	float GetHealthPercent();
+
+	/* health to show, derived classes may know better than the last replicated value */
+	virtual float GetCurrentHealth() const;
 	
 	void SetPlayerInfo(FName NewPlayerName, int32 NewTeamNumber);
 	
@@ -359,6 +458,9 @@ public:
 	void SetupPlayerInfoWidget();
 	
 	void RemoveHealthWidget();
+
+	/* creates the health bar widget again after RemoveHealthWidget, for vehicles reused after dying */
+	void RestoreHealthWidget();
 	
 	void EnableFirstPersonViewpoint();
 	
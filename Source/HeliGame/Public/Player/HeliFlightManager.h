@@ -0,0 +1,75 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "GameFramework/Info.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "HeliFlightModel.h"
+#include "HeliFlightManager.generated.h"
+
+class UHeliMoveComp;
+
+/*
+* [server] Flies every registered helicopter in one batch per physics substep instead of computing
+* the forces of each movement component on its own. Every simulating body registers the same custom
+* physics callback, so no helicopter depends on another one being awake; the first callback of a substep
+* gathers the state into FHeliFlightBatches, one per flight tuning, and FHeliFlightModel computes the forces
+* of each batch in one go, then each callback applies one force and one torque to its own body.
+*/
+UCLASS(notplaceable, Transient)
+class HELIGAME_API AHeliFlightManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AHeliFlightManager(const FObjectInitializer& ObjectInitializer);
+
+	/* returns the flight manager of the current game mode, null on clients */
+	static AHeliFlightManager* Get(const UObject* WorldContextObject);
+
+	void RegisterMoveComp(UHeliMoveComp* MoveComp);
+
+	void UnregisterMoveComp(UHeliMoveComp* MoveComp);
+
+	/* refreshes bodies and params, and registers the batch for the next physics step */
+	virtual void Tick(float DeltaSeconds) override;
+
+	int32 GetNumMoveComps() const { return MoveComps.Num(); }
+
+private:
+	UPROPERTY(Transient)
+	TArray<UHeliMoveComp*> MoveComps;
+
+	/* same order as MoveComps, null when the body is not simulating this frame */
+	TArray<FBodyInstance*> Bodies;
+
+	/* [physics] slot of every body in Bodies, for the callbacks */
+	TMap<FBodyInstance*, int32> BodyIndices;
+
+	/* [physics] bodies whose forces of the current batch are applied, one that comes back means a new substep */
+	TBitArray<> AppliedBodies;
+
+	/* same order as MoveComps, the batch flying the body and its slot in there */
+	TArray<int32> BodyBatches;
+
+	TArray<int32> BodySlots;
+
+	bool bHasBatch;
+
+	/* helicopters with the same tuning share a batch, usually there is only one */
+	TArray<FHeliFlightBatch> Batches;
+
+	/* rate (steps per second) the flight tuning is expressed at, see UHeliMoveComp::FlightStepRate */
+	UPROPERTY(EditDefaultsOnly, Category = "Flight", meta = (AllowPrivateAccess = "true"))
+	float FlightStepRate;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Flight", meta = (AllowPrivateAccess = "true"))
+	int32 MaxFlightStepsPerSubstep;
+
+	FCalculateCustomPhysics OnCalculateFlightPhysics;
+
+	/* [physics] called on every body for every substep, the first one computes the batch */
+	void SubstepFlightPhysics(float DeltaTime, FBodyInstance* BodyInstance);
+
+	void ComputeBatch();
+};
@@ -0,0 +1,351 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/* tuning of the flight model, copied from UHeliMoveComp */
+struct HELIGAME_API FHeliFlightParams
+{
+	/* world gravity (negative, cm/s^2) */
+	float GravityZ;
+
+	/* percentage of the gravity used for lift */
+	float GravityWeight;
+
+	float MinimumTiltInclinationAcceleration;
+
+	float BaseThrust;
+
+	/* pilot torques are ignored above this angular velocity (deg/s) */
+	float MaximumAngularVelocity;
+
+	/* auto roll: target roll rate (1/s) per radian of roll away from level */
+	float AutoRollProportionalGain;
+
+	/* auto roll: torque per rad/s of difference between target and current roll rate */
+	float AutoRollDerivativeGain;
+
+	/* auto roll never asks for a faster roll rate than this (deg/s) */
+	float MaxAutoRollRate;
+
+	/* auto roll torque limit, an acceleration (rad/s^2) when bAccelChange is set */
+	float MaxAutoRollTorque;
+
+	/* acceleration (1/s) per cm/s of wind, about the linear damping of the body makes it drift with the wind. Zero ignores the wind */
+	float WindResponse;
+
+	/* how much stronger turbulence gets right above the ground, where the rotor wash comes back */
+	float RotorWashTurbulenceScale;
+
+	/* of the body, the physics engine applies them on its own, only Integrate and IntegrateBodyForce need them */
+	float LinearDamping;
+
+	float AngularDamping;
+
+	bool bAddLift;
+
+	/* thrust and torques are accelerations (mass has no effect) instead of forces */
+	bool bAccelChange;
+
+	FHeliFlightParams()
+		: GravityZ(-980.f)
+		, GravityWeight(0.9f)
+		, MinimumTiltInclinationAcceleration(3000.f)
+		, BaseThrust(10000.f)
+		, MaximumAngularVelocity(100.f)
+		, AutoRollProportionalGain(2.f)
+		, AutoRollDerivativeGain(4.f)
+		, MaxAutoRollRate(45.f)
+		, MaxAutoRollTorque(3.f)
+		, WindResponse(0.f)
+		, RotorWashTurbulenceScale(0.f)
+		, LinearDamping(0.f)
+		, AngularDamping(0.f)
+		, bAddLift(true)
+		, bAccelChange(true)
+	{}
+
+	bool operator==(const FHeliFlightParams& Other) const
+	{
+		return GravityZ == Other.GravityZ
+			&& GravityWeight == Other.GravityWeight
+			&& MinimumTiltInclinationAcceleration == Other.MinimumTiltInclinationAcceleration
+			&& BaseThrust == Other.BaseThrust
+			&& MaximumAngularVelocity == Other.MaximumAngularVelocity
+			&& AutoRollProportionalGain == Other.AutoRollProportionalGain
+			&& AutoRollDerivativeGain == Other.AutoRollDerivativeGain
+			&& MaxAutoRollRate == Other.MaxAutoRollRate
+			&& MaxAutoRollTorque == Other.MaxAutoRollTorque
+			&& WindResponse == Other.WindResponse
+			&& RotorWashTurbulenceScale == Other.RotorWashTurbulenceScale
+			&& LinearDamping == Other.LinearDamping
+			&& AngularDamping == Other.AngularDamping
+			&& bAddLift == Other.bAddLift
+			&& bAccelChange == Other.bAccelChange;
+	}
+};
+
+/* pilot commands, same meaning as FHeliMoveInput axes */
+struct HELIGAME_API FHeliFlightInput
+{
+	float Pitch;
+
+	float Yaw;
+
+	float Roll;
+
+	float Thrust;
+
+	bool bAutoRollStabilization;
+
+	FHeliFlightInput()
+		: Pitch(0.f)
+		, Yaw(0.f)
+		, Roll(0.f)
+		, Thrust(0.f)
+		, bAutoRollStabilization(false)
+	{}
+};
+
+/* air around a body, sampled from UHeliWindField */
+struct HELIGAME_API FHeliFlightWind
+{
+	/* steady wind, cm/s */
+	FVector Velocity;
+
+	/* gust on top of the wind at the time it was sampled, cm/s */
+	FVector Turbulence;
+
+	/* 0 high up, 1 right above the ground */
+	float GroundProximity;
+
+	FHeliFlightWind()
+		: Velocity(FVector::ZeroVector)
+		, Turbulence(FVector::ZeroVector)
+		, GroundProximity(0.f)
+	{}
+};
+
+/* rigid body the flight model works on */
+struct HELIGAME_API FHeliFlightBodyState
+{
+	FVector Location;
+
+	FQuat Rotation;
+
+	/* cm/s */
+	FVector LinearVelocity;
+
+	/* deg/s, world axes */
+	FVector AngularVelocity;
+
+	/* kg */
+	float Mass;
+
+	/* wind at Location */
+	FHeliFlightWind Wind;
+
+	FHeliFlightBodyState()
+		: Location(FVector::ZeroVector)
+		, Rotation(FQuat::Identity)
+		, LinearVelocity(FVector::ZeroVector)
+		, AngularVelocity(FVector::ZeroVector)
+		, Mass(1000.f)
+	{}
+};
+
+/* what one step of the flight model wants applied to the body */
+struct HELIGAME_API FHeliFlightForces
+{
+	/* lift, and thrust when it is not an acceleration */
+	FVector Force;
+
+	/* wind, and thrust when bAccelChange is set */
+	FVector Acceleration;
+
+	/* pilot torque, radians, an acceleration when bAccelChange is set */
+	FVector Torque;
+
+	FHeliFlightForces()
+		: Force(FVector::ZeroVector)
+		, Acceleration(FVector::ZeroVector)
+		, Torque(FVector::ZeroVector)
+	{}
+};
+
+/*
+* flight state of many helicopters as structure of arrays, one float array per component so ComputeForcesBatch
+* works on several helicopters at once. Every array has the same size. The helicopters share their tuning,
+* AHeliFlightManager keeps one batch per tuning.
+*/
+struct HELIGAME_API FHeliFlightBatch
+{
+	FHeliFlightParams Params;
+
+	/* body rotation quaternion */
+	TArray<float> RotationX;
+
+	TArray<float> RotationY;
+
+	TArray<float> RotationZ;
+
+	TArray<float> RotationW;
+
+	/* deg/s */
+	TArray<float> AngularVelocityX;
+
+	TArray<float> AngularVelocityY;
+
+	TArray<float> AngularVelocityZ;
+
+	/* zero skips the helicopter */
+	TArray<float> Masses;
+
+	TArray<float> Pitch;
+
+	TArray<float> Yaw;
+
+	TArray<float> Roll;
+
+	TArray<float> Thrust;
+
+	/* 1 with auto roll stabilization, 0 without */
+	TArray<float> AutoRoll;
+
+	/* FHeliFlightWind */
+	TArray<float> WindX;
+
+	TArray<float> WindY;
+
+	TArray<float> WindZ;
+
+	TArray<float> TurbulenceX;
+
+	TArray<float> TurbulenceY;
+
+	TArray<float> TurbulenceZ;
+
+	TArray<float> GroundProximity;
+
+	/* results, same meaning as FHeliFlightForces */
+	TArray<float> ForceX;
+
+	TArray<float> ForceY;
+
+	TArray<float> ForceZ;
+
+	TArray<float> AccelerationX;
+
+	TArray<float> AccelerationY;
+
+	TArray<float> AccelerationZ;
+
+	TArray<float> TorqueX;
+
+	TArray<float> TorqueY;
+
+	TArray<float> TorqueZ;
+
+	/* ComputeForcesBatch only: tangents of the lift and the auto roll angle, computed on their own between its passes */
+	TArray<float> InclinationTangents;
+
+	TArray<float> TiltTangents;
+
+	TArray<float> RollErrors;
+
+	TArray<float> RollErrorCosines;
+
+	int32 Num() const { return Masses.Num(); }
+
+	void SetNum(int32 NewNum);
+
+	void SetBody(int32 Index, const FQuat& Rotation, const FVector& AngularVelocity, float Mass, const FHeliFlightInput& Input, const FHeliFlightWind& Wind);
+
+	void GetForces(int32 Index, FHeliFlightForces& OutForces) const;
+};
+
+/* what RunBenchmark measured, ns per helicopter and step */
+struct HELIGAME_API FHeliFlightBenchmarkResult
+{
+	/* forces and integration */
+	double StepTime;
+
+	/* forces alone, one helicopter at a time */
+	double ForcesTime;
+
+	/* forces alone, the whole batch at once */
+	double BatchedForcesTime;
+
+	/* sum of the final locations, NaN when the simulation blew up */
+	FVector Checksum;
+
+	FHeliFlightBenchmarkResult()
+		: StepTime(0.0)
+		, ForcesTime(0.0)
+		, BatchedForcesTime(0.0)
+		, Checksum(FVector::ZeroVector)
+	{}
+};
+
+/*
+* Helicopter flight math on plain structs, no UObject nor physics engine involved,
+* so it can be profiled and tuned on its own. UHeliMoveComp applies the results to its body.
+*/
+struct HELIGAME_API FHeliFlightModel
+{
+	/* keeps the helicopter hovering against gravity and pushes it where it is leaning to */
+	static FVector ComputeLift(const FQuat& Rotation, float Mass, const FHeliFlightParams& Params);
+
+	static FVector ComputeThrust(const FQuat& Rotation, float Thrust, const FHeliFlightParams& Params);
+
+	/* zero when the body already spins faster than MaximumAngularVelocity */
+	static FVector ComputeTorque(const FQuat& Rotation, const FVector& AngularVelocity, const FHeliFlightInput& Input, const FHeliFlightParams& Params);
+
+	/* PD torque around the forward axis steering the roll back to level, zero when flying straight up or down */
+	static FVector ComputeAutoRollTorque(const FQuat& Rotation, const FVector& AngularVelocity, const FHeliFlightParams& Params);
+
+	/* pushes the body along with the air, mass independent. The linear damping of the body is what keeps it from
+	   going faster than the wind. Turbulence grows with ground proximity */
+	static FVector ComputeWindAcceleration(const FHeliFlightWind& Wind, const FHeliFlightParams& Params);
+
+	/* all of the above at once. Runs the math of ComputeForcesBatch on a single body, so both give the same bits */
+	static void ComputeForces(const FHeliFlightBodyState& State, const FHeliFlightInput& Input, const FHeliFlightParams& Params, FHeliFlightForces& OutForces);
+
+	/*
+	* same as ComputeForces for every helicopter of the batch. Two branchless passes over the arrays the compiler can
+	* vectorize, around a scalar one for the tangents: a vector math library would round them differently than the
+	* per body path predicting clients use
+	*/
+	static void ComputeForcesBatch(FHeliFlightBatch& Batch);
+
+	/* semi implicit euler with gravity, the inertia tensor is approximated by the mass. Only used where there is no physics scene */
+	static void Integrate(FHeliFlightBodyState& State, const FHeliFlightForces& Forces, const FHeliFlightParams& Params, float DeltaTime);
+
+	static void Step(FHeliFlightBodyState& State, const FHeliFlightInput& Input, const FHeliFlightParams& Params, float DeltaTime);
+
+	/* lift, thrust and wind as the single force UHeliMoveComp and AHeliFlightManager hand to the physics engine */
+	static FVector ComputeBodyForce(const FVector& Force, const FVector& Acceleration, float Mass);
+
+	/* share of a physics substep the flight forces act over, the time of a hitch over MaxFlightSteps flight steps is dropped.
+	   OutNumSteps is how many flight steps the flown time is worth */
+	static float ComputeSubstepWeight(float DeltaTime, float FlightStepRate, int32 MaxFlightSteps, float& OutNumSteps);
+
+	/* what the physics engine does with a body force and torque added during a substep, same approximations as Integrate */
+	static void IntegrateBodyForce(FHeliFlightBodyState& State, const FVector& Force, const FVector& Torque, const FHeliFlightParams& Params, float DeltaTime);
+
+	/* steps NumHelicopters bodies NumSteps times with varying input and logs how long it took. Needs no world,
+	   besides the BenchmarkFlightModel exec it is the HeliFlight.Benchmark console command and an automation test */
+	static FHeliFlightBenchmarkResult RunBenchmark(int32 NumHelicopters, int32 NumSteps, float DeltaTime);
+
+private:
+	/* the axes of the body rotation are shared by lift, thrust and torque */
+	static FVector ComputeLift(const FVector& Forward, const FVector& Right, const FVector& Up, float Mass, const FHeliFlightParams& Params);
+
+	static FVector ComputeThrust(const FVector& Forward, const FVector& Up, float Thrust, const FHeliFlightParams& Params);
+
+	static FVector ComputeAutoRollTorque(const FVector& Forward, const FVector& Up, const FVector& AngularVelocity, const FHeliFlightParams& Params);
+
+	/* semi implicit euler step shared by Integrate and IntegrateBodyForce, AngularAcceleration in rad/s^2 */
+	static void IntegrateAccelerations(FHeliFlightBodyState& State, const FVector& LinearAcceleration, const FVector& AngularAcceleration, const FHeliFlightParams& Params, float DeltaTime);
+};
@@ -0,0 +1,125 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HeliFlightModel.h"
+#include "HeliMoveComp.h"
+
+class UHeliWindField;
+
+/* a flight to replay: where it started, the pilot input of every fixed step and the states it went through */
+struct HELIGAME_API FHeliFlightRecording
+{
+	FHeliFlightBodyState InitialState;
+
+	/* tuning it was flown with, a recording does not change when the defaults do */
+	FHeliFlightParams Params;
+
+	float DeltaTime;
+
+	/* wind grid the flight goes through, see UHeliWindField::Store. Without one it stays in InitialState.Wind */
+	FVector WindOrigin;
+
+	float WindCellSize;
+
+	FIntVector WindDimensions;
+
+	TArray<FHeliFlightWind> WindGrid;
+
+	TArray<FHeliFlightInput> Inputs;
+
+	/* one per input, empty until the flight has been simulated once */
+	TArray<FMovementState> States;
+
+	FHeliFlightRecording()
+		: DeltaTime(1.f / 120.f)
+		, WindOrigin(FVector::ZeroVector)
+		, WindCellSize(0.f)
+		, WindDimensions(FIntVector::ZeroValue)
+	{}
+
+	friend FArchive& operator<<(FArchive& Ar, FHeliFlightRecording& Recording);
+};
+
+/* where two state streams stop being identical and how far apart they got */
+struct HELIGAME_API FHeliFlightDivergence
+{
+	/* first frame that is not bit for bit identical, INDEX_NONE when none */
+	int32 Frame;
+
+	/* first field of that frame that differs */
+	const TCHAR* Field;
+
+	int32 NumDivergentFrames;
+
+	/* largest differences over the whole stream, cm, deg, cm/s and deg/s */
+	float MaxLocationError;
+
+	float MaxRotationError;
+
+	float MaxLinearVelocityError;
+
+	float MaxAngularVelocityError;
+
+	FHeliFlightDivergence()
+		: Frame(INDEX_NONE)
+		, Field(TEXT(""))
+		, NumDivergentFrames(0)
+		, MaxLocationError(0.f)
+		, MaxRotationError(0.f)
+		, MaxLinearVelocityError(0.f)
+		, MaxAngularVelocityError(0.f)
+	{}
+
+	bool IsDeterministic() const { return Frame == INDEX_NONE; }
+};
+
+/*
+* Determinism check of FHeliFlightModel, no world, physics scene nor network involved. The same inputs are
+* flown at a fixed timestep through the same UHeliWindField by two instances: the per body path UHeliMoveComp
+* uses on predicting clients and the batched path AHeliFlightManager uses on the server. Both are flown once with
+* Integrate and once the way their physics substep callbacks hand the forces to the physics engine, a substep at a
+* time through ComputeSubstepWeight, ComputeBodyForce and IntegrateBodyForce. Their FMovementState streams are
+* compared bit for bit, and so is the stream of a recording saved by another build or machine. Whenever a prediction or
+* rollback change goes in, this tells whether client and server still compute the same flight.
+*/
+struct HELIGAME_API FHeliFlightVerification
+{
+	/* pilot like input: sticks held for a while then moved somewhere else, the same for the same seed */
+	static void GenerateInputs(int32 Seed, int32 NumFrames, TArray<FHeliFlightInput>& OutInputs);
+
+	/* a small grid of random wind around Location, so a generated flight crosses a few cells */
+	static void GenerateWindGrid(int32 Seed, const FVector& Location, FHeliFlightRecording& Recording);
+
+	/* transient field with the wind grid of Recording, null without one. Nothing references it, don't keep it around */
+	static UHeliWindField* CreateWindField(const FHeliFlightRecording& Recording);
+
+	/* flies the inputs of Recording from its initial state, one state per input. With NumSubsteps every input is flown
+	   over that many physics substeps as the substep callbacks do, otherwise in one Integrate. The wind is sampled from
+	   WindField where the body is at every substep, the recording starts at server time zero */
+	static void Simulate(const FHeliFlightRecording& Recording, const UHeliWindField* WindField, bool bBatched, int32 NumSubsteps, TArray<FMovementState>& OutStates);
+
+	static FHeliFlightDivergence Compare(const TArray<FMovementState>& Expected, const TArray<FMovementState>& Actual);
+
+	/* recordings live in Saved/FlightVerification */
+	static bool SaveRecording(const FString& Name, FHeliFlightRecording& Recording);
+
+	static bool LoadRecording(const FString& Name, FHeliFlightRecording& OutRecording);
+
+	/*
+	* Flies NumFrames of generated input on both paths, integrated and over NumSubsteps physics substeps, and
+	* logs the first divergence, and which of lift, thrust and torques differed first for the very same body state.
+	* With a RecordingName the recording is replayed and compared instead when it exists, or saved for other builds
+	* to compare against. Returns whether every comparison was bit for bit identical.
+	*/
+	static bool Run(int32 NumFrames, int32 Seed, const FString& RecordingName, int32 NumSubsteps = 2);
+
+private:
+	static FMovementState ToMovementState(const FHeliFlightBodyState& State, float Timestamp);
+
+	/* frame of the first force, acceleration or torque both paths disagree on while given the same states, INDEX_NONE when none */
+	static void FindFirstDivergentTerm(const FHeliFlightRecording& Recording, const UHeliWindField* WindField, int32& OutFrame, const TCHAR*& OutTerm);
+
+	static void LogDivergence(const TCHAR* Label, const FHeliFlightDivergence& Divergence, int32 NumFrames);
+};
@@ -0,0 +1,53 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AController;
+class UWorld;
+struct FHitResult;
+struct FCollisionQueryParams;
+
+/* [server] how much lag compensation costs */
+struct HELIGAME_API FHeliLagCompensationStats
+{
+	int32 NumQueries;
+
+	/* vehicles close enough to a query to be traced against */
+	int32 NumTracedVehicles;
+
+	/* wall clock time spent in queries */
+	double TotalQuerySeconds;
+
+	double MaxQuerySeconds;
+
+	/* game time we went back, summed over every query */
+	float TotalRewindTime;
+
+	FHeliLagCompensationStats()
+	{
+		Reset();
+	}
+
+	void Reset();
+
+	void Log() const;
+
+	static FHeliLagCompensationStats& Get();
+};
+
+/* [server] hit tests against fighter vehicles where the shooter saw them when it fired */
+class HELIGAME_API FHeliLagCompensation
+{
+public:
+	/* server time the shooter was seeing: now minus its round trip and the interpolation delay it reports drawing remote helicopters with */
+	static float GetShooterViewTime(UWorld* World, AController* Shooter);
+
+	/*
+	* Traces Start to End against every fighter vehicle (but the shooter's and the ignored ones) where the shooter saw it,
+	* nothing is moved: the trace goes through the vehicle where it is now, offset by how far it moved since then.
+	* OutHit is where the shooter saw the hit, with the physical material of the hit zone. Cheap enough for every tick.
+	*/
+	static bool LineTraceVehicles(UWorld* World, AController* Shooter, const FVector& Start, const FVector& End, const FCollisionQueryParams& Params, FHitResult& OutHit);
+};
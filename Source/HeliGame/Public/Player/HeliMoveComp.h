@@ -4,9 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PawnMovementComponent.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "HeliFlightModel.h"
 #include "HeliMoveComp.generated.h"
 
 class UPrimitiveComponent;
+class UHeliWindField;
 
 USTRUCT()
 struct FMovementState
@@ -28,11 +31,27 @@ struct FMovementState
 	UPROPERTY()
 	float Timestamp;
 
+	/* [net] Timestamp in milliseconds, wrapped to 16 bits. Receivers must unwrap it before comparing times */
+	uint16 Stamp;
+
+	/* [net] Location holds the offset from BaselineStamp's state extrapolated to this Timestamp */
+	bool bIsDelta;
+
+	/* [net] stamp of the state the receiver already has and this one was delta encoded against */
+	uint16 BaselineStamp;
+
+	/* [sender] world location of a delta encoded state, picks the precision tier for each receiver */
+	FVector SenderWorldLocation;
+
 	FMovementState()
 	{
 		Location = LinearVelocity = AngularVelocity = FVector::ZeroVector;
 		Rotation = FRotator::ZeroRotator;
 		Timestamp = 1;
+		Stamp = ToWireStamp(Timestamp);
+		bIsDelta = false;
+		BaselineStamp = 0;
+		SenderWorldLocation = FVector::ZeroVector;
 	}
 	FMovementState(
 		FVector_NetQuantize100 Loc,
@@ -46,8 +65,137 @@ struct FMovementState
 		, LinearVelocity(Vel)
 		, AngularVelocity(Angular)
 		, Timestamp(ReplicationTimeInSeconds)
+		, Stamp(ToWireStamp(ReplicationTimeInSeconds))
+		, bIsDelta(false)
+		, BaselineStamp(0)
+		, SenderWorldLocation(Loc)
 
 	{}
+
+	/* bit packed: smallest three quaternion, velocities bounded by the flight model and 16 bits timestamp.
+	   Precision is chosen per receiving connection from distance and view direction */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/* [sender] only send the offset from Baseline, it must be a state the receiver has already acknowledged */
+	void EncodeDelta(const FMovementState& Baseline);
+
+	/* [receiver] turns a delta encoded state back into an absolute one, Baseline must match BaselineStamp */
+	void DecodeDelta(const FMovementState& Baseline);
+
+	static uint16 ToWireStamp(float TimeSeconds)
+	{
+		return static_cast<uint16>(FMath::RoundToInt(TimeSeconds * 1000.f) & 0xFFFF);
+	}
+
+private:
+	FVector GetBaselineLocation(const FMovementState& Baseline) const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FMovementState> : public TStructOpsTypeTraitsBase2<FMovementState>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/* pilot commands gathered during one client frame, this is what the owning client sends to the server */
+USTRUCT()
+struct FHeliMoveInput
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	float Pitch;
+
+	UPROPERTY()
+	float Yaw;
+
+	UPROPERTY()
+	float Roll;
+
+	UPROPERTY()
+	float Thrust;
+
+	/* client time when this input was sampled */
+	UPROPERTY()
+	float Timestamp;
+
+	/* increases by one for every input sent, wraps around */
+	UPROPERTY()
+	uint16 Sequence;
+
+	UPROPERTY()
+	uint8 bAutoRollStabilization : 1;
+
+	/* last server correction the client received, server delta encodes the next ones against it */
+	UPROPERTY()
+	uint8 bHasAckedState : 1;
+
+	UPROPERTY()
+	uint16 AckedStateStamp;
+
+	/* how far in the past the client draws other helicopters (their snapshot interpolation delay), lag compensation rewinds by it */
+	UPROPERTY()
+	float ProxyViewDelay;
+
+	FHeliMoveInput()
+		: Pitch(0.f)
+		, Yaw(0.f)
+		, Roll(0.f)
+		, Thrust(0.f)
+		, Timestamp(0.f)
+		, Sequence(0)
+		, bAutoRollStabilization(false)
+		, bHasAckedState(false)
+		, AckedStateStamp(0)
+		, ProxyViewDelay(0.f)
+	{}
+
+	void ResetAxes()
+	{
+		Pitch = Yaw = Roll = Thrust = 0.f;
+	}
+};
+
+/* most recent inputs not yet acknowledged by the server, newest first, so one lost packet does not lose an input */
+USTRUCT()
+struct FHeliMoveInputPacket
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<FHeliMoveInput> Moves;
+
+	/* no more than this many inputs per packet */
+	static const int32 MaxMoves = 8;
+
+	/* bit packed: the newest input is sent in full, older ones only send what differs from the next newer one */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FHeliMoveInputPacket> : public TStructOpsTypeTraitsBase2<FHeliMoveInputPacket>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
+/* [client] input sent to the server together with the state we predicted when sending it */
+struct FHeliSavedMove
+{
+	FHeliMoveInput Input;
+
+	FMovementState PredictedState;
+
+	bool bValid;
+
+	FHeliSavedMove()
+		: bValid(false)
+	{}
 };
 
 /**
@@ -98,10 +246,6 @@ class HELIGAME_API UHeliMoveComp : public UPawnMovementComponent
 	UPROPERTY(Category = "6DoFPhysics", EditAnywhere, meta = (AllowPrivateAccess = "true"))
 	float GravityWeight;
 
-	FVector ComputeLift(UPrimitiveComponent* BaseComp);
-
-	void AddLift();
-
 
 	/*
 		Thrust
@@ -109,37 +253,373 @@ class HELIGAME_API UHeliMoveComp : public UPawnMovementComponent
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MovementSettings", meta = (AllowPrivateAccess = "true"))
 	float BaseThrust = 1.f;
 
-	FVector ComputeThrust(UPrimitiveComponent* BaseComp, float InThrust);
+	/*
+		Wind
+	*/
+
+	/* acceleration (1/s) per cm/s of wind, the same as the linear damping of the body makes it drift at the wind speed. Zero ignores the wind */
+	UPROPERTY(Category = "6DoFPhysics|Wind", EditAnywhere, meta = (AllowPrivateAccess = "true"))
+	float WindResponse;
+
+	/* turbulence right above the ground is this many times stronger on top of the baked one, the rotor wash coming back */
+	UPROPERTY(Category = "6DoFPhysics|Wind", EditAnywhere, meta = (AllowPrivateAccess = "true"))
+	float RotorWashTurbulenceScale;
+
+	/* wind of the map found at BeginPlay, read only so the physics thread may sample it */
+	UPROPERTY(Transient)
+	UHeliWindField* WindField;
+
+	/* lift, thrust and pilot torques of one input record as a single force and a single torque */
+	void ApplyFlightForces(FBodyInstance* BodyInstance, const FHeliFlightBodyState& BodyState, const FHeliMoveInput& Input, float ForceScale, float NumSteps, bool bAllowSubstepping);
+
+	/*
+		Flight Substepping
+	*/
+
+	/* apply lift, thrust and pilot torques from the physics substep callback instead of once per rendered frame */
+	UPROPERTY(EditAnywhere, Category = "6DoFPhysics|Substepping", meta = (AllowPrivateAccess = "true"))
+	bool bUseFlightSubstepping;
+
+	/* rate (steps per second) the flight tuning is expressed at, substeps apply the fraction of a step they last */
+	UPROPERTY(EditAnywhere, Category = "6DoFPhysics|Substepping", meta = (AllowPrivateAccess = "true"))
+	float FlightStepRate;
+
+	/* a substep never integrates more than this many flight steps, the rest of the time is dropped */
+	UPROPERTY(EditAnywhere, Category = "6DoFPhysics|Substepping", meta = (AllowPrivateAccess = "true"))
+	int32 MaxFlightStepsPerSubstep;
+
+	/* input the substeps of this frame fly with */
+	FHeliMoveInput FlightInput;
+
+	/* [server] AHeliFlightManager applies our flight forces together with every other helicopter */
+	bool bFlownByFlightManager;
+
+	FCalculateCustomPhysics OnCalculateFlightPhysics;
+
+	/* [physics] called for every physics substep of the frame the body was registered for */
+	void SubstepFlightPhysics(float DeltaTime, FBodyInstance* BodyInstance);
 
 	/*
 		Movement Replication
 	*/
-	
+
+	/* input gathered from the pilot during the current frame */
+	FHeliMoveInput PendingInput;
+
+	/* [server] input of the owning client applied this tick, it is held until the next one is taken from ServerPendingInputs */
+	FHeliMoveInput ServerCurrentInput;
+
+	/* [server] whether we have received any input from the owning client yet */
+	bool bHasServerInput;
+
+	/* [server] inputs received but not applied yet, oldest first, one is taken every tick */
+	TArray<FHeliMoveInput> ServerPendingInputs;
+
+	/* [server] newest sequence received, anything older or equal is a redundant copy */
+	uint16 LastReceivedMoveSequence;
+
+	/* [server] inputs that were lost in their own packet and arrived as a redundant copy */
+	int32 NumRecoveredMoves;
+
+	/* [server] redundant copies discarded because we already had them */
+	int32 NumDuplicateMoves;
+
+	/* [server] time when the last correction was sent to the owning client */
+	float LastCorrectionSentTime;
+
+	/* [server] state when the newest input taken from ServerPendingInputs started to be applied, the same instant
+	   the owning client saved as the PredictedState of that input. Corrections compare these two */
+	FMovementState ServerAckedMoveState;
+
+	/* [server] sequence of the input ServerAckedMoveState belongs to */
+	uint16 ServerAckedMoveSequence;
+
+	bool bHasServerAckedMove;
+
+	/* [client] inputs not yet acknowledged by the server, see GetSavedMove */
+	TArray<FHeliSavedMove> SavedMoves;
+
+	/* [client] slot of Sequence in SavedMoves. The size is a power of two, so slots stay in order when the sequence wraps */
+	FHeliSavedMove& GetSavedMove(uint16 Sequence)
+	{
+		return SavedMoves[Sequence & (SavedMoves.Num() - 1)];
+	}
+
+	/* [client] sequence of the next input to be sent */
+	uint16 NextMoveSequence;
+
+	/* [client] size of the ring buffer of unacknowledged inputs, rounded up to a power of two */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
+	int32 MaxSavedMoves;
+
+	/* [client] every packet also carries up to this many of the previous unacknowledged inputs */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
+	int32 RedundantMoveCount;
+
+	/* [server] how many corrections per second the server sends back to the owning client */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
+	float ServerCorrectionRate;
+
+	/* [client] position error (cm) tolerated before reconciling with the server state */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
+	float MaxLocationErrorBeforeCorrection;
+
+	/* [client] rotation error (degrees) tolerated before reconciling with the server state */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
+	float MaxRotationErrorBeforeCorrection;
+
+	/* max absolute value accepted for each input axis, anything above is clamped by the server */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
+	float MaxInputAxisValue;
+
+	/*
+		Send Policy
+	*/
+
+	/* [client] never send inputs more often than this (updates per second) */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|SendPolicy", meta = (AllowPrivateAccess = "true"))
+	float MaxSendRate;
+
+	/* [client] always send at least this many updates per second, even if nothing has changed. Never less than ServerCorrectionRate */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|SendPolicy", meta = (AllowPrivateAccess = "true"))
+	float MinSendRate;
+
+	/* [client] send when the extrapolated location of the last sent state drifts more than this (cm) */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|SendPolicy", meta = (AllowPrivateAccess = "true"))
+	float SendLocationErrorThreshold;
+
+	/* [client] send when the extrapolated rotation of the last sent state drifts more than this (degrees) */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|SendPolicy", meta = (AllowPrivateAccess = "true"))
+	float SendRotationErrorThreshold;
+
+	/* [client] send when any input axis changes more than this since the last sent input */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|SendPolicy", meta = (AllowPrivateAccess = "true"))
+	float SendInputChangeThreshold;
+
+	/* [client] last state and input actually sent to the server */
+	FMovementState LastSentMovementState;
+
+	FHeliMoveInput LastSentInput;
+
+	float LastSendTime;
+
+	/* [client] counters for sent and suppressed movement updates */
+	int32 NumSentMovementUpdates;
+
+	int32 NumSuppressedMovementUpdates;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Helpers|Replication", meta = (AllowPrivateAccess = "true"))
+	bool bDrawSendPolicyStats;
+
+	/* [client] runs the same extrapolation remote peers use and tells whether it has drifted enough to send a new update */
+	bool ShouldSendMovementUpdate(const FMovementState& CurrentState, float CurrentTime) const;
+
+	/* [client] sends the input gathered during this frame to the server and keeps it until acknowledged */
 	void SendMovementState();
 
 	UFUNCTION(Unreliable, Server, WithValidation)
-	void Server_SetMovementState(const FMovementState& NewMovementState);
+	void Server_SendMoveInputs(const FHeliMoveInputPacket& Packet);
 
-	UPROPERTY(Transient, Replicated)
+	/* [server] clamps the input and queues it to be applied */
+	void ReceiveMoveInput(const FHeliMoveInput& NewInput);
+
+	/* applies one frame of input through the flight model when not substepping */
+	void ApplyInput(const FHeliMoveInput& Input);
+
+	/* [server] sends the authoritative state to the owning client */
+	void SendCorrectionToOwningClient();
+
+	UFUNCTION(Unreliable, Client)
+	void Client_AdjustMovementState(uint16 AckSequence, const FMovementState& ServerState);
+
+	/* [client] replays unacknowledged inputs on top of the authoritative server state */
+	void ReconcileWithServerState(uint16 AckSequence, const FMovementState& ServerState);
+
+	/* [client] flies State through FHeliFlightModel with the input of Move until EndTime, on the server timeline */
+	void ReplaySavedMove(FMovementState& State, const FHeliSavedMove& Move, float EndTime, float Mass) const;
+
+	FMovementState GetCurrentMovementState() const;
+
+	bool IsSimulatingAuthoritatively() const;
+
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_ReplicatedMovementState)
 	struct FMovementState ReplicatedMovementState;
 
+	/* [simulated proxy] buffers every received state so we can render it slightly in the past */
+	UFUNCTION()
+	void OnRep_ReplicatedMovementState();
+
+	/*
+		Movement State Compression
+	*/
+
+	/* [server] full state simulated proxies delta decode ReplicatedMovementState against, refreshed every KeyframeInterval */
+	UPROPERTY(Transient, Replicated)
+	struct FMovementState ReplicatedKeyframeState;
+
+	/* send only offsets from the last acknowledged state instead of the full location */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Compression", meta = (AllowPrivateAccess = "true"))
+	bool bUseDeltaCompression;
+
+	/* seconds between two keyframes, longer intervals mean bigger offsets to send */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Compression", meta = (AllowPrivateAccess = "true"))
+	float KeyframeInterval;
+
+	float LastKeyframeTime;
+
+	/* [server] authoritative absolute state of this frame, ReplicatedMovementState may only hold its delta */
+	FMovementState ServerMovementState;
+
+	/* [server] corrections sent to the owning client, so we can delta encode against the one it acknowledged */
+	TArray<FMovementState> SentCorrections;
+
+	/* [client] absolute states we can decode deltas against (keyframes or server corrections) */
+	TArray<FMovementState> ReceivedBaselines;
+
+	/* [client] last correction received from the server, acknowledged with the next input */
+	bool bHasReceivedCorrection;
+
+	uint16 LastReceivedCorrectionStamp;
+
+	/* [simulated proxy] last received absolute state, used when snapshot interpolation is off */
+	FMovementState LatestReceivedMovementState;
+
+	/* [client] reference used to unwrap the 16 bits timestamps */
+	bool bHasUnwrapReference;
+
+	bool bUnwrapUsesClockSync;
+
+	uint16 UnwrapReferenceStamp;
+
+	float UnwrapReferenceTime;
+
+	/* [server] AHeliMovementReplicator sends our state, ReplicatedMovementState is left alone */
+	bool bReplicatedByMovementReplicator;
+
+	/* [server] fills the replicated state (and keyframe) from ServerMovementState */
+	void UpdateReplicatedMovementState();
+
+	/* [client] decodes a received state, returns false if we don't have its baseline (anymore) */
+	bool ResolveReceivedState(FMovementState& State);
+
+	float UnwrapTimestamp(uint16 Stamp);
+
+	/* server world time as estimated by the local player controller, our own world time if there is none */
+	float GetSyncedServerTime() const;
+
+	static void StoreBaseline(TArray<FMovementState>& Baselines, const FMovementState& State);
+
+	static bool FindBaseline(const TArray<FMovementState>& Baselines, uint16 Stamp, FMovementState& OutBaseline);
+
 	void SetMovementState(const FMovementState& TargetMovementState);	
-	
-	void SetMovementStateSmoothly(const FMovementState& TargetMovementState, float DeltaTime);
 
-	/* controls whether use or not interpolation for movement replication. */
+	/* remote helicopters are kinematic bodies moved by replicated state only, they keep their collision for projectiles and traces */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
-	bool bUseInterpolationForMovementReplication;
+	bool bUseKinematicProxies;
 
-	/* controls how fast actual movement data will be interpolated with server's data. Greater values means that it will interpolate faster. */
-	float CurrentInterpolationSpeed;
+	/* simulates the body only where we fly it (server and owning client), the rest of the time it is kinematic */
+	void UpdateProxyPhysicsMode();
 
-	/* Greater values means that it will interpolate faster, so much greater values will have the same effect as NO interpolation at all... */
+	/* controls whether use or not snapshot interpolation for movement replication. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
-	float MaxInterpolationSpeed;
+	bool bUseInterpolationForMovementReplication;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MovementSettings|Replication", meta = (AllowPrivateAccess = "true"))
-	float MinInterpolationSpeed;
+	/*
+		Snapshot Interpolation
+	*/
+
+	/* [simulated proxy] received states ordered by their timestamps */
+	TArray<FMovementState> SnapshotBuffer;
+
+	/* max number of snapshots kept in the buffer */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Interpolation", meta = (AllowPrivateAccess = "true"))
+	int32 MaxSnapshots;
+
+	/* render delay will never go below this (seconds) */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Interpolation", meta = (AllowPrivateAccess = "true"))
+	float MinInterpolationDelay;
+
+	/* render delay will never go above this (seconds) */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Interpolation", meta = (AllowPrivateAccess = "true"))
+	float MaxInterpolationDelay;
+
+	/* how many times the measured jitter is added to the render delay */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Interpolation", meta = (AllowPrivateAccess = "true"))
+	float JitterDelayMultiplier;
+
+	/* how long we are allowed to extrapolate when the buffer runs dry (seconds) */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Interpolation", meta = (AllowPrivateAccess = "true"))
+	float MaxExtrapolationTime;
+
+	/* weight of every new measurement in the running averages of jitter and send interval */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Interpolation", meta = (AllowPrivateAccess = "true"))
+	float JitterSmoothingWeight;
+
+	/* local time minus sender time, tracks the fastest arrivals */
+	float SnapshotClockOffset;
+
+	bool bHasSnapshotClockOffset;
+
+	/* running average of how late snapshots arrive compared to the fastest one */
+	float SnapshotJitter;
+
+	/* running average of the time between snapshots */
+	float SnapshotInterval;
+
+	/* delay we are currently rendering proxies with, it moves smoothly towards the target delay */
+	float CurrentInterpolationDelay;
+
+	float TargetInterpolationDelay;
+
+	void AddSnapshot(const FMovementState& Snapshot);
+
+	/* Hermite interpolation between the bracketing snapshots, or bounded extrapolation past the newest one */
+	bool SampleSnapshotBuffer(float RenderTime, FMovementState& OutState) const;
+
+	void UpdateSnapshotInterpolation(float DeltaTime);
+
+	/* [client] average interpolation delay of the remote helicopters we are drawing */
+	float GetProxyViewDelay() const;
+
+	/*
+		Mesh Smoothing
+	*/
+
+	/* proxy corrections move the collision root at once, the visible mesh catches up through a decaying offset */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Smoothing", meta = (AllowPrivateAccess = "true"))
+	bool bSmoothProxyCorrections;
+
+	/* time constant the mesh offset decays with (seconds) */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Smoothing", meta = (AllowPrivateAccess = "true"))
+	float MeshSmoothingTime;
+
+	/* corrections bigger than this (cm) are not smoothed, the mesh snaps to the root */
+	UPROPERTY(EditAnywhere, Category = "MovementSettings|Replication|Smoothing", meta = (AllowPrivateAccess = "true"))
+	float MaxMeshSmoothingDistance;
+
+	/* [simulated proxy] visible mesh attached to the updated component, carries the offset */
+	UPROPERTY(Transient)
+	USceneComponent* SmoothedMeshComponent;
+
+	/* relative transform of the smoothed mesh when there is no offset */
+	FTransform SmoothedMeshBaseTransform;
+
+	/* world space, where the mesh is drawn minus where the root is */
+	FVector MeshTranslationOffset;
+
+	/* world space, applied on top of the root rotation */
+	FQuat MeshRotationOffset;
+
+	/* last state the root was moved to, the next one is compared against its extrapolation */
+	FMovementState LastProxyMovementState;
+
+	bool bHasProxyMovementState;
+
+	/* [simulated proxy] moves the root to the state at once and turns the unexpected part of the move into mesh offset.
+	* PredictionTime is how long the previous state was expected to keep moving, zero keeps the mesh exactly where it was drawn */
+	void ApplyProxyMovementState(const FMovementState& State, float PredictionTime);
+
+	void UpdateMeshSmoothing(float DeltaTime);
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Helpers|Replication", meta = (AllowPrivateAccess = "true"))
 	bool bDrawRole;
@@ -150,11 +630,24 @@ class HELIGAME_API UHeliMoveComp : public UPawnMovementComponent
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MovementSettings", meta = (AllowPrivateAccess = "true"))
 	bool bAutoRollStabilization;
 
-	/* controls how fast 'auto roll' will reach the stabilized rotation */
-	UPROPERTY(Category = "MovementSettings", EditAnywhere, meta = (AllowPrivateAccess = "true"))
-	float AutoRollInterpSpeed;
+	/* target roll rate (1/s) per radian away from level, how eagerly 'auto roll' goes back to level */
+	UPROPERTY(Category = "MovementSettings|AutoRoll", EditAnywhere, meta = (AllowPrivateAccess = "true"))
+	float AutoRollProportionalGain;
+
+	/* torque per rad/s of roll rate error, how hard 'auto roll' damps the roll */
+	UPROPERTY(Category = "MovementSettings|AutoRoll", EditAnywhere, meta = (AllowPrivateAccess = "true"))
+	float AutoRollDerivativeGain;
+
+	/* 'auto roll' never rolls faster than this (deg/s) */
+	UPROPERTY(Category = "MovementSettings|AutoRoll", EditAnywhere, meta = (AllowPrivateAccess = "true"))
+	float MaxAutoRollRate;
+
+	/* strongest torque 'auto roll' applies, pilot input can always overcome it */
+	UPROPERTY(Category = "MovementSettings|AutoRoll", EditAnywhere, meta = (AllowPrivateAccess = "true"))
+	float MaxAutoRollTorque;
 
-	void AutoRollStabilization(float deltaTime);
+	/* pilot input is dropped before it is flown or sent, the helicopter keeps flying on its own */
+	bool bControlsCrashed;
 
 public:
 	UHeliMoveComp(const FObjectInitializer& ObjectInitializer);
@@ -175,16 +668,71 @@ public:
 
 	bool IsNetworkSmoothingFactorActive();
 
+	/* [simulated proxy] mesh that is drawn smoothly while the updated component follows corrections at once */
+	void SetSmoothedMeshComponent(USceneComponent* InSmoothedMeshComponent);
+
+	/* forgets the inputs, corrections and snapshots of a previous life, for pawns reused by AHeliPawnPool */
+	void ResetMovementState();
+
 	void SetAutoRollStabilization(bool bNewAutoRollStabilization);
 
 	bool IsAutoRollingStabilization();
 
+	/* set on the server and on the owning client alike, so the prediction flies the same as the server */
+	void SetControlsCrashed(bool bNewControlsCrashed);
+
+	bool AreControlsCrashed() const { return bControlsCrashed; }
+
+	/* dead reckoning: moves a state forward in time using its own linear and angular velocities */
+	static FMovementState ExtrapolateMovementState(const FMovementState& State, float DeltaSeconds);
+
+	int32 GetNumSentMovementUpdates() const;
+
+	int32 GetNumSuppressedMovementUpdates() const;
+
+	/* [server] */
+	int32 GetNumRecoveredMoves() const;
+
+	/* [server] */
+	int32 GetNumDuplicateMoves() const;
+
+	/* [server] authoritative state of this frame */
+	const FMovementState& GetServerMovementState() const;
+
+	/* [simulated proxy] absolute states become baselines, deltas are decoded against them, then it goes to the snapshot buffer */
+	void ReceiveReplicatedMovementState(const FMovementState& State);
+
+	/* [simulated proxy] keeps an absolute state as a baseline for the deltas, it is not a snapshot */
+	void ReceiveReplicatedKeyframe(const FMovementState& Keyframe);
+
+	/* tuning handed over to FHeliFlightModel */
+	FHeliFlightParams GetFlightParams() const;
+
+	/* air at Location, calm when the map has no wind field */
+	FHeliFlightWind SampleWind(const FVector& Location) const;
+
+	/* at a given time of the server timeline, turbulence changes over time */
+	FHeliFlightWind SampleWind(const FVector& Location, float ServerTime) const;
+
+	/* input gathered during this frame, for the physics substeps */
+	const FHeliMoveInput& GetFlightInput() const { return FlightInput; }
+
+	static FHeliFlightInput ToFlightInput(const FHeliMoveInput& Input);
+
+	/* body flight forces apply to, null when it is not simulating physics */
+	FBodyInstance* GetFlightBodyInstance() const;
+
+	/* only the force and torque modes of the flight model can be batched */
+	bool CanUseBatchedFlight() const;
+
 	/* overrides */
 public:
 	void InitializeComponent() override;
 
 	void BeginPlay() override;
 
+	void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// UActorComponent interface
 	void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
 
@@ -0,0 +1,174 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "GameFramework/Info.h"
+#include "Engine/NetSerialization.h"
+#include "HeliMoveComp.h"
+#include "HeliMovementReplicator.generated.h"
+
+class AHeliMovementReplicator;
+class APlayerController;
+struct FHeliMovementEntryArray;
+
+/* movement of one pawn, an absolute keyframe or a delta against the last one */
+USTRUCT()
+struct FHeliMovementEntry : public FFastArraySerializerItem
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* replicated as its net GUID, resolves to null on clients the pawn is not relevant for */
+	UPROPERTY()
+	APawn* Pawn;
+
+	UPROPERTY()
+	FMovementState State;
+
+	/* [server] when State was last sent to this connection */
+	float LastSentTime;
+
+	FHeliMovementEntry()
+		: Pawn(nullptr)
+		, LastSentTime(0.f)
+	{}
+
+	/* [client] hands the state over to the pawn movement component */
+	void PostReplicatedAdd(const FHeliMovementEntryArray& InArraySerializer);
+
+	void PostReplicatedChange(const FHeliMovementEntryArray& InArraySerializer);
+};
+
+USTRUCT()
+struct FHeliMovementEntryArray : public FFastArraySerializer
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<FHeliMovementEntry> Items;
+
+	/* set on both ends by the owner, entries are baselines for the deltas instead of snapshots */
+	bool bKeyframes;
+
+	FHeliMovementEntryArray()
+		: bKeyframes(false)
+	{}
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FHeliMovementEntry, FHeliMovementEntryArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FHeliMovementEntryArray> : public TStructOpsTypeTraitsBase2<FHeliMovementEntryArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
+
+/* [server] a helicopter the replicator sends and the keyframe its deltas are encoded against, shared by every connection */
+USTRUCT()
+struct FHeliMovementSource
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	UHeliMoveComp* MoveComp;
+
+	FMovementState Keyframe;
+
+	bool bHasKeyframe;
+
+	FHeliMovementSource()
+		: MoveComp(nullptr)
+		, bHasKeyframe(false)
+	{}
+};
+
+/*
+* [server] Replicates the movement of every helicopter instead of one ReplicatedMovementState property per movement
+* component. It keeps the helicopters and their keyframes, and gives every remote player its own
+* AHeliMovementReplicatorConnection that only sends the helicopters relevant to that player.
+*/
+UCLASS(notplaceable, Transient)
+class HELIGAME_API AHeliMovementReplicator : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AHeliMovementReplicator(const FObjectInitializer& ObjectInitializer);
+
+	/* returns the replicator of the current game mode, null on clients */
+	static AHeliMovementReplicator* Get(const UObject* WorldContextObject);
+
+	/* [server] */
+	void RegisterMoveComp(UHeliMoveComp* MoveComp);
+
+	/* [server] */
+	void UnregisterMoveComp(UHeliMoveComp* MoveComp);
+
+	/* [server] refreshes keyframes and opens or closes connections as players come and go */
+	virtual void Tick(float DeltaSeconds) override;
+
+	const TArray<FHeliMovementSource>& GetSources() const { return Sources; }
+
+private:
+	UPROPERTY(Transient)
+	TArray<FHeliMovementSource> Sources;
+
+	/* one per remote player */
+	UPROPERTY(Transient)
+	TArray<class AHeliMovementReplicatorConnection*> Connections;
+
+	/* seconds between two keyframes of the same pawn */
+	UPROPERTY(EditDefaultsOnly, Category = "Replication", meta = (AllowPrivateAccess = "true"))
+	float KeyframeInterval;
+
+	void UpdateConnections();
+};
+
+/*
+* [server] Movement of the helicopters one remote player can see, only replicated to that player.
+* Keyframes go in their own array and only change once per KeyframeInterval, so a lost one is sent again
+* until it arrives and players joining mid match get the current ones right away. Every helicopter is
+* sent at its NetUpdateFrequency, which AHeliNetRelevancyManager lowers for the far away ones.
+*/
+UCLASS(notplaceable, Transient)
+class HELIGAME_API AHeliMovementReplicatorConnection : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AHeliMovementReplicatorConnection(const FObjectInitializer& ObjectInitializer);
+
+	/* [server] refresh entries right before we get replicated, once per net update */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	void SetReplicator(AHeliMovementReplicator* InReplicator) { Replicator = InReplicator; }
+
+private:
+	/* declared first, so a keyframe is received before the deltas of the same update */
+	UPROPERTY(Replicated)
+	FHeliMovementEntryArray Keyframes;
+
+	UPROPERTY(Replicated)
+	FHeliMovementEntryArray Entries;
+
+	/* [server] components in the same order as Keyframes and Entries */
+	UPROPERTY(Transient)
+	TArray<UHeliMoveComp*> MoveComps;
+
+	UPROPERTY(Transient)
+	AHeliMovementReplicator* Replicator;
+
+	/* [server] pawn is relevant for the player this connection belongs to */
+	bool IsRelevantForViewer(APawn* Pawn, APlayerController* Viewer, const AActor* ViewTarget, const FVector& ViewLocation) const;
+
+	void AddEntry(UHeliMoveComp* MoveComp);
+
+	void RemoveEntry(int32 Index);
+};
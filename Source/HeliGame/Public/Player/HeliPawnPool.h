@@ -0,0 +1,86 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "GameFramework/Info.h"
+#include "HeliPawnPool.generated.h"
+
+class AHelicopter;
+
+/* parked helicopters of one team, ready to be possessed */
+USTRUCT()
+struct FHeliPawnPoolTeam
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY()
+	TArray<AHelicopter*> Pawns;
+};
+
+/*
+* [server] Keeps helicopters alive between lives. Each team gets PawnsPerTeam pawns spawned up front,
+* weapon included, and parked out of sight with net dormancy. Restarting a player takes one of them,
+* resets it and moves it to the player start; a dead pawn goes back to its team after ReturnToPoolDelay.
+* Respawning then costs no actor spawn, no component registration and no new actor channel on clients.
+*/
+UCLASS(notplaceable, Transient)
+class HELIGAME_API AHeliPawnPool : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AHeliPawnPool(const FObjectInitializer& ObjectInitializer);
+
+	/* returns the pawn pool of the current game mode, null on clients */
+	static AHeliPawnPool* Get(const UObject* WorldContextObject);
+
+	/* spawns and parks PawnsPerTeam helicopters of InPawnClass for every team, once the world has begun play */
+	void Prewarm(UClass* InPawnClass, int32 NumTeams);
+
+	/* only pawns of this class are pooled, bots and other vehicles are spawned as usual */
+	UClass* GetPawnClass() const;
+
+	/* takes a parked pawn of the team and respawns it at SpawnTransform, null when the team has none left */
+	AHelicopter* AcquirePawn(int32 TeamNumber, const FTransform& SpawnTransform);
+
+	/* makes a pawn spawned outside the pool part of it, it is parked for the team once it dies */
+	void AddPawn(AHelicopter* Pawn, int32 TeamNumber);
+
+	/* [server] called by a pooled pawn when it dies, it is parked after ReturnToPoolDelay */
+	void ReleasePawn(AHelicopter* Pawn);
+
+	int32 GetNumParkedPawns() const;
+
+	void DumpStats() const;
+
+private:
+	UPROPERTY(Transient)
+	TSubclassOf<AHelicopter> PawnClass;
+
+	/* one entry per team, index is the team number */
+	UPROPERTY(Transient)
+	TArray<FHeliPawnPoolTeam> Teams;
+
+	/* pawns spawned for every team before the match starts */
+	UPROPERTY(EditDefaultsOnly, Category = "Pool", meta = (AllowPrivateAccess = "true"))
+	int32 PawnsPerTeam;
+
+	/* a dead pawn stays where it died this long (seconds), so clients still see it explode */
+	UPROPERTY(EditDefaultsOnly, Category = "Pool", meta = (AllowPrivateAccess = "true"))
+	float ReturnToPoolDelay;
+
+	/* where parked pawns wait, out of sight and out of the way */
+	UPROPERTY(EditDefaultsOnly, Category = "Pool", meta = (AllowPrivateAccess = "true"))
+	FVector ParkingLocation;
+
+	/* pawns respawned from the pool and pawns that had to be spawned because it was empty */
+	int32 NumReusedPawns;
+
+	int32 NumSpawnedPawns;
+
+	int32 GetTeamIndex(int32 TeamNumber) const;
+
+	AHelicopter* SpawnParkedPawn(int32 TeamNumber);
+
+	void ParkPawn(TWeakObjectPtr<AHelicopter> Pawn);
+};
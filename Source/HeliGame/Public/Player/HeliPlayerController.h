@@ -21,6 +21,66 @@ class HELIGAME_API AHeliPlayerController : public APlayerController
 
 	void AddHeliHudWidgetInHudForThirdPersonView();
 
+	/*
+	* Clock Sync
+	*/
+
+	/* one ping exchange, offset = server time - client time */
+	struct FClockSyncSample
+	{
+		float RoundTripTime;
+		float Offset;
+	};
+
+	/* [client] last ping exchanges, the one with the lowest round trip time is the most accurate */
+	TArray<FClockSyncSample> ClockSyncSamples;
+
+	/* [client] smoothed server time - client time */
+	float ServerClockOffset;
+
+	float ClockSyncRoundTripTime;
+
+	bool bHasClockSync;
+
+	int32 NumClockSyncResponses;
+
+	FTimerHandle TimerHandle_ClockSync;
+
+	/* seconds between two ping exchanges once synced */
+	UPROPERTY(EditDefaultsOnly, Category = "Network|ClockSync", meta = (AllowPrivateAccess = "true"))
+	float ClockSyncInterval;
+
+	/* seconds between the first ping exchanges, so we converge quickly after joining */
+	UPROPERTY(EditDefaultsOnly, Category = "Network|ClockSync", meta = (AllowPrivateAccess = "true"))
+	float InitialClockSyncInterval;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Network|ClockSync", meta = (AllowPrivateAccess = "true"))
+	int32 NumInitialClockSyncs;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Network|ClockSync", meta = (AllowPrivateAccess = "true"))
+	int32 MaxClockSyncSamples;
+
+	/* how fast the offset follows new estimates */
+	UPROPERTY(EditDefaultsOnly, Category = "Network|ClockSync", meta = (AllowPrivateAccess = "true"))
+	float ClockSyncSmoothing;
+
+	/* errors bigger than this (seconds) snap the offset instead of smoothing it, e.g. after a server hitch */
+	UPROPERTY(EditDefaultsOnly, Category = "Network|ClockSync", meta = (AllowPrivateAccess = "true"))
+	float ClockSyncSnapThreshold;
+
+	/* [server] how far in the past the client last said it draws other helicopters, see FHeliMoveInput::ProxyViewDelay */
+	float ReportedProxyViewDelay;
+
+	void StartClockSync();
+
+	void RequestClockSync();
+
+	UFUNCTION(Unreliable, Server, WithValidation)
+	void Server_RequestClockSync(float ClientSendTime);
+
+	UFUNCTION(Unreliable, Client)
+	void Client_ReceiveClockSync(float ClientSendTime, float ServerTime);
+
 protected:
 	/** if set, gameplay related actions (movement, weapon usage, etc) are allowed */
 	uint8 bAllowGameActions : 1;
@@ -51,6 +111,9 @@ protected:
 public:
 	AHeliPlayerController(const FObjectInitializer& ObjectInitializer);
 
+	/* [server] slot of this viewer in AHeliNetRelevancyManager, refreshed on every one of its ticks */
+	int32 NetRelevancyViewerIndex;
+
 	/** shows scoreboard */
 	void OnShowScoreboard();
 
@@ -99,6 +162,22 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "InGameMenu|Controls|NetworkSmoothingFactor")
 	float GetNetworkSmoothingFactor();
 
+	/* server world time, estimated from ping exchanges on clients. Use it to put timestamps on a timeline shared by everyone */
+	UFUNCTION(BlueprintCallable, Category = "Network")
+	float GetSyncedServerTime() const;
+
+	/* [client] filtered round trip time of the clock sync ping exchanges */
+	UFUNCTION(BlueprintCallable, Category = "Network")
+	float GetClockSyncRoundTripTime() const;
+
+	/* true on the server, and on clients once the first ping exchange came back */
+	bool HasClockSync() const;
+
+	/* [server] lag compensation rewinds remote helicopters by this on top of our round trip */
+	float GetReportedProxyViewDelay() const;
+
+	void SetReportedProxyViewDelay(float Delay);
+
 	/** check if gameplay related actions (movement, weapon usage, etc) are allowed right now */
 	bool IsGameInputAllowed() const;
 
@@ -211,4 +290,7 @@ public:
 	virtual void SetSpawnLocation(const FVector& NewLocation) override;
 
 	virtual void Possess(APawn* aPawn) override;
+
+	/** starts clock sync with the server once the client gets its player */
+	virtual void ReceivedPlayer() override;
 };
@@ -0,0 +1,71 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "GameFramework/Info.h"
+#include "HeliSignificanceManager.generated.h"
+
+class AHeliFighterVehicle;
+
+/* how much cosmetic work a vehicle is worth on the local client */
+UENUM()
+enum class EHeliSignificance : uint8
+{
+	/* what we are looking at or flying, or big on screen: everything at full rate */
+	High,
+	/* visible but small: rotors and health bar update at a lower rate */
+	Medium,
+	/* off screen or a few pixels: no rotor spin, no health bar, no weapon particles. The engine loop keeps playing, only its pitch is not updated */
+	Low,
+	MAX UMETA(Hidden)
+};
+
+/*
+* [client] Scores every vehicle by its screen size, whether it was rendered recently and whether it is
+* the local view target, and hands the resulting EHeliSignificance to the vehicle. Client cost of
+* rotors, audio, particles and health bars then follows what is on screen instead of the player count.
+* Spawned by the local AHeliHud, so there is none on dedicated servers.
+*/
+UCLASS(notplaceable, Transient)
+class HELIGAME_API AHeliSignificanceManager : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AHeliSignificanceManager(const FObjectInitializer& ObjectInitializer);
+
+	/* returns the manager of the first local player, null on dedicated servers */
+	static AHeliSignificanceManager* Get(const UObject* WorldContextObject);
+
+	/* picks up the vehicles that began play before the HUD existed */
+	virtual void BeginPlay() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	void RegisterVehicle(AHeliFighterVehicle* Vehicle);
+
+	void UnregisterVehicle(AHeliFighterVehicle* Vehicle);
+
+	/* fraction of the screen height a vehicle must cover to be High */
+	UPROPERTY(EditAnywhere, Category = "Significance")
+	float HighScreenSize;
+
+	/* fraction of the screen height a vehicle must cover to be Medium */
+	UPROPERTY(EditAnywhere, Category = "Significance")
+	float MediumScreenSize;
+
+	/* vehicles not rendered for this long (seconds) are off screen */
+	UPROPERTY(EditAnywhere, Category = "Significance")
+	float OffScreenTime;
+
+	/* off screen vehicles count as this much smaller, they can still be heard */
+	UPROPERTY(EditAnywhere, Category = "Significance")
+	float OffScreenScale;
+
+private:
+	UPROPERTY(Transient)
+	TArray<AHeliFighterVehicle*> Vehicles;
+
+	/* screen height fraction covered by the vehicle bounds, scaled down when off screen */
+	float ComputeScreenSize(const AHeliFighterVehicle* Vehicle, const FVector& ViewLocation, float TanHalfFOV) const;
+};
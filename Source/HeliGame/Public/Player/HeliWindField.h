@@ -0,0 +1,109 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "HeliFlightModel.h"
+#include "HeliWindField.generated.h"
+
+/* one grid point of the wind field, a byte per value */
+USTRUCT()
+struct FHeliWindCell
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* steady wind, 127 is MaxWindSpeed */
+	UPROPERTY()
+	int8 WindX;
+
+	UPROPERTY()
+	int8 WindY;
+
+	UPROPERTY()
+	int8 WindZ;
+
+	/* strongest gust, 127 is MaxTurbulenceSpeed. It swings back and forth over time, see Sample */
+	UPROPERTY()
+	int8 TurbulenceX;
+
+	UPROPERTY()
+	int8 TurbulenceY;
+
+	UPROPERTY()
+	int8 TurbulenceZ;
+
+	/* 255 is right above the ground */
+	UPROPERTY()
+	uint8 GroundProximity;
+
+	FHeliWindCell()
+		: WindX(0)
+		, WindY(0)
+		, WindZ(0)
+		, TurbulenceX(0)
+		, TurbulenceY(0)
+		, TurbulenceZ(0)
+		, GroundProximity(0)
+	{}
+};
+
+/*
+* Wind and turbulence of a map on a regular, world aligned grid, baked offline by AHeliWindVolume.
+* The grid never changes at runtime and sampling is a pure function of the location and the server time,
+* so server and clients get the same wind from the same asset without replicating anything.
+*/
+UCLASS()
+class HELIGAME_API UHeliWindField : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UHeliWindField(const FObjectInitializer& ObjectInitializer);
+
+	/* trilinear lookup of the eight grid points around Location, outside the grid the border is used.
+	   Turbulence swings at TurbulenceFrequency with a phase that depends on the location, ServerTime keeps every machine in step */
+	FHeliFlightWind Sample(const FVector& Location, float ServerTime) const;
+
+	/* has at least two grid points on every axis */
+	bool IsValidField() const;
+
+	/* replaces the grid, Winds has one entry per grid point, X first then Y then Z */
+	void Store(const FVector& InOrigin, float InCellSize, const FIntVector& InDimensions, const TArray<FHeliFlightWind>& Winds);
+
+	const FIntVector& GetDimensions() const { return Dimensions; }
+
+	float GetCellSize() const { return CellSize; }
+
+private:
+	/* world location of the first grid point */
+	UPROPERTY(VisibleAnywhere, Category = "WindField", meta = (AllowPrivateAccess = "true"))
+	FVector Origin;
+
+	/* distance between grid points (cm) */
+	UPROPERTY(VisibleAnywhere, Category = "WindField", meta = (AllowPrivateAccess = "true"))
+	float CellSize;
+
+	/* grid points on every axis */
+	UPROPERTY(VisibleAnywhere, Category = "WindField", meta = (AllowPrivateAccess = "true"))
+	FIntVector Dimensions;
+
+	/* fastest wind component of the grid (cm/s), what 127 means */
+	UPROPERTY(VisibleAnywhere, Category = "WindField", meta = (AllowPrivateAccess = "true"))
+	float MaxWindSpeed;
+
+	/* fastest turbulence component of the grid (cm/s) */
+	UPROPERTY(VisibleAnywhere, Category = "WindField", meta = (AllowPrivateAccess = "true"))
+	float MaxTurbulenceSpeed;
+
+	/* gusts per second */
+	UPROPERTY(EditAnywhere, Category = "WindField", meta = (AllowPrivateAccess = "true"))
+	float TurbulenceFrequency;
+
+	UPROPERTY()
+	TArray<FHeliWindCell> Cells;
+
+	int32 GetCellIndex(int32 X, int32 Y, int32 Z) const
+	{
+		return X + Dimensions.X * (Y + Dimensions.Y * Z);
+	}
+};
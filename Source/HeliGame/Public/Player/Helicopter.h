@@ -8,6 +8,40 @@
 class UStaticMeshComponent;
 class UCurveFloat;
 class UAudioComponent;
+class UHeliMoveComp;
+
+/* where and how often a pooled helicopter was respawned, see AHeliPawnPool */
+USTRUCT()
+struct FHeliPoolSpawnInfo
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* the pawn belongs to AHeliPawnPool, it never tears off */
+	UPROPERTY()
+	uint8 bPooled : 1;
+
+	/* waiting in the pool, hidden and dormant */
+	UPROPERTY()
+	uint8 bParked : 1;
+
+	/* increases on every respawn, so clients reset the pawn even if they never saw it parked */
+	UPROPERTY()
+	uint8 SpawnCount;
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+
+	UPROPERTY()
+	FRotator Rotation;
+
+	FHeliPoolSpawnInfo()
+		: bPooled(false)
+		, bParked(false)
+		, SpawnCount(0)
+		, Location(FVector::ZeroVector)
+		, Rotation(FRotator::ZeroRotator)
+	{}
+};
 
 /**
  * 
@@ -34,6 +68,8 @@ public:
 
 	virtual void PawnClientRestart() override;
 
+	virtual void OnRep_Controller() override;
+
 	virtual UPawnMovementComponent *GetMovementComponent() const override { return HeliMovementComponent; }
 
 private:
@@ -47,8 +83,30 @@ private:
 	UFUNCTION()
 	void OnCrashImpact(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
-	UFUNCTION(Reliable, Server, WithValidation, Category = "CrashImpact")
-	void Server_CrashImpactTakeDamage(float Damage);
+	/* [server] contacts are gathered for this long (seconds) and evaluated as one crash */
+	UPROPERTY(EditDefaultsOnly, Category = "CrashImpact", meta = (AllowPrivateAccess = "true"))
+	float CrashImpactWindow = 0.2f;
+
+	/* [server] contacts with a smaller impulse (kg cm/s) are scrapes and do no damage */
+	UPROPERTY(EditDefaultsOnly, Category = "CrashImpact", meta = (AllowPrivateAccess = "true"))
+	float MinCrashImpactImpulse = 50000.f;
+
+	/* [server] most damage a single window can do, percentage of MaxHealth */
+	UPROPERTY(EditDefaultsOnly, Category = "CrashImpact", meta = (AllowPrivateAccess = "true"))
+	float MaxCrashDamagePerWindow = 0.5f;
+
+	/* [server] open while contacts are being gathered */
+	FTimerHandle TimerHandle_CrashImpactWindow;
+
+	/* [server] worst contact of the current window */
+	float CrashWindowDamage = 0.f;
+
+	/* [server] applies the damage of the window, one crash however many contacts it had */
+	void EvaluateCrashImpact();
+
+	/* the owning client predicts its movement, it has to lose the controls too */
+	UFUNCTION(Reliable, Client, Category = "CrashImpact")
+	void Client_CrashControls();
 
 	/* Time handler to restore controls after crashing */
 	FTimerHandle TimerHandle_RestoreControls;
@@ -79,6 +137,19 @@ private:
 	/* Handle to manage the timer for the rotor animation*/
 	FTimerHandle RotorAnimTimerHandle;
 
+	/* rotors turn from InitHelicopter until death */
+	bool bRotorsSpinning = false;
+
+	/* Medium significance rotors update this many times less often, by bigger steps */
+	UPROPERTY(EditAnywhere, Category = "RotorAnimation", meta = (AllowPrivateAccess = "true"))
+	int32 MediumSignificanceRotorStepMultiplier = 4;
+
+	/* restarts the rotor timer at the rate of the current significance, stops it when Low */
+	void UpdateRotorAnimation();
+
+	/* rotors are not there on the server archetype */
+	void SetRotorsVisibility(bool bNewVisibility);
+
 	// max speed of the main and tail rotors
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "RotorAnimation", meta = (AllowPrivateAccess = "true"))
 	float RotorMaxSpeed;
@@ -93,6 +164,19 @@ private:
 	UPROPERTY(Category = "Mesh", VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	UStaticMeshComponent* TailRotorMeshComponent = nullptr;
 
+	/* [simulated proxy] draws the helicopter smoothly while the collision mesh follows server corrections at once */
+	UPROPERTY(Category = "Mesh", VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	UStaticMeshComponent* ProxyMeshComponent = nullptr;
+
+	/* hides the collision mesh and moves the visible parts onto ProxyMeshComponent */
+	void EnableProxyMesh();
+
+	/* moves the visible parts back onto the collision mesh, a pooled pawn may be locally controlled in its next life */
+	void DisableProxyMesh();
+
+	/* proxy mesh for remote helicopters, the collision mesh for the one we fly. Possession can change either way while alive */
+	void UpdateProxyMesh();
+
 	UPROPERTY(Category = "Mesh", VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	FName MainRotorAttachSocketName = TEXT("MainRotorSocket");
 
@@ -106,6 +190,13 @@ private:
 	UPROPERTY(Category = "MovementSettings", VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	UPawnMovementComponent* HeliMovementComponent = nullptr;
 
+	/* HeliMovementComponent, resolved once so input handlers don't cast on every axis event */
+	UPROPERTY(Transient)
+	UHeliMoveComp* PilotMoveComp = nullptr;
+
+	/* movement component pilot input goes to, null while game input is not allowed */
+	UHeliMoveComp* GetPilotMoveComp() const;
+
 	// mouse sensitivity
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "MovementSettings", meta = (AllowPrivateAccess = "true"))
 	float MouseSensitivity = 1.f;
@@ -170,32 +261,86 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Sound", meta = (AllowPrivateAccess = "true"))
 	float MinRotorPitch;
 
+	/* pitch the rotor sound should have, only applied while the helicopter is not of low significance */
+	float RotorPitch;
+
+	void SetRotorPitch(float NewRotorPitch);
+
 
 	/*
 		Health Regen
 	*/	
 
-	UFUNCTION(Reliable, Server, WithValidation, BlueprintCallable, Category = "RepairSettings")
-	void Server_AddHealth(float Value);
+	/* the owning client only asks to start and stop, the server does the repairing */
+	UFUNCTION(Reliable, Server, WithValidation, Category = "RepairSettings")
+	void Server_StartRepair();
 
+	UFUNCTION(Reliable, Server, WithValidation, Category = "RepairSettings")
+	void Server_StopRepair();
+
+	/* [server] */
+	void StartRepair();
+
+	/* [server] */
+	void StopRepair();
+
+	/* [server] adds the health regenerated since RepairServerTime */
+	void CommitRepair();
+
+	/* [server] commits regularly, stops when flying too fast or fully repaired */
 	void HandleRepairing();
 
+	/* health restored every HealthRegenRate seconds */
 	UPROPERTY(EditDefaultsOnly, Category = "HealthSettings", meta = (AllowPrivateAccess = "true"))
 	float MinRestoreHealthValue;
 
 	FTimerHandle TimerHandle_RestoreHealth;
 
+	/* seconds between two commits of the regenerated health on the server */
 	UPROPERTY(EditDefaultsOnly, Category = "HealthSettings", meta = (AllowPrivateAccess = "true"))
 	float HealthRegenRate;
 
-	float LastHealedTime;
+	/* repairing stops at this percentage of MaxHealth */
+	UPROPERTY(EditDefaultsOnly, Category = "HealthSettings", meta = (AllowPrivateAccess = "true"))
+	float MaxRepairHealthPercent;
+
+	UPROPERTY(Transient, Replicated)
+	bool bIsRepairing;
+
+	/* server time Health was last committed at, clients regenerate from there on their own */
+	UPROPERTY(Transient, Replicated)
+	float RepairServerTime;
+
+	float GetRepairHealthPerSecond() const;
 
 	UPROPERTY(EditDefaultsOnly, Category = "HealthSettings", meta = (AllowPrivateAccess = "true"))
 	float RepairVelocityThreshould;		
+
+	/*
+		Pawn Pool
+	*/
+
+	/* [server] team of the pool the pawn goes back to when it dies, INDEX_NONE when it is not pooled */
+	int32 PoolTeamNumber = INDEX_NONE;
+
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_PoolSpawnInfo)
+	FHeliPoolSpawnInfo PoolSpawnInfo;
+
+	/* [client] parks or respawns the pawn like the server did */
+	UFUNCTION()
+	void OnRep_PoolSpawnInfo(const FHeliPoolSpawnInfo& PreviousPoolSpawnInfo);
+
+	/* undoes OnDeath, moves the pawn to its spawn location and starts InitHelicopter again */
+	void ResetForRespawn();
 	
 protected:
+	FTimerHandle TimerHandle_InitHelicopter;
+
 	void InitHelicopter();
 
+	/* no rotors, sound, meshes, movement nor collision, what is left of a dead or parked helicopter */
+	void DisableHelicopter();
+
 	void OnDeath(float KillingDamage, FDamageEvent const &DamageEvent, APawn *PawnInstigator, AActor *DamageCauser) override;
 
 public:
@@ -204,6 +349,37 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Mesh")
 	UStaticMeshComponent* GetHeliMeshComponent();
 
+	virtual USceneComponent* GetWeaponAttachComponent() const override;
+
+	virtual void SetSignificance(EHeliSignificance NewSignificance) override;
+
+	/* replicated health plus what the server regenerated since its last commit */
+	virtual float GetCurrentHealth() const override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/* rotors and proxy mesh go too, the collision mesh stays */
+	virtual void StripCosmeticComponents() override;
+
+	/*
+	*	Pawn Pool
+	*/
+
+	int32 GetPoolTeamNumber() const { return PoolTeamNumber; }
+
+	/* [server] the pawn is parked for this team when it dies instead of tearing off */
+	void SetPoolTeamNumber(int32 NewPoolTeamNumber);
+
+	bool IsPooled() const { return PoolSpawnInfo.bPooled; }
+
+	bool IsParkedInPool() const { return PoolSpawnInfo.bParked; }
+
+	/* [server] hides the pawn at ParkingLocation and lets it go dormant */
+	void ParkInPool(const FVector& ParkingLocation);
+
+	/* [server] wakes the pawn up at SpawnTransform with full health and ammo, ready to be possessed */
+	void RespawnFromPool(const FTransform& SpawnTransform);
+
 	/*
 	*	Action Inputs
 	*/	
@@ -21,12 +21,23 @@ class HELIGAME_API AHeliHud : public AHUD
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Crosshair", meta = (AllowPrivateAccess = "true"))
 	float AimDistanceForDeprojectionOfCrosshair;
 
+	UPROPERTY(EditDefaultsOnly, Category = "Significance", meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<class AHeliSignificanceManager> SignificanceManagerClass;
+
+	UPROPERTY(Transient)
+	class AHeliSignificanceManager* SignificanceManager;
+
 public:
 	AHeliHud();
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/* decides how much cosmetic work every vehicle does for this player, see AHeliSignificanceManager */
+	class AHeliSignificanceManager* GetSignificanceManager() const { return SignificanceManager; }
+
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
@@ -4,6 +4,7 @@
 
 #include "GameFramework/Actor.h"
 #include "ProjectileWeapon.h"
+#include "HeliNetRelevancyManager.h"
 #include "Templates/Casts.h"
 #include "HeliProjectile.generated.h"
 
@@ -11,6 +12,26 @@ class UParticleSystemComponent;
 class UProjectileMovementComponent;
 class USphereComponent;
 
+/* [server to client] where a pooled projectile is in its life, see AHeliProjectilePool */
+USTRUCT()
+struct FHeliProjectilePoolState
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* hidden and asleep, waiting for a shot */
+	UPROPERTY()
+	bool bParked;
+
+	/* bumped every launch, clients reset a projectile they saw explode in a previous life */
+	UPROPERTY()
+	uint8 LaunchCount;
+
+	FHeliProjectilePoolState()
+		: bParked(false)
+		, LaunchCount(0)
+	{}
+};
+
 UCLASS()
 class HELIGAME_API AHeliProjectile : public AActor
 {
@@ -27,6 +48,14 @@ public:
 	/** initial setup */
 	virtual void PostInitializeComponents() override;
 
+	/* [server] looks for helicopters where the shooter saw them along the way */
+	virtual void Tick(float DeltaSeconds) override;
+
+	/* [server] projectiles far from the viewer are not relevant, see AHeliNetRelevancyManager */
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	FHeliNetRelevancy& GetNetRelevancy() { return NetRelevancy; }
+
 	/** setup velocity */
 	void InitVelocity(FVector& ShootDirection, FVector& InitialVelocity);
 
@@ -34,7 +63,22 @@ public:
 	UFUNCTION()
 	void OnImpact(const FHitResult& HitResult);
 
+	/* [server] owned by AHeliProjectilePool, it is parked instead of destroyed */
+	bool IsPooled() const { return bPooled; }
+
+	/* hidden and net dormant in AHeliProjectilePool */
+	bool IsParkedInPool() const { return PoolState.bParked; }
+
+	/* [server] hides, stops and puts the projectile to net dormancy at Location until it is launched again */
+	void ParkInPool(const FVector& Location);
+
+	/* [server] fires a parked projectile from Weapon, what spawning a new one would do */
+	void LaunchFromPool(AProjectileWeapon* Weapon, const FTransform& LaunchTransform, const FVector& ShootDirection, const FVector& InitialVelocity);
+
 private:
+	/* [server] viewers that can see it, filled in by AHeliNetRelevancyManager */
+	FHeliNetRelevancy NetRelevancy;
+
 	/** movement component */
 	UPROPERTY(VisibleDefaultsOnly, Category = "Projectile")
 	UProjectileMovementComponent* MovementComp;
@@ -62,6 +106,26 @@ protected:
 	UFUNCTION()
 	void OnRep_Exploded();
 
+	/* [server] false for projectiles spawned by a weapon, they are destroyed after they exploded */
+	bool bPooled;
+
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_PoolState)
+	FHeliProjectilePoolState PoolState;
+
+	UFUNCTION()
+	void OnRep_PoolState(const FHeliProjectilePoolState& PreviousPoolState);
+
+	/* [server] a pooled projectile goes back to the pool when its life ends or some time after it exploded */
+	FTimerHandle TimerHandle_ReturnToPool;
+
+	void ReturnToPool();
+
+	/* no movement, collision nor effects while parked */
+	void DisableProjectile();
+
+	/* movement, collision and effects back on for a new shot */
+	void ResetForLaunch();
+
 	/** trigger explosion */
 	void Explode(const FHitResult& Impact);
 
@@ -81,6 +145,19 @@ protected:
 	/** find hit */
 	FHitResult Trace(const FVector& TraceFrom, const FVector& TraceTo) const;
 
+	/*
+	* Lag Compensation
+	*/
+
+	/* [server] helicopters are hit where the shooter saw them, the movement sweep only collides with the rest of the world */
+	bool IsLagCompensated() const;
+
+	/* [server] where the last lag compensated trace ended */
+	FVector LastLagCompensatedLocation;
+
+	/* [server] traces from where the last trace ended to End against helicopters where the shooter saw them */
+	bool TraceLagCompensatedVehicles(const FVector& End, FHitResult& OutHit);
+
 
 	/*
 	* Debuggers
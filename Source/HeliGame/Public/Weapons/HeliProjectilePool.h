@@ -0,0 +1,79 @@
+// Copyright 2017 Andrey Bicalho Santos. All Rights Reserved.
+
+#pragma once
+
+#include "GameFramework/Info.h"
+#include "HeliProjectilePool.generated.h"
+
+class AHeliProjectile;
+
+/* projectiles of one class */
+USTRUCT()
+struct FHeliProjectilePoolEntry
+{
+	GENERATED_USTRUCT_BODY()
+
+	/* parked, ready to be launched */
+	UPROPERTY()
+	TArray<AHeliProjectile*> Projectiles;
+
+	/* projectiles the weapons in play asked to be kept around */
+	int32 NumReserved;
+
+	/* parked and in flight */
+	int32 NumAlive;
+
+	FHeliProjectilePoolEntry()
+		: NumReserved(0)
+		, NumAlive(0)
+	{}
+};
+
+/*
+* [server] Recycles projectiles instead of spawning and destroying one per shot. Every projectile weapon reserves
+* enough of its projectile class to cover its fire rate when it begins play; they are spawned up front and parked
+* hidden, without collision and net dormant. A shot launches a parked one, which comes back once it has exploded
+* or reached the end of its life. Clients keep the actor of a dormant projectile, so reusing it opens no new actor.
+*/
+UCLASS(notplaceable, Transient)
+class HELIGAME_API AHeliProjectilePool : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	AHeliProjectilePool(const FObjectInitializer& ObjectInitializer);
+
+	/* returns the projectile pool of the current game mode, null on clients */
+	static AHeliProjectilePool* Get(const UObject* WorldContextObject);
+
+	/* keeps Count more projectiles of ProjectileClass, parked ones are spawned for what is missing */
+	void Reserve(UClass* ProjectileClass, int32 Count);
+
+	/* gives back a reservation, spare projectiles are destroyed as they come back */
+	void Unreserve(UClass* ProjectileClass, int32 Count);
+
+	/* takes a parked projectile out of the pool, a new one is spawned when every one is in flight */
+	AHeliProjectile* AcquireProjectile(UClass* ProjectileClass);
+
+	/* [server] called by a pooled projectile when it is done, it is parked again */
+	void ReleaseProjectile(AHeliProjectile* Projectile);
+
+	int32 GetNumParkedProjectiles() const;
+
+	void DumpStats() const;
+
+private:
+	UPROPERTY(Transient)
+	TMap<UClass*, FHeliProjectilePoolEntry> Entries;
+
+	/* where parked projectiles wait, out of sight and out of the way */
+	UPROPERTY(EditDefaultsOnly, Category = "Pool", meta = (AllowPrivateAccess = "true"))
+	FVector ParkingLocation;
+
+	/* shots served by a parked projectile and shots that had to spawn one */
+	int32 NumReusedProjectiles;
+
+	int32 NumSpawnedProjectiles;
+
+	AHeliProjectile* SpawnParkedProjectile(UClass* ProjectileClass);
+};
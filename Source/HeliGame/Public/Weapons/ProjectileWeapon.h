@@ -70,6 +70,10 @@ public:
 	/** apply config on projectile */
 	void ApplyWeaponConfig(FProjectileWeaponData& Data);
 
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 
 protected:
 
@@ -85,6 +89,10 @@ protected:
 	UPROPERTY(EditDefaultsOnly, Category = "Effects")
 	FName TrailTargetParam;
 
+	/* projectiles this weapon keeps in AHeliProjectilePool, zero is as many as can be in flight at the fire rate, up to a clip */
+	UPROPERTY(EditDefaultsOnly, Category = "Config")
+	int32 PooledProjectiles;
+
 	//////////////////////////////////////////////////////////////////////////
 	// Weapon usage
 
@@ -96,6 +104,11 @@ protected:
 	void ServerFireProjectile(FVector Origin, FVector_NetQuantizeNormal ShootDir);
 
 private:	
+	/* [server] what was reserved in the projectile pool at BeginPlay, given back at EndPlay */
+	int32 NumReservedProjectiles;
+
+	int32 GetNumProjectilesToReserve() const;
+
 	FVector GetAdjustedShootDirectionForFirstPersonView();
 
 	/** spawn trail effect */
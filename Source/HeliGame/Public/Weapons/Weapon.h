@@ -149,6 +149,9 @@ public:
 	/** consume a bullet */
 	void UseAmmo();
 
+	/** [server] full clip and initial ammo again, for pawns reused after dying */
+	void ResetAmmo();
+
 	//////////////////////////////////////////////////////////////////////////
 	// Inventory
 